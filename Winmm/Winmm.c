@@ -19,9 +19,13 @@
 
 #include "stdafx.h"
 #include "player.h"
+#include "timer.h"
+#include "mixer.h"
+#include "stats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 
 #include "fk.hpp"
 
@@ -57,145 +61,457 @@ FILE *fh = NULL;
 #define dprintf(...)
 #endif
 
-int playing = 0;
-int updateTrack = 0;
-int closed = 0;
-HANDLE player = NULL;
 int firstTrack = -1;
 int lastTrack = 0;
 int numTracks = 0;
 char music_path[2048];
-int time_format = MCI_FORMAT_TMSF;
+char ini_path[2048];
 CRITICAL_SECTION cs;
-static struct play_info info = { -1, -1 };
 
-void setVolume() {
-	FILE *fptr;
-	// Open a file in read mode
-	fptr = fopen("volumeBGM.txt", "r");
-	if (fptr == NULL){
-		plr_volume(100);
+#define VOLUME_FILE "volumeBGM.txt"
+#define VOLUME_DEBOUNCE_MS 100 // editors touch the file several times per save
+#define VOLUME_CHANNEL "Local\\ogg-winmm-volume"
+
+// Reads the volume file into a stack buffer, no CRT stream or heap involved.
+// Returns -1 when the file is missing or doesn't hold a number.
+static int readVolume()
+{
+	char buf[16];
+	DWORD len = 0;
+	HANDLE file = CreateFileA(VOLUME_FILE, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return -1;
+
+	BOOL ok = ReadFile(file, buf, sizeof buf, &len, NULL);
+	CloseHandle(file);
+
+	if (!ok)
+		return -1;
+
+	// digits, optionally surrounded by whitespace like a trailing newline
+	DWORD i = 0;
+	int vol = 0, digits = 0;
+
+	while (i < len && isspace((unsigned char)buf[i]))
+		i++;
+
+	while (i < len && buf[i] >= '0' && buf[i] <= '9' && digits < 3)
+	{
+		vol = vol * 10 + buf[i++] - '0';
+		digits++;
 	}
-	else{
-		// Store the content of the file
-		char strVol[4];
-		// Read the content and store it inside strVol
-		fgets(strVol, 4, fptr);
-		// Close the file
-		fclose(fptr);
-
-		char *endptr;
-		int newVol = strtol(strVol, &endptr, 10);
-
-		if (*endptr != '\0' || endptr == strVol) {
-			//Invalid number, set to default
-			plr_volume(100);
-		}
-		else {
-			//Set Volume to the number in the file
-			plr_volume(newVol);
-		}
+
+	while (i < len && isspace((unsigned char)buf[i]))
+		i++;
+
+	if (!digits || i != len)
+		return -1;
+
+	return vol;
+}
+
+void setVolume() {
+	// Only reparse when the file actually changed since last time
+	static WIN32_FILE_ATTRIBUTE_DATA last;
+	static int checked = 0;
+	WIN32_FILE_ATTRIBUTE_DATA now;
+
+	if (!GetFileAttributesExA(VOLUME_FILE, GetFileExInfoStandard, &now))
+		memset(&now, 0, sizeof now);
+
+	if (checked &&
+		CompareFileTime(&now.ftLastWriteTime, &last.ftLastWriteTime) == 0 &&
+		now.nFileSizeLow == last.nFileSizeLow &&
+		now.nFileSizeHigh == last.nFileSizeHigh)
+		return;
+
+	last = now;
+	checked = 1;
+
+	int newVol = readVolume();
+
+	//Invalid number or no file, set to default
+	plr_volume(newVol < 0 ? 100 : newVol);
+}
+
+// Optional shared-memory volume: a single LONG, 0 to 100, that a launcher
+// can write at any time. The player reads it straight from the mapping.
+// Returns 1 when the launcher created it first and already set a volume.
+static int shareVolume()
+{
+	HANDLE map = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(LONG), VOLUME_CHANNEL);
+
+	if (!map)
+		return 0;
+
+	int existed = GetLastError() == ERROR_ALREADY_EXISTS;
+	volatile LONG *vol = MapViewOfFile(map, FILE_MAP_WRITE, 0, 0, sizeof(LONG));
+
+	if (!vol)
+	{
+		CloseHandle(map);
+		return 0;
 	}
+
+	if (!existed)
+		*vol = 100;
+
+	plr_volume_share(vol);
+	return existed;
 }
 
-int player_main()
+// Every open of cdaudio gets a slot here. Slot 0 is the default drive that
+// games have always been able to use without opening it first, the rest are
+// handed out to aliased opens. Slots are cheap, a decoder and a waveOut
+// stream only exist while the device is actually playing.
+#define CD_DEVICES ST_DEVICES // one stats slot each
+#define CD_WORKERS 2
+
+struct cd_device
+{
+    int used;
+    char alias[64];
+    int time_format;
+    int playing;            // cleared by MCI_STOP/MCI_CLOSE
+    int update;             // MCI_PLAY waiting to be picked up
+    int closing;            // MCI_CLOSE while a worker had the device
+    int busy;               // a worker owns the stream right now
+    struct play_info info;  // requested playlist
+
+    // worker side, only touched while busy
+    int first;
+    int last;
+    int current;
+    struct plr_stream *stream;
+};
+
+static struct cd_device devices[CD_DEVICES];
+static HANDLE cd_ev = NULL; // shared by every stream, signalled per finished buffer
+static int cd_workers = 0;
+static HANDLE cd_threads[CD_WORKERS];
+static volatile LONG cd_quit = 0;
+
+static void cd_reset(struct cd_device *d)
 {
-    int first = 0;
-    int last = 0;
-    int current = 0;
+    int time_format = d->time_format;
 
-    while (!closed)
+    memset(d, 0, sizeof *d);
+    d->info.first = -1;
+    d->info.last = -1;
+
+    // the default drive never goes away and keeps its time format like before
+    if (d == &devices[0])
     {
-		BOOL same_playlist = FALSE;
-        //set track info
-        if (updateTrack)
+        d->used = 1;
+        d->time_format = time_format;
+    }
+}
+
+static struct cd_device *cd_lookup(MCIDEVICEID id)
+{
+    if (id == 0 || id == 0xFFFFFFFF || id == MCI_ALL_DEVICE_ID)
+        return &devices[0];
+
+    if (id >= MAGIC_DEVICEID && id < MAGIC_DEVICEID + CD_DEVICES && devices[id - MAGIC_DEVICEID].used)
+        return &devices[id - MAGIC_DEVICEID];
+
+    return NULL;
+}
+
+// Device id for a name used in a command string. Unknown names keep going
+// to the default drive, the string parser always accepted anything there.
+static MCIDEVICEID cd_find(const char *name)
+{
+    MCIDEVICEID id = MAGIC_DEVICEID;
+
+    if (!name || strcmp(name, "cdaudio") == 0)
+        return id;
+
+    EnterCriticalSection(&cs);
+    for (int i = 1; i < CD_DEVICES; i++)
+    {
+        if (devices[i].used && _stricmp(devices[i].alias, name) == 0)
         {
-			if (first == info.first)
-			{
-				same_playlist = TRUE;
-			}
-			else
-			{
-				same_playlist = FALSE;
-				first = info.first;
-				last = info.last;
-				current = first;
-			}
-			updateTrack = 0;
+            id = MAGIC_DEVICEID + i;
+            break;
         }
+    }
+    LeaveCriticalSection(&cs);
 
-        //rewind if at end of 'playlist'
-        //note "last" track is NON-inclusive
-		if (current == last)
-		{
-			current = info.first;
-			playing = 1;
-		}
+    return id;
+}
 
-        //try to play song
-		if (same_playlist)
-		{
-			dprintf("  New playlist next track is same as last track, ignored : : %s\r\n", tracks[current].path);
-		}
-		else
-		{
-			dprintf("  Next track: %s\r\n", tracks[current].path);
-			playing = plr_play(tracks[current].path);
-		}
+static MCIERROR cd_open(const char *alias, MCIDEVICEID *id)
+{
+    MCIERROR err = MCIERR_OUT_OF_MEMORY;
+
+    // unaliased opens all share the default drive, like they always did
+    if (!alias || !*alias || _stricmp(alias, "cdaudio") == 0)
+    {
+        *id = MAGIC_DEVICEID;
+        return 0;
+    }
+
+    EnterCriticalSection(&cs);
 
-        while (1)
+    for (int i = 1; i < CD_DEVICES; i++)
+    {
+        if (devices[i].used && _stricmp(devices[i].alias, alias) == 0)
         {
-            //check control signals
-			if (closed) //MCI_CLOSE
-			{
-				break;
-			}
-            
-            if (!playing) //MCI_STOP
+            LeaveCriticalSection(&cs);
+            return MCIERR_DUPLICATE_ALIAS;
+        }
+    }
+
+    for (int i = 1; i < CD_DEVICES; i++)
+    {
+        if (!devices[i].used)
+        {
+            cd_reset(&devices[i]);
+            devices[i].used = 1;
+            devices[i].time_format = MCI_FORMAT_TMSF;
+            strncpy_s(devices[i].alias, _countof(devices[i].alias), alias, _TRUNCATE);
+            *id = MAGIC_DEVICEID + i;
+            err = 0;
+            break;
+        }
+    }
+
+    LeaveCriticalSection(&cs);
+
+    dprintf("  Opened alias %s as device %d\r\n", alias, *id);
+
+    return err;
+}
+
+static void cd_close(struct cd_device *d)
+{
+    struct plr_stream *stream = NULL;
+
+    EnterCriticalSection(&cs);
+
+    d->playing = 0;
+
+    if (d->busy)
+    {
+        // the worker finishes the job when it lets go of the device
+        d->closing = 1;
+    }
+    else
+    {
+        stream = d->stream;
+        cd_reset(d);
+        ST_SET(&st_shared->devices[d - devices].active, 0);
+    }
+
+    LeaveCriticalSection(&cs);
+
+    plr_close(stream);
+    SetEvent(cd_ev);
+}
+
+// Advance one device as far as its stream allows without blocking. This is
+// the old per-device player thread turned inside out: it returns whenever
+// the waveOut queue is full instead of waiting on it.
+static void cd_step(struct cd_device *d)
+{
+    EnterCriticalSection(&cs);
+    int update = d->update;
+    int playing = d->playing && !d->closing;
+    struct play_info info = d->info;
+    d->update = 0;
+    LeaveCriticalSection(&cs);
+
+    if (!playing) //MCI_STOP
+    {
+        plr_close(d->stream); //end playback
+        d->stream = NULL;
+        ST_SET(&st_shared->devices[d - devices].active, 0);
+        return;
+    }
+
+    if (update) //MCI_PLAY
+    {
+        if (d->stream && d->first == info.first)
+        {
+            dprintf("  New playlist next track is same as last track, ignored : : %s\r\n", tracks[d->current].path);
+        }
+        else
+        {
+            plr_close(d->stream);
+            d->stream = NULL;
+            d->first = info.first;
+            d->last = info.last;
+            d->current = d->first;
+        }
+    }
+
+    while (1)
+    {
+        if (!d->stream)
+        {
+            //rewind if at end of 'playlist'
+            //note "last" track is NON-inclusive
+            if (d->current >= d->last)
+                d->current = d->first;
+
+            dprintf("  Next track: %s\r\n", tracks[d->current].path);
+            d->stream = plr_open(tracks[d->current].path, cd_ev, &st_shared->devices[d - devices]);
+            ST_SET(&st_shared->devices[d - devices].track, d->current);
+            ST_SET(&st_shared->devices[d - devices].active, d->stream != NULL);
+
+            if (!d->stream)
             {
-                plr_stop(); //end playback
-                SuspendThread(player); //pause thread until next MCI_PLAY
+                EnterCriticalSection(&cs);
+                d->playing = 0;
+                LeaveCriticalSection(&cs);
+                return;
             }
+        }
 
-			if (plr_pump() == 0) //done playing song
-			{
-				break;
-			}
+        int ret = plr_pump(d->stream);
 
-			if (updateTrack) //MCI_PLAY
-			{
-				break;
-			}
+        if (ret == PLR_WAIT)
+            return;
+
+        if (ret == PLR_DONE) //done playing song
+        {
+            plr_close(d->stream);
+            d->stream = NULL;
+            d->current++;
         }
+    }
+}
+
+// All playing devices are served by a couple of shared threads woken by the
+// one event every stream signals, rather than a thread per device.
+static DWORD WINAPI cd_worker(LPVOID unused)
+{
+    while (!cd_quit)
+    {
+        WaitForSingleObject(cd_ev, 100);
+
+        for (int i = 0; i < CD_DEVICES; i++)
+        {
+            struct cd_device *d = &devices[i];
 
-        current++;
+            EnterCriticalSection(&cs);
+            if (!d->used || d->busy || !(d->playing || d->stream || d->closing))
+            {
+                LeaveCriticalSection(&cs);
+                continue;
+            }
+            d->busy = 1;
+            LeaveCriticalSection(&cs);
+
+            cd_step(d);
+
+            EnterCriticalSection(&cs);
+            d->busy = 0;
+            if (d->closing && !d->stream)
+                cd_reset(d);
+            LeaveCriticalSection(&cs);
+        }
     }
-    plr_stop();
 
-    playing = 0;
     return 0;
 }
 
+// Threads grow with the number of devices playing at once, up to the pool size
+static void cd_spawn_workers()
+{
+    int active = 0;
+
+    EnterCriticalSection(&cs);
+
+    for (int i = 0; i < CD_DEVICES; i++)
+    {
+        if (devices[i].used && devices[i].playing)
+            active++;
+    }
+
+    while (!cd_quit && cd_workers < active && cd_workers < CD_WORKERS)
+    {
+        HANDLE thread = CreateThread(NULL, 0, cd_worker, NULL, 0, NULL);
+
+        if (!thread)
+            break;
+
+        cd_threads[cd_workers++] = thread;
+    }
+
+    LeaveCriticalSection(&cs);
+}
+
+// Stops the workers and closes every stream they had open, which joins any
+// readahead thread too. Devices stay open, the next MCI_PLAY starts over.
+static void cd_shutdown()
+{
+    int i, workers;
+
+    EnterCriticalSection(&cs);
+    InterlockedExchange(&cd_quit, 1);
+    workers = cd_workers;
+    LeaveCriticalSection(&cs);
+
+    if (workers)
+    {
+        SetEvent(cd_ev);
+        WaitForMultipleObjects(workers, cd_threads, TRUE, INFINITE);
+
+        for (i = 0; i < workers; i++)
+            CloseHandle(cd_threads[i]);
+    }
+
+    for (i = 0; i < CD_DEVICES; i++)
+    {
+        struct cd_device *d = &devices[i];
+        struct plr_stream *stream;
+
+        EnterCriticalSection(&cs);
+        stream = d->stream;
+        d->stream = NULL;
+        d->playing = 0;
+        d->update = 0;
+        if (d->closing)
+            cd_reset(d);
+        ST_SET(&st_shared->devices[i].active, 0);
+        LeaveCriticalSection(&cs);
+
+        plr_close(stream);
+    }
+
+    EnterCriticalSection(&cs);
+    cd_workers = 0;
+    InterlockedExchange(&cd_quit, 0);
+    LeaveCriticalSection(&cs);
+}
+
 struct ThreadData {
     HANDLE directoryHandle;
     wchar_t* directoryPath;
     wchar_t* targetFileName;
 };
 
+static HANDLE monitorThread = NULL;
+static volatile LONG monitorQuit = 0;
+
 void MonitorDirectoryThread(void* data) {
     struct ThreadData* threadData = (struct ThreadData*)data;
     HANDLE directoryHandle = threadData->directoryHandle;
     wchar_t* directoryPath = threadData->directoryPath;
     wchar_t* targetFileName = threadData->targetFileName;
+    size_t targetLength = wcslen(targetFileName);
 
     // Buffer to store the changes
     const int bufferSize = 4096;
-    BYTE buffer[4096];
+    DWORD buffer[4096 / sizeof(DWORD)]; // entries must be DWORD aligned
 
     DWORD bytesRead;
     FILE_NOTIFY_INFORMATION* fileInfo;
 
-    while (ReadDirectoryChangesW(
+    while (!monitorQuit && ReadDirectoryChangesW(
         directoryHandle,
         buffer,
         bufferSize,
@@ -205,26 +521,37 @@ void MonitorDirectoryThread(void* data) {
         NULL,
         NULL
     )) {
-        fileInfo = (FILE_NOTIFY_INFORMATION*)buffer;
-
-        //Make sure that the file that got written to is the file we are monitoring
-        if (wcsncmp(fileInfo->FileName, targetFileName, fileInfo->FileNameLength / sizeof(wchar_t)) != 0)
-            continue;
-
-        do {
+        int changed = 0;
 
-            switch (fileInfo->Action) {
-            case FILE_ACTION_MODIFIED:
-                setVolume();
-                break;
-            default:
-                break;
+        if (bytesRead == 0) {
+            // the buffer overflowed and the details were dropped, just check
+            changed = 1;
+        }
+        else {
+            fileInfo = (FILE_NOTIFY_INFORMATION*)buffer;
+
+            while (1) {
+                //Make sure that the file that got written to is the file we are monitoring,
+                //the whole name and not just a prefix of it
+                if (fileInfo->Action == FILE_ACTION_MODIFIED &&
+                    fileInfo->FileNameLength / sizeof(wchar_t) == targetLength &&
+                    _wcsnicmp(fileInfo->FileName, targetFileName, targetLength) == 0)
+                    changed = 1;
+
+                if (fileInfo->NextEntryOffset == 0)
+                    break;
+
+                // Move to the next entry in the buffer
+                fileInfo = (FILE_NOTIFY_INFORMATION*)((char*)fileInfo + fileInfo->NextEntryOffset);
             }
+        }
 
-            // Move to the next entry in the buffer
-            fileInfo = (FILE_NOTIFY_INFORMATION*)((char*)fileInfo + fileInfo->NextEntryOffset);
-
-        } while (fileInfo->NextEntryOffset != 0);
+        if (changed) {
+            // Let the save settle, the notifications it causes meanwhile are
+            // queued up and end up as a single unchanged stat check below
+            Sleep(VOLUME_DEBOUNCE_MS);
+            setVolume();
+        }
     }
 
     // Close the directory handle when the monitoring loop exits
@@ -260,11 +587,39 @@ void MonitorDirectory(const wchar_t* directoryPath, const wchar_t* targetFileNam
     threadData->directoryPath = directoryPath;
     threadData->targetFileName = targetFileName;
 
-    // Create a thread for monitoring
-    HANDLE threadHandle = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)MonitorDirectoryThread, threadData, 0, NULL);
+    // Create a thread for monitoring, kept so shutdown can stop it
+    monitorThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)MonitorDirectoryThread, threadData, 0, NULL);
+}
+
+// The watch blocks in ReadDirectoryChangesW, so the read is cancelled until
+// the thread sees the flag. That takes CancelSynchronousIo from Vista on,
+// on XP the thread is left running.
+static void StopMonitorDirectory()
+{
+    BOOL (WINAPI *cancel)(HANDLE) = (void*)GetProcAddress(GetModuleHandleA("kernel32.dll"), "CancelSynchronousIo");
+
+    if (!monitorThread || !cancel)
+        return;
+
+    InterlockedExchange(&monitorQuit, 1);
+    while (WaitForSingleObject(monitorThread, 10) == WAIT_TIMEOUT)
+        cancel(monitorThread);
 
-    //Closes the handle to the thread, however this does not stop the thread
-    CloseHandle(threadHandle);
+    CloseHandle(monitorThread);
+    monitorThread = NULL;
+}
+
+// For a host that unloads winmm.dll with FreeLibrary. DllMain can't wait for
+// threads under the loader lock, so this has to be called before: it stops
+// the music and the threads behind it, closes the mixer's device, then
+// hands the decoder pool back.
+// Music can be played again afterwards, from the C heap.
+void WINAPI ogg_winmm_shutdown()
+{
+    StopMonitorDirectory();
+    cd_shutdown();
+    mix_shutdown();
+    plr_allocator(0);
 }
 
 BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
@@ -280,17 +635,39 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
 
         InitializeCriticalSection(&cs);
 
+        cd_ev = CreateEvent(NULL, FALSE, FALSE, NULL);
+        devices[0].time_format = MCI_FORMAT_TMSF;
+        cd_reset(&devices[0]);
+
         char *last = strrchr(music_path, '\\');
         if (last)
         {
             *last = '\0';
         }
+        _snprintf_s(ini_path, _countof(ini_path), _TRUNCATE, "%s\\winmm.ini", music_path);
         strncat_s(music_path, _countof(music_path) - 1, "\\MUSIC", 7);
+
+        // timer family first, the game may call it before any MCI command
+        tmr_init(
+            GetPrivateProfileIntA("winmm", "ClockSource", TMR_SOURCE_SYSTEM, ini_path),
+            GetPrivateProfileIntA("winmm", "IgnoreTimerPeriod", 0, ini_path));
+
+        mix_init(
+            GetPrivateProfileIntA("winmm", "SoftwareMixer", 0, ini_path),
+            GetPrivateProfileIntA("winmm", "MixerRate", 44100, ini_path));
+
+        st_init(GetPrivateProfileIntA("winmm", "Statistics", 0, ini_path));
+
+        plr_readahead(GetPrivateProfileIntA("winmm", "Readahead", 0, ini_path));
+
+        // before the track scan below opens anything
+        plr_allocator(GetPrivateProfileIntA("winmm", "Allocator", 0, ini_path));
 		
         dprintf("ogg-winmm music directory is %s\r\n", music_path);
         dprintf("ogg-winmm searching tracks...\r\n");
 
         unsigned int position = 0;
+        uint32_t scan_start = st_now_us();
 
         for (int i = 0; i < MAX_TRACKS; i++)
         {
@@ -319,6 +696,8 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
             }
         }
 
+        ST_SET(&st_shared->scan_us, st_now_us() - scan_start);
+
         dprintf("Emulating total of %d CD tracks.\r\n\r\n", numTracks);
 
         //Gets the current working directory, and creates a path containing it and the volumeBGM.txt file that we want to monitor for changes
@@ -327,8 +706,9 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
         const wchar_t* targetFileName = L"volumeBGM.txt";
         MonitorDirectory(directoryPath, targetFileName);
 
-        //Load the volume
-        setVolume();
+        //Load the volume, unless a launcher already set one through shared memory
+        if (!(GetPrivateProfileIntA("winmm", "VolumeChannel", 0, ini_path) && shareVolume()))
+            setVolume();
 
         fkAttach();
     }
@@ -355,6 +735,14 @@ MCIERROR WINAPI fake_mciSendCommandA(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR
 {
     dprintf("mciSendCommandA(IDDevice=%p, uMsg=%p, fdwCommand=%p, dwParam=%p)\r\n", IDDevice, uMsg, fdwCommand, dwParam);
 
+    st_mci(st_shared,
+        uMsg == MCI_OPEN ? ST_MCI_OPEN :
+        uMsg == MCI_CLOSE ? ST_MCI_CLOSE :
+        uMsg == MCI_PLAY ? ST_MCI_PLAY :
+        uMsg == MCI_STOP ? ST_MCI_STOP :
+        uMsg == MCI_SET ? ST_MCI_SET :
+        uMsg == MCI_STATUS ? ST_MCI_STATUS : ST_MCI_OTHER);
+
     if (fdwCommand & MCI_NOTIFY)
     {
         dprintf("  MCI_NOTIFY\r\n");
@@ -388,8 +776,7 @@ MCIERROR WINAPI fake_mciSendCommandA(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR
             if (LOWORD(parms->lpstrDeviceType) == MCI_DEVTYPE_CD_AUDIO)
             {
                 dprintf("  Returning magic device id for MCI_DEVTYPE_CD_AUDIO\r\n");
-                parms->wDeviceID = MAGIC_DEVICEID;
-                return 0;
+                return cd_open(fdwCommand & MCI_OPEN_ALIAS ? parms->lpstrAlias : NULL, &parms->wDeviceID);
             }
         }
 
@@ -401,14 +788,15 @@ MCIERROR WINAPI fake_mciSendCommandA(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR
             if (strcmp(parms->lpstrDeviceType, "cdaudio") == 0)
             {
                 dprintf("  Returning magic device id for MCI_DEVTYPE_CD_AUDIO\r\n");
-                parms->wDeviceID = MAGIC_DEVICEID;
-                return 0;
+                return cd_open(fdwCommand & MCI_OPEN_ALIAS ? parms->lpstrAlias : NULL, &parms->wDeviceID);
             }
         }
 
     }
 
-    if (IDDevice == MAGIC_DEVICEID || IDDevice == 0 || IDDevice == 0xFFFFFFFF)
+    struct cd_device *dev = cd_lookup(IDDevice);
+
+    if (dev)
     {
         if (uMsg == MCI_SET)
         {
@@ -420,7 +808,7 @@ MCIERROR WINAPI fake_mciSendCommandA(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR
             {
                 dprintf("    MCI_SET_TIME_FORMAT\r\n");
 
-                time_format = parms->dwTimeFormat;
+                dev->time_format = parms->dwTimeFormat;
 
                 if (parms->dwTimeFormat == MCI_FORMAT_BYTES)
                 {
@@ -463,21 +851,25 @@ MCIERROR WINAPI fake_mciSendCommandA(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR
         {
             dprintf("  MCI_CLOSE\r\n");
 
-            if (player)
+            if (IDDevice == MCI_ALL_DEVICE_ID)
             {
-                ResumeThread(player); //just in case it's suspended, else deadlock
-                closed = 1;
-                playing = 0;
+                for (int i = 0; i < CD_DEVICES; i++)
+                    cd_close(&devices[i]);
+            }
+            else
+            {
+                cd_close(dev);
             }
-
-            playing = 0;
-            player = NULL;
         }
 
         if (uMsg == MCI_PLAY)
         {
             LPMCI_PLAY_PARMS parms = (LPMCI_PLAY_PARMS)dwParam;
 
+            EnterCriticalSection(&cs);
+            struct play_info info = dev->info;
+            LeaveCriticalSection(&cs);
+
             dprintf("  MCI_PLAY\r\n");
 
             if (fdwCommand & MCI_FROM)
@@ -493,7 +885,7 @@ MCIERROR WINAPI fake_mciSendCommandA(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR
                 dprintf("    dwFrom: %d\r\n", parms->dwFrom);
 
 				// FIXME: rounding to nearest track
-				if (time_format == MCI_FORMAT_TMSF)
+				if (dev->time_format == MCI_FORMAT_TMSF)
 				{
 					info.first = MCI_TMSF_TRACK(parms->dwFrom);
 
@@ -502,7 +894,7 @@ MCIERROR WINAPI fake_mciSendCommandA(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR
 					dprintf("      SECOND %d\n", MCI_TMSF_SECOND(parms->dwFrom));
 					dprintf("      FRAME  %d\n", MCI_TMSF_FRAME(parms->dwFrom));
 				}
-				else if (time_format == MCI_FORMAT_MILLISECONDS)
+				else if (dev->time_format == MCI_FORMAT_MILLISECONDS)
 				{
 					info.first = 0;
 
@@ -536,7 +928,7 @@ MCIERROR WINAPI fake_mciSendCommandA(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR
             {
                 dprintf("    dwTo:   %d\r\n", parms->dwTo);
 
-				if (time_format == MCI_FORMAT_TMSF)
+				if (dev->time_format == MCI_FORMAT_TMSF)
 				{
 					info.last = MCI_TMSF_TRACK(parms->dwTo);
 
@@ -545,7 +937,7 @@ MCIERROR WINAPI fake_mciSendCommandA(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR
 					dprintf("      SECOND %d\n", MCI_TMSF_SECOND(parms->dwTo));
 					dprintf("      FRAME  %d\n", MCI_TMSF_FRAME(parms->dwTo));
 				}
-				else if (time_format == MCI_FORMAT_MILLISECONDS)
+				else if (dev->time_format == MCI_FORMAT_MILLISECONDS)
 				{
 					info.last = info.first;
 
@@ -579,23 +971,33 @@ MCIERROR WINAPI fake_mciSendCommandA(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR
 			dprintf("      info.first : %d\r\n", info.first);
 			dprintf("      info.last : %d\r\n", info.last);
 
+            EnterCriticalSection(&cs);
+            dev->info = info;
+
+            if (fdwCommand & MCI_FROM)
+            {
+                //picked up by whichever worker gets to the device first
+                dev->update = 1;
+                dev->playing = 1;
+            }
+            LeaveCriticalSection(&cs);
+
             if (fdwCommand & MCI_FROM)
             {
-                updateTrack = 1;
-                playing = 1;
-
-                //track info is now a global variable for live updating
-                if (player == NULL)
-                    player = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)player_main, NULL, 0, NULL);
-                else
-                    ResumeThread(player);
+                cd_spawn_workers();
+                SetEvent(cd_ev);
             }
         }
 
         if (uMsg == MCI_STOP)
         {
             dprintf("  MCI_STOP\r\n");
-			playing = 0;
+
+            EnterCriticalSection(&cs);
+            dev->playing = 0;
+            LeaveCriticalSection(&cs);
+
+            SetEvent(cd_ev);
         }
 
         if (uMsg == MCI_STATUS)
@@ -629,7 +1031,7 @@ MCIERROR WINAPI fake_mciSendCommandA(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR
 
                     if (seconds)
                     {
-                        if (time_format == MCI_FORMAT_MILLISECONDS)
+                        if (dev->time_format == MCI_FORMAT_MILLISECONDS)
                         {
                             parms->dwReturn = seconds * 1000;
                         }
@@ -671,9 +1073,9 @@ MCIERROR WINAPI fake_mciSendCommandA(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR
                 if (parms->dwItem == MCI_STATUS_MODE)
                 {
                     dprintf("      MCI_STATUS_MODE\r\n");
-                    dprintf("        we are %s\r\n", playing ? "playing" : "NOT playing");
+                    dprintf("        we are %s\r\n", dev->playing ? "playing" : "NOT playing");
 
-                    parms->dwReturn = playing ? MCI_MODE_PLAY : MCI_MODE_STOP;
+                    parms->dwReturn = dev->playing ? MCI_MODE_PLAY : MCI_MODE_STOP;
                 }
 
                 if (parms->dwItem == MCI_STATUS_READY)
@@ -755,6 +1157,8 @@ MCIERROR WINAPI fake_mciSendStringA(LPCTSTR cmd, LPTSTR ret, UINT cchReturn, HAN
 {
 	dprintf("MCI-SendStringA: %s\n", cmd);
 
+	st_mci(st_shared, ST_MCI_STRING);
+
 	// Change string to lower-case
 	char *cmdbuf = _strdup(cmd); // Prevents cmd readonly error
 	for (int i = 0; cmdbuf[i]; i++)
@@ -775,10 +1179,35 @@ MCIERROR WINAPI fake_mciSendStringA(LPCTSTR cmd, LPTSTR ret, UINT cchReturn, HAN
 	if (com && strcmp(com, "open") == 0)
 	{
 		com = strtok_s(NULL, " ,.-", &cmdbuf);
-		if (com && strcmp(com, "cdaudio") == 0)
+		char *alias = NULL;
+		int cdaudio = com && strcmp(com, "cdaudio") == 0;
+
+		// open <device> [type cdaudio] [alias <name>] [wait] [shareable]
+		char *opt;
+		while ((opt = strtok_s(NULL, " ,.-", &cmdbuf)) != NULL)
+		{
+			char *arg = NULL;
+
+			if (strcmp(opt, "type") == 0 || strcmp(opt, "alias") == 0)
+				arg = strtok_s(NULL, " ,.-", &cmdbuf);
+
+			if (arg && strcmp(opt, "type") == 0 && strcmp(arg, "cdaudio") == 0)
+				cdaudio = 1;
+
+			if (arg && strcmp(opt, "alias") == 0)
+				alias = arg;
+		}
+
+		if (cdaudio)
 		{
+			MCIDEVICEID id;
+			MCIERROR err = cd_open(alias, &id);
+
+			if (err)
+				return err;
+
 			dprintf("  Returning magic device id for MCI_DEVTYPE_CD_AUDIO\r\n");
-			_itoa_s(MAGIC_DEVICEID, ret, cchReturn, 16);
+			_itoa_s(id, ret, cchReturn, 16);
 			return MMSYSERR_NOERROR;
 		}
 		return MMSYSERR_NOERROR;
@@ -788,7 +1217,8 @@ MCIERROR WINAPI fake_mciSendStringA(LPCTSTR cmd, LPTSTR ret, UINT cchReturn, HAN
 	if (com && strcmp(com, "set") == 0)
 	{
 		com = strtok_s(NULL, " ,.-", &cmdbuf); // Get next token
-		if (com) { // TODO: FIX: Accept everything. This may bring unexpected behaviour
+		if (com) { // Device name or alias
+			MCIDEVICEID id = cd_find(com);
 			com = strtok_s(NULL, " ,.-", &cmdbuf); // Get next token
 
 			// TIME
@@ -806,7 +1236,7 @@ MCIERROR WINAPI fake_mciSendStringA(LPCTSTR cmd, LPTSTR ret, UINT cchReturn, HAN
 					if (com && strcmp(com, "milliseconds") == 0)
 					{
 						parms.dwTimeFormat = MCI_FORMAT_MILLISECONDS;
-						fake_mciSendCommandA(MAGIC_DEVICEID, MCI_SET, MCI_SET_TIME_FORMAT, (DWORD_PTR)&parms);
+						fake_mciSendCommandA(id, MCI_SET, MCI_SET_TIME_FORMAT, (DWORD_PTR)&parms);
 						return MMSYSERR_NOERROR;
 					}
 
@@ -814,7 +1244,7 @@ MCIERROR WINAPI fake_mciSendStringA(LPCTSTR cmd, LPTSTR ret, UINT cchReturn, HAN
 					if (com && strcmp(com, "msf") == 0)
 					{
 						parms.dwTimeFormat = MCI_FORMAT_MSF;
-						fake_mciSendCommandA(MAGIC_DEVICEID, MCI_SET, MCI_SET_TIME_FORMAT, (DWORD_PTR)&parms);
+						fake_mciSendCommandA(id, MCI_SET, MCI_SET_TIME_FORMAT, (DWORD_PTR)&parms);
 						return MMSYSERR_NOERROR;
 					}
 
@@ -822,7 +1252,7 @@ MCIERROR WINAPI fake_mciSendStringA(LPCTSTR cmd, LPTSTR ret, UINT cchReturn, HAN
 					if (com && strcmp(com, "tmsf") == 0)
 					{
 						parms.dwTimeFormat = MCI_FORMAT_TMSF;
-						fake_mciSendCommandA(MAGIC_DEVICEID, MCI_SET, MCI_SET_TIME_FORMAT, (DWORD_PTR)&parms);
+						fake_mciSendCommandA(id, MCI_SET, MCI_SET_TIME_FORMAT, (DWORD_PTR)&parms);
 						return MMSYSERR_NOERROR;
 					}
 				}
@@ -838,7 +1268,8 @@ MCIERROR WINAPI fake_mciSendStringA(LPCTSTR cmd, LPTSTR ret, UINT cchReturn, HAN
 	{
 		com = strtok_s(NULL, " ,.-", &cmdbuf); // Get next token
 
-		if (com) { // TODO: FIX: Accept everything. This may bring unexpected behaviour
+		if (com) { // Device name or alias
+			MCIDEVICEID id = cd_find(com);
 			com = strtok_s(NULL, " ,.-", &cmdbuf); // Get next token
 			MCI_STATUS_PARMS parms;
 
@@ -856,7 +1287,7 @@ MCIERROR WINAPI fake_mciSendStringA(LPCTSTR cmd, LPTSTR ret, UINT cchReturn, HAN
 					// (INT) TRACK NUMBER
 					if (com) { // TODO: Check if this is an INTEGER (Number)
 						parms.dwTrack = atoi(com);
-						fake_mciSendCommandA(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM, (DWORD_PTR)&parms);
+						fake_mciSendCommandA(id, MCI_STATUS, MCI_STATUS_ITEM, (DWORD_PTR)&parms);
 						_itoa_s(parms.dwReturn, ret, cchReturn, 10); // Response
 						return MMSYSERR_NOERROR;
 					}
@@ -880,7 +1311,7 @@ MCIERROR WINAPI fake_mciSendStringA(LPCTSTR cmd, LPTSTR ret, UINT cchReturn, HAN
 					if (com)
 					{ // TODO: Check if this is an INTEGER (Number)
 						parms.dwTrack = atoi(com);
-						fake_mciSendCommandA(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM | MCI_TRACK, (DWORD_PTR)&parms);
+						fake_mciSendCommandA(id, MCI_STATUS, MCI_STATUS_ITEM | MCI_TRACK, (DWORD_PTR)&parms);
 						_itoa_s(parms.dwReturn, ret, cchReturn, 10); // Response
 						return MMSYSERR_NOERROR;
 					}
@@ -920,7 +1351,8 @@ MCIERROR WINAPI fake_mciSendStringA(LPCTSTR cmd, LPTSTR ret, UINT cchReturn, HAN
 	{
 		com = strtok_s(NULL, " ,.-", &cmdbuf); // Get next token
 
-		if (com) { // TODO: FIX: Accept everything. This may bring unexpected behaviour
+		if (com) { // Device name or alias
+			MCIDEVICEID id = cd_find(com);
 			com = strtok_s(NULL, " ,.-", &cmdbuf); // Get next token
 
 			// FROM
@@ -949,7 +1381,7 @@ MCIERROR WINAPI fake_mciSendStringA(LPCTSTR cmd, LPTSTR ret, UINT cchReturn, HAN
 							static MCI_PLAY_PARMS parms;
 							parms.dwFrom = posFrom;
 							parms.dwTo = posTo;
-							fake_mciSendCommandA(MAGIC_DEVICEID, MCI_PLAY, MCI_FROM | MCI_TO, (DWORD_PTR)&parms);
+							fake_mciSendCommandA(id, MCI_PLAY, MCI_FROM | MCI_TO, (DWORD_PTR)&parms);
 							//free(posFrom); // ???
 							//free(posTo); // ???
 							return MMSYSERR_NOERROR;
@@ -960,7 +1392,7 @@ MCIERROR WINAPI fake_mciSendStringA(LPCTSTR cmd, LPTSTR ret, UINT cchReturn, HAN
 						// No TO position specified
 						static MCI_PLAY_PARMS parms;
 						parms.dwFrom = posFrom;
-						fake_mciSendCommandA(MAGIC_DEVICEID, MCI_PLAY, MCI_FROM, (DWORD_PTR)&parms);
+						fake_mciSendCommandA(id, MCI_PLAY, MCI_FROM, (DWORD_PTR)&parms);
 						return MMSYSERR_NOERROR;
 					}
 				}
@@ -973,15 +1405,15 @@ MCIERROR WINAPI fake_mciSendStringA(LPCTSTR cmd, LPTSTR ret, UINT cchReturn, HAN
 
 	// STOP
 	if (com && strcmp(com, "stop") == 0) {
-		// TODO: No support for ALIASES
-		fake_mciSendCommandA(MAGIC_DEVICEID, MCI_STOP, 0, (DWORD_PTR)NULL);
+		com = strtok_s(NULL, " ,.-", &cmdbuf); // Device name or alias
+		fake_mciSendCommandA(cd_find(com), MCI_STOP, 0, (DWORD_PTR)NULL);
 		return 0;
 	}
 
 	// CLOSE
 	if (com && strcmp(com, "close") == 0) {
-		// TODO: No support for ALIASES
-		fake_mciSendCommandA(MAGIC_DEVICEID, MCI_CLOSE, 0, (DWORD_PTR)NULL);
+		com = strtok_s(NULL, " ,.-", &cmdbuf); // Device name or alias
+		fake_mciSendCommandA(com && strcmp(com, "all") == 0 ? MCI_ALL_DEVICE_ID : cd_find(com), MCI_CLOSE, 0, (DWORD_PTR)NULL);
 		return 0;
 	}
 
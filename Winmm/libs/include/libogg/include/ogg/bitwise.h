@@ -0,0 +1,105 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: inline oggpack readers for decoder inner loops
+
+ ********************************************************************/
+#ifndef _OGG_BITWISE_H
+#define _OGG_BITWISE_H
+
+#include <string.h>
+#include "ogg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Drop-in equivalents of oggpack_look, oggpack_adv and oggpack_read
+   (LSb first, bits <= 32) that compile into the caller. They work on
+   a plain oggpack_buffer, mixing them with the library calls is fine.
+
+   On little endian hosts with cheap unaligned loads, whenever eight
+   bytes remain the next 32+7 bits come from a single 64 bit load and a
+   shift instead of being put together a byte at a time. Near the end
+   of the buffer, and on other hosts, they call the library. */
+
+#if defined(_MSC_VER)
+#  define OGGPACK_INLINE static __inline
+#elif defined(__GNUC__)
+#  define OGGPACK_INLINE static __inline__
+#else
+#  define OGGPACK_INLINE static
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86) || defined(_M_ARM64) || \
+    (defined(__aarch64__) && !defined(__AARCH64EB__))
+#  define OGGPACK_LOAD64
+#endif
+
+#ifdef OGGPACK_LOAD64
+
+/* at least eight bytes left to read at b->ptr */
+#define oggpack_has64(b) ((b)->storage-(b)->endbyte>=8)
+
+/* the next 0 to 32 bits; only valid when oggpack_has64. Not every
+   platform has ogg_uint64_t; the sign bit of w never reaches the
+   result, at most bit 38 does. */
+OGGPACK_INLINE long oggpack_look64(oggpack_buffer *b,int bits){
+  ogg_int64_t w;
+  memcpy(&w,b->ptr,8);
+  return (long)(unsigned long)((w>>b->endbit)&
+                               (((ogg_int64_t)1<<bits)-1));
+}
+
+#endif
+
+OGGPACK_INLINE long oggpack_look_fast(oggpack_buffer *b,int bits){
+#ifdef OGGPACK_LOAD64
+  if(oggpack_has64(b) && (unsigned)bits<=32)
+    return oggpack_look64(b,bits);
+#endif
+  return oggpack_look(b,bits);
+}
+
+OGGPACK_INLINE void oggpack_adv_fast(oggpack_buffer *b,int bits){
+#ifdef OGGPACK_LOAD64
+  if(oggpack_has64(b) && (unsigned)bits<=32){
+    bits+=b->endbit;
+    b->ptr+=bits>>3;
+    b->endbyte+=bits>>3;
+    b->endbit=bits&7;
+    return;
+  }
+#endif
+  oggpack_adv(b,bits);
+}
+
+OGGPACK_INLINE long oggpack_read_fast(oggpack_buffer *b,int bits){
+#ifdef OGGPACK_LOAD64
+  if(oggpack_has64(b) && (unsigned)bits<=32){
+    long ret=oggpack_look64(b,bits);
+    bits+=b->endbit;
+    b->ptr+=bits>>3;
+    b->endbyte+=bits>>3;
+    b->endbit=bits&7;
+    return ret;
+  }
+#endif
+  return oggpack_read(b,bits);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _OGG_BITWISE_H */
@@ -0,0 +1,78 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: CPU features for the SIMD kernels of libogg and libvorbis
+
+ ********************************************************************/
+#ifndef _OGG_CPU_H
+#define _OGG_CPU_H
+
+#include "ogg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Kernels with vector variants build them for OGG_ARCH_X86 or
+   OGG_ARCH_ARM64, mark each variant with the OGG_TARGET_ that lets the
+   compiler use its instructions, and pick one at run time from
+   ogg_cpu_features. */
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86)
+#  define OGG_ARCH_X86
+#elif (defined(__aarch64__) && !defined(__AARCH64EB__)) || \
+      defined(_M_ARM64)
+#  define OGG_ARCH_ARM64
+#endif
+
+/* ogg_cpu_features bits */
+#define OGG_CPU_SSE2   0x01
+#define OGG_CPU_SSSE3  0x02
+#define OGG_CPU_PCLMUL 0x04
+#define OGG_CPU_AVX2   0x08 /* and the OS saves the AVX state */
+#define OGG_CPU_NEON   0x10
+#define OGG_CPU_PMULL  0x20
+
+/* MSVC takes any instruction anywhere; gcc and clang want functions
+   using more than the file is built for marked. SSE2 is in every
+   x86_64 build already. */
+#if defined(OGG_ARCH_X86) && defined(__GNUC__)
+#  if defined(__x86_64__)
+#    define OGG_TARGET_SSE2
+#  else
+#    define OGG_TARGET_SSE2 __attribute__((target("sse2")))
+#  endif
+#  define OGG_TARGET_AVX2   __attribute__((target("avx2")))
+#  define OGG_TARGET_PCLMUL __attribute__((target("pclmul,ssse3")))
+#else
+#  define OGG_TARGET_SSE2
+#  define OGG_TARGET_AVX2
+#  define OGG_TARGET_PCLMUL
+#endif
+
+#if defined(OGG_ARCH_ARM64) && defined(__clang__)
+#  define OGG_TARGET_PMULL __attribute__((target("aes")))
+#elif defined(OGG_ARCH_ARM64) && defined(__GNUC__)
+#  define OGG_TARGET_PMULL __attribute__((target("+crypto")))
+#else
+#  define OGG_TARGET_PMULL
+#endif
+
+/* the OGG_CPU_ bits this CPU has; asks the CPU once */
+extern int ogg_cpu_features(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OGG_CPU_H */
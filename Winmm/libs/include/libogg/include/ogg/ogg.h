@@ -113,6 +113,31 @@ typedef struct {
   int bodybytes;
 } ogg_sync_state;
 
+/* ogg_allocator is where _ogg_malloc and friends get their memory;
+   every block remembers the allocator it came from and goes back to
+   it, whichever one is in use when it's freed. resize gets the old
+   and new sizes, release the size, as the library asked for them. */
+
+typedef struct ogg_allocator {
+  void *(*alloc)(void *ctx,size_t bytes);
+  void *(*resize)(void *ctx,void *ptr,size_t old,size_t bytes);
+  void  (*release)(void *ctx,void *ptr,size_t bytes);
+  void  *ctx;
+} ogg_allocator;
+
+typedef struct ogg_pool ogg_pool;
+
+/* allocations counted by where they were made, in libraries built
+   with OGG_ALLOC_SITES */
+typedef struct {
+  const char *file;
+  int         line;
+  long        calls;  /* allocations and reallocations made there */
+  long        blocks; /* of those, still live */
+  size_t      bytes;
+  size_t      peak;   /* most bytes live at once */
+} ogg_alloc_site;
+
 /* Ogg BITSTREAM PRIMITIVES: bitstream ************************/
 
 extern void  oggpack_writeinit(oggpack_buffer *b);
@@ -202,6 +227,26 @@ extern int      ogg_page_packets(const ogg_page *og);
 
 extern void     ogg_packet_clear(ogg_packet *op);
 
+/* Ogg BITSTREAM PRIMITIVES: memory ****************************/
+
+extern void    *ogg_malloc(size_t bytes);
+extern void    *ogg_calloc(size_t count,size_t bytes);
+extern void    *ogg_realloc(void *ptr,size_t bytes);
+extern void     ogg_free(void *ptr);
+extern void    *ogg_malloc_at(size_t bytes,const char *file,int line);
+extern void    *ogg_calloc_at(size_t count,size_t bytes,const char *file,
+                              int line);
+extern void    *ogg_realloc_at(void *ptr,size_t bytes,const char *file,
+                               int line);
+
+extern void     ogg_set_allocator(const ogg_allocator *a);
+extern const ogg_allocator *ogg_use_allocator(const ogg_allocator *a);
+extern int      ogg_alloc_sites(ogg_alloc_site *sites,int n);
+
+extern ogg_pool *ogg_pool_create(const ogg_allocator *backing);
+extern void     ogg_pool_destroy(ogg_pool *p);
+extern const ogg_allocator *ogg_pool_allocator(ogg_pool *p);
+
 
 #ifdef __cplusplus
 }
@@ -17,12 +17,18 @@
 #ifndef _OS_TYPES_H
 #define _OS_TYPES_H
 
-/* make it easy on the folks that want to compile the libs with a
-   different malloc than stdlib */
-#define _ogg_malloc  malloc
-#define _ogg_calloc  calloc
-#define _ogg_realloc realloc
-#define _ogg_free    free
+/* everything the libs allocate goes through ogg_malloc and friends,
+   see ogg_set_allocator; OGG_ALLOC_SITES counts it by call site */
+#ifdef OGG_ALLOC_SITES
+#define _ogg_malloc(x)    ogg_malloc_at((x),__FILE__,__LINE__)
+#define _ogg_calloc(x,y)  ogg_calloc_at((x),(y),__FILE__,__LINE__)
+#define _ogg_realloc(x,y) ogg_realloc_at((x),(y),__FILE__,__LINE__)
+#else
+#define _ogg_malloc  ogg_malloc
+#define _ogg_calloc  ogg_calloc
+#define _ogg_realloc ogg_realloc
+#endif
+#define _ogg_free    ogg_free
 
 #if defined(_WIN32)
 
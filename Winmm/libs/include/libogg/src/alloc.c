@@ -0,0 +1,643 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE Ogg CONTAINER SOURCE CODE.              *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2010             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: allocator hooks for libogg and the libraries built on it,
+           a size-class pool allocator, and counting by call site
+
+ ********************************************************************/
+
+/* Every block handed out carries a small header naming the allocator
+   it came from and its size, so a block always goes back where it came
+   from however the allocators change in between, and pools and
+   counters know sizes without keeping their own books.
+
+   The allocator used for a new block is the calling thread's, if
+   ogg_use_allocator gave it one, else the process-wide one from
+   ogg_set_allocator, else the C heap. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ogg/ogg.h>
+
+#if defined(_WIN32)
+#  define ALLOC_WIN32
+#  include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#  include <unistd.h>
+#  if defined(_POSIX_THREADS) && _POSIX_THREADS>0
+#    define ALLOC_PTHREAD
+#    include <pthread.h>
+#  endif
+#endif
+
+typedef union {
+  struct {
+    const ogg_allocator *owner;
+    ogg_uint32_t         bytes;
+    int                  site; /* sites[site-1], 0 when not counted */
+  } h;
+  double align[2]; /* keeps blocks as aligned as the allocator made them */
+} alloc_head;
+
+#define ALLOC_MAX (0xffffffffUL-sizeof(alloc_head))
+
+/* the C heap ***************************************************/
+
+static void *heap_alloc(void *ctx,size_t bytes){
+  return malloc(bytes);
+}
+
+static void *heap_resize(void *ctx,void *ptr,size_t old,size_t bytes){
+  return realloc(ptr,bytes);
+}
+
+static void heap_release(void *ctx,void *ptr,size_t bytes){
+  free(ptr);
+}
+
+static const ogg_allocator heap={heap_alloc,heap_resize,heap_release,NULL};
+static const ogg_allocator *process=&heap;
+
+/* locks and the per thread allocator ***************************/
+
+#if defined(ALLOC_WIN32)
+
+typedef CRITICAL_SECTION alloc_lock;
+#define lock_init(l)    InitializeCriticalSection(l)
+#define lock_clear(l)   DeleteCriticalSection(l)
+#define lock_take(l)    EnterCriticalSection(l)
+#define lock_give(l)    LeaveCriticalSection(l)
+
+static DWORD         tls=TLS_OUT_OF_INDEXES;
+static volatile LONG tls_once;
+
+/* nothing here has a static initializer; the first caller makes them
+   and any racing one waits */
+static alloc_lock sites_cs;
+
+static void once(void){
+  if(tls_once!=2){
+    if(InterlockedCompareExchange(&tls_once,1,0)==0){
+      tls=TlsAlloc();
+      InitializeCriticalSection(&sites_cs);
+      InterlockedExchange(&tls_once,2);
+    }else
+      while(tls_once!=2)Sleep(0);
+  }
+}
+
+static const ogg_allocator *thread_get(void){
+  /* no thread has been given one before the index exists */
+  if(tls_once!=2 || tls==TLS_OUT_OF_INDEXES)return NULL;
+  return TlsGetValue(tls);
+}
+
+static void thread_set(const ogg_allocator *a){
+  once();
+  if(tls!=TLS_OUT_OF_INDEXES)TlsSetValue(tls,(void *)a);
+}
+
+static void sites_take(void){
+  once();
+  EnterCriticalSection(&sites_cs);
+}
+
+#define sites_give() LeaveCriticalSection(&sites_cs)
+
+#elif defined(ALLOC_PTHREAD)
+
+typedef pthread_mutex_t alloc_lock;
+#define lock_init(l)    pthread_mutex_init(l,NULL)
+#define lock_clear(l)   pthread_mutex_destroy(l)
+#define lock_take(l)    pthread_mutex_lock(l)
+#define lock_give(l)    pthread_mutex_unlock(l)
+
+static pthread_once_t  tls_once=PTHREAD_ONCE_INIT;
+static pthread_key_t   tls;
+static int             tls_made;
+static pthread_mutex_t sites_mutex=PTHREAD_MUTEX_INITIALIZER;
+
+static void tls_init(void){
+  tls_made=!pthread_key_create(&tls,NULL);
+}
+
+static const ogg_allocator *thread_get(void){
+  pthread_once(&tls_once,tls_init);
+  return tls_made?pthread_getspecific(tls):NULL;
+}
+
+static void thread_set(const ogg_allocator *a){
+  pthread_once(&tls_once,tls_init);
+  if(tls_made)pthread_setspecific(tls,a);
+}
+
+#define sites_take() pthread_mutex_lock(&sites_mutex)
+#define sites_give() pthread_mutex_unlock(&sites_mutex)
+
+#else
+
+/* no threads; one of everything */
+
+typedef int alloc_lock;
+#define lock_init(l)
+#define lock_clear(l)
+#define lock_take(l)
+#define lock_give(l)
+
+static const ogg_allocator *thread;
+
+#define thread_get()  thread
+#define thread_set(a) (thread=(a))
+#define sites_take()
+#define sites_give()
+
+#endif
+
+/* counting by call site ****************************************/
+
+#define SITES 1024 /* a power of two; more than the libs have */
+
+static ogg_alloc_site sites[SITES];
+
+/* an index+1 into sites for file:line, 0 if it's full. Sites are
+   known by their string's address; a compiler that doesn't pool the
+   strings of a file just costs a strcmp. Called locked. */
+static int site_find(const char *file,int line){
+  unsigned long h=((unsigned long)line*2654435761UL)>>8;
+  int i,j;
+  for(i=0;file[i];i++)h=h*31+(unsigned char)file[i];
+  for(j=0;j<SITES;j++){
+    ogg_alloc_site *s=sites+((h+j)&(SITES-1));
+    if(!s->file){
+      s->file=file;
+      s->line=line;
+      return (int)(s-sites)+1;
+    }
+    if(s->line==line && (s->file==file || !strcmp(s->file,file)))
+      return (int)(s-sites)+1;
+  }
+  return 0;
+}
+
+static int site_add(const char *file,int line,size_t bytes){
+  ogg_alloc_site *s;
+  int site;
+  sites_take();
+  site=site_find(file,line);
+  if(site){
+    s=sites+site-1;
+    s->calls++;
+    s->blocks++;
+    s->bytes+=bytes;
+    if(s->bytes>s->peak)s->peak=s->bytes;
+  }
+  sites_give();
+  return site;
+}
+
+static void site_sub(int site,size_t bytes){
+  sites_take();
+  sites[site-1].blocks--;
+  sites[site-1].bytes-=bytes;
+  sites_give();
+}
+
+/* fills sites with up to n of the sites counted so far, in no
+   particular order, and returns how many there are */
+int ogg_alloc_sites(ogg_alloc_site *out,int n){
+  int i,count=0;
+  sites_take();
+  for(i=0;i<SITES;i++)
+    if(sites[i].file){
+      if(count<n)out[count]=sites[i];
+      count++;
+    }
+  sites_give();
+  return count;
+}
+
+/* the hooks ****************************************************/
+
+/* a is the process-wide allocator from now on; NULL goes back to the
+   C heap. Blocks already out still go back to where they came from,
+   so a must stay usable until they have. */
+void ogg_set_allocator(const ogg_allocator *a){
+  process=a?a:&heap;
+}
+
+/* gives the calling thread an allocator of its own, for a decoder to
+   keep a stream's memory together; NULL goes back to the process-wide
+   one. Returns the thread's previous allocator, for putting back. */
+const ogg_allocator *ogg_use_allocator(const ogg_allocator *a){
+  const ogg_allocator *prev=thread_get();
+  thread_set(a);
+  return prev;
+}
+
+static const ogg_allocator *current(void){
+  const ogg_allocator *a=thread_get();
+  return a?a:process;
+}
+
+void *ogg_malloc_at(size_t bytes,const char *file,int line){
+  const ogg_allocator *a=current();
+  alloc_head *h;
+
+  if(bytes>ALLOC_MAX)return NULL;
+  h=a->alloc(a->ctx,bytes+sizeof(*h));
+  if(!h)return NULL;
+  h->h.owner=a;
+  h->h.bytes=(ogg_uint32_t)bytes;
+  h->h.site=file?site_add(file,line,bytes):0;
+  return h+1;
+}
+
+void *ogg_calloc_at(size_t count,size_t bytes,const char *file,int line){
+  void *ptr;
+  if(bytes && count>ALLOC_MAX/bytes)return NULL;
+  ptr=ogg_malloc_at(count*bytes,file,line);
+  if(ptr)memset(ptr,0,count*bytes);
+  return ptr;
+}
+
+/* the block keeps its allocator; it's counted where it was last
+   resized */
+void *ogg_realloc_at(void *ptr,size_t bytes,const char *file,int line){
+  const ogg_allocator *a;
+  alloc_head *h;
+  size_t old;
+  int site;
+
+  if(!ptr)return ogg_malloc_at(bytes,file,line);
+  if(bytes>ALLOC_MAX)return NULL;
+  h=(alloc_head *)ptr-1;
+  a=h->h.owner;
+  old=h->h.bytes;
+  site=h->h.site;
+
+  h=a->resize(a->ctx,h,old+sizeof(*h),bytes+sizeof(*h));
+  if(!h)return NULL;
+  h->h.bytes=(ogg_uint32_t)bytes;
+  if(site)site_sub(site,old);
+  h->h.site=file?site_add(file,line,bytes):0;
+  return h+1;
+}
+
+void *ogg_malloc(size_t bytes){
+  return ogg_malloc_at(bytes,NULL,0);
+}
+
+void *ogg_calloc(size_t count,size_t bytes){
+  return ogg_calloc_at(count,bytes,NULL,0);
+}
+
+void *ogg_realloc(void *ptr,size_t bytes){
+  return ogg_realloc_at(ptr,bytes,NULL,0);
+}
+
+void ogg_free(void *ptr){
+  const ogg_allocator *a;
+  alloc_head *h;
+
+  if(!ptr)return;
+  h=(alloc_head *)ptr-1;
+  a=h->h.owner;
+  if(h->h.site)site_sub(h->h.site,h->h.bytes);
+  a->release(a->ctx,h,h->h.bytes+sizeof(*h));
+}
+
+/* pools ********************************************************/
+
+/* Blocks up to POOL_LARGEST bytes are carved from POOL_SLAB byte slabs
+   and kept on a free list per size class once released, so the
+   backing allocator sees one request per slab rather than one per
+   block, and a pool that comes and goes with a stream hands back a
+   few slabs instead of a heap full of holes. Classes are quarter
+   powers of two plus the 16 byte block header, since the libs mostly
+   ask for power of two payloads and those would otherwise land just
+   past a class; above 128 bytes that wastes under a fifth. Bigger
+   blocks go to the backing allocator one by one, on a list so
+   destroying the pool can find them. Slabs stay with the pool until
+   it's destroyed. */
+
+#define POOL_SLAB    65536
+#define POOL_LARGEST 16400
+#define POOL_CLASSES 37
+
+static const unsigned short pool_sizes[POOL_CLASSES]={
+  16,32,48,64,80,96,112,128,144,176,208,240,272,336,400,464,528,656,
+  784,912,1040,1296,1552,1808,2064,2576,3088,3600,4112,5136,6160,7184,
+  8208,10256,12304,14352,16400
+};
+
+typedef struct pool_large {
+  struct pool_large *prev;
+  struct pool_large *next;
+  size_t             bytes; /* with this header */
+} pool_large;
+
+/* headers rounded up so blocks keep the backing allocator's alignment */
+#define LARGE_HEAD ((sizeof(pool_large)+15)&~(size_t)15)
+#define SLAB_HEAD  16
+
+struct ogg_pool {
+  ogg_allocator        a;  /* a.ctx is the pool */
+  const ogg_allocator *backing;
+  alloc_lock           lock;
+
+  void                *free[POOL_CLASSES];
+  unsigned char       *bump; /* the uncarved end of the newest slab */
+  size_t               left;
+  void                *slabs;
+  pool_large          *large;
+};
+
+static int pool_class(size_t bytes){
+  int c=0;
+  while(pool_sizes[c]<bytes)c++;
+  return c;
+}
+
+/* leftovers too small for the class that wanted a new slab go on the
+   free lists of the classes they do fit */
+static void pool_spill(ogg_pool *p){
+  int c=POOL_CLASSES-1;
+  while(p->left>=pool_sizes[0]){
+    while(pool_sizes[c]>p->left)c--;
+    *(void **)p->bump=p->free[c];
+    p->free[c]=p->bump;
+    p->bump+=pool_sizes[c];
+    p->left-=pool_sizes[c];
+  }
+}
+
+static void *pool_alloc(void *ctx,size_t bytes){
+  ogg_pool *p=ctx;
+  void *ptr=NULL;
+
+  if(bytes>POOL_LARGEST){
+    pool_large *l=p->backing->alloc(p->backing->ctx,bytes+LARGE_HEAD);
+    if(!l)return NULL;
+    l->bytes=bytes+LARGE_HEAD;
+    l->prev=NULL;
+    lock_take(&p->lock);
+    l->next=p->large;
+    if(l->next)l->next->prev=l;
+    p->large=l;
+    lock_give(&p->lock);
+    return (unsigned char *)l+LARGE_HEAD;
+  }
+
+  lock_take(&p->lock);
+  {
+    int c=pool_class(bytes);
+    size_t size=pool_sizes[c];
+    if(p->free[c]){
+      ptr=p->free[c];
+      p->free[c]=*(void **)ptr;
+    }else{
+      if(p->left<size){
+        unsigned char *slab=p->backing->alloc(p->backing->ctx,POOL_SLAB);
+        if(slab){
+          pool_spill(p);
+          *(void **)slab=p->slabs;
+          p->slabs=slab;
+          p->bump=slab+SLAB_HEAD;
+          p->left=POOL_SLAB-SLAB_HEAD;
+        }
+      }
+      if(p->left>=size){
+        ptr=p->bump;
+        p->bump+=size;
+        p->left-=size;
+      }
+    }
+  }
+  lock_give(&p->lock);
+  return ptr;
+}
+
+static void pool_release(void *ctx,void *ptr,size_t bytes){
+  ogg_pool *p=ctx;
+
+  if(bytes>POOL_LARGEST){
+    pool_large *l=(pool_large *)((unsigned char *)ptr-LARGE_HEAD);
+    lock_take(&p->lock);
+    if(l->prev)l->prev->next=l->next;
+    else p->large=l->next;
+    if(l->next)l->next->prev=l->prev;
+    lock_give(&p->lock);
+    p->backing->release(p->backing->ctx,l,l->bytes);
+    return;
+  }
+
+  lock_take(&p->lock);
+  {
+    int c=pool_class(bytes);
+    *(void **)ptr=p->free[c];
+    p->free[c]=ptr;
+  }
+  lock_give(&p->lock);
+}
+
+static void *pool_resize(void *ctx,void *ptr,size_t old,size_t bytes){
+  void *ret;
+
+  /* still fits its class */
+  if(old<=POOL_LARGEST && bytes<=POOL_LARGEST &&
+     pool_class(old)==pool_class(bytes))return ptr;
+
+  ret=pool_alloc(ctx,bytes);
+  if(!ret)return NULL;
+  memcpy(ret,ptr,old<bytes?old:bytes);
+  pool_release(ctx,ptr,old);
+  return ret;
+}
+
+/* a pool taking its memory from backing, or from the process-wide
+   allocator as it is now when backing is NULL. Pools lock, so one
+   can be shared by threads or set process-wide. */
+ogg_pool *ogg_pool_create(const ogg_allocator *backing){
+  ogg_pool *p;
+
+  if(!backing)backing=process;
+  p=backing->alloc(backing->ctx,sizeof(*p));
+  if(!p)return NULL;
+  memset(p,0,sizeof(*p));
+  p->a.alloc=pool_alloc;
+  p->a.resize=pool_resize;
+  p->a.release=pool_release;
+  p->a.ctx=p;
+  p->backing=backing;
+  lock_init(&p->lock);
+  return p;
+}
+
+/* hands everything back to the backing allocator at once, blocks
+   still out included; nothing from p may be used after */
+void ogg_pool_destroy(ogg_pool *p){
+  const ogg_allocator *b;
+  if(!p)return;
+  b=p->backing;
+  while(p->large){
+    pool_large *l=p->large;
+    p->large=l->next;
+    b->release(b->ctx,l,l->bytes);
+  }
+  while(p->slabs){
+    void *slab=p->slabs;
+    p->slabs=*(void **)slab;
+    b->release(b->ctx,slab,POOL_SLAB);
+  }
+  lock_clear(&p->lock);
+  b->release(b->ctx,p,sizeof(*p));
+}
+
+const ogg_allocator *ogg_pool_allocator(ogg_pool *p){
+  return &p->a;
+}
+
+#ifdef _V_SELFTEST
+
+#include <stdio.h>
+
+/* counts what the backing allocator is asked for */
+static long backing_blocks;
+
+static void *count_alloc(void *ctx,size_t bytes){
+  backing_blocks++;
+  return malloc(bytes);
+}
+
+static void *count_resize(void *ctx,void *ptr,size_t old,size_t bytes){
+  return realloc(ptr,bytes);
+}
+
+static void count_release(void *ctx,void *ptr,size_t bytes){
+  backing_blocks--;
+  free(ptr);
+}
+
+static const ogg_allocator counted={count_alloc,count_resize,count_release,
+                                    NULL};
+
+static void report(const char *in){
+  fprintf(stderr,"%s\n",in);
+  exit(1);
+}
+
+static void fill(unsigned char *p,size_t bytes,int seed){
+  size_t i;
+  for(i=0;i<bytes;i++)p[i]=(unsigned char)(seed+i*7);
+}
+
+static int check(const unsigned char *p,size_t bytes,int seed){
+  size_t i;
+  for(i=0;i<bytes;i++)
+    if(p[i]!=(unsigned char)(seed+i*7))return 0;
+  return 1;
+}
+
+#define BLOCKS 4000
+
+int main(void){
+  static unsigned char *ptr[BLOCKS];
+  static size_t size[BLOCKS];
+  ogg_pool *pool,*other;
+  ogg_alloc_site s[4];
+  int i,j;
+
+  fprintf(stderr,"Pool blocks keep their contents... ");
+  pool=ogg_pool_create(&counted);
+  ogg_set_allocator(ogg_pool_allocator(pool));
+  srand(0);
+  for(j=0;j<20;j++){
+    for(i=0;i<BLOCKS;i++){
+      size_t bytes=rand()%(i&63?512:40000);
+      if(ptr[i] && !check(ptr[i],size[i],i))report("corrupted");
+      switch(rand()%3){
+      case 0:
+        ogg_free(ptr[i]);
+        ptr[i]=ogg_malloc(bytes);
+        break;
+      case 1:
+        ptr[i]=ogg_realloc(ptr[i],bytes);
+        if(!check(ptr[i],size[i]<bytes?size[i]:bytes,i))
+          report("realloc lost the contents");
+        break;
+      case 2:
+        ogg_free(ptr[i]);
+        ptr[i]=ogg_calloc(1,bytes);
+        for(size[i]=0;size[i]<bytes;size[i]++)
+          if(ptr[i][size[i]])report("calloc block not cleared");
+        break;
+      }
+      if(bytes && !ptr[i])report("out of memory");
+      if(((size_t)ptr[i]&(sizeof(double)-1)))report("misaligned block");
+      size[i]=bytes;
+      fill(ptr[i],bytes,i);
+    }
+  }
+  fprintf(stderr,"ok.\n");
+
+  fprintf(stderr,"Blocks go back to their own pool... ");
+  other=ogg_pool_create(&counted);
+  ogg_use_allocator(ogg_pool_allocator(other));
+  for(i=0;i<BLOCKS;i+=2){
+    ogg_free(ptr[i]);
+    ptr[i]=ogg_malloc(size[i]);
+    fill(ptr[i],size[i],i);
+  }
+  ogg_use_allocator(NULL);
+  for(i=1;i<BLOCKS;i+=2)
+    ptr[i]=ogg_realloc(ptr[i],size[i]+1);
+  for(i=0;i<BLOCKS;i++){
+    if(!check(ptr[i],size[i],i))report("corrupted");
+    ogg_free(ptr[i]);
+  }
+  ogg_set_allocator(NULL);
+  ogg_pool_destroy(pool);
+  ogg_pool_destroy(other);
+  if(backing_blocks)report("pools leaked");
+  fprintf(stderr,"ok.\n");
+
+  fprintf(stderr,"Destroying a pool frees what's still out... ");
+  pool=ogg_pool_create(&counted);
+  ogg_use_allocator(ogg_pool_allocator(pool));
+  for(i=0;i<BLOCKS;i++)ptr[i]=ogg_malloc(i*11);
+  ogg_use_allocator(NULL);
+  ogg_pool_destroy(pool);
+  if(backing_blocks)report("pool leaked");
+  fprintf(stderr,"ok.\n");
+
+  fprintf(stderr,"Call sites are counted... ");
+  ptr[0]=ogg_malloc_at(100,"a.c",1);
+  ptr[1]=ogg_malloc_at(50,"a.c",1);
+  ptr[2]=ogg_calloc_at(2,10,"b.c",1);
+  ptr[1]=ogg_realloc_at(ptr[1],70,"a.c",2);
+  ogg_free(ptr[0]);
+  if(ogg_alloc_sites(s,4)!=3)report("wrong number of sites");
+  for(i=0;i<3;i++){
+    long want[3][4]={{2,0,0,150},{1,1,20,20},{1,1,70,70}};
+    int k=!strcmp(s[i].file,"a.c")?s[i].line==1?0:2:1;
+    if(s[i].calls!=want[k][0] || s[i].blocks!=want[k][1] ||
+       (long)s[i].bytes!=want[k][2] || (long)s[i].peak!=want[k][3])
+      report("wrong count");
+  }
+  ogg_free(ptr[1]);
+  ogg_free(ptr[2]);
+  fprintf(stderr,"ok.\n");
+
+  return 0;
+}
+
+#endif
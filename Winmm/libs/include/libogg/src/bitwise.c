@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <ogg/ogg.h>
+#include <ogg/bitwise.h>
 
 #define BUFFER_INCREMENT 256
 
@@ -272,6 +273,11 @@ long oggpack_look(oggpack_buffer *b,int bits){
   unsigned long m;
 
   if(bits<0 || bits>32) return -1;
+
+#ifdef OGGPACK_LOAD64
+  if(oggpack_has64(b)) return oggpack_look64(b,bits);
+#endif
+
   m=mask[bits];
   bits+=b->endbit;
 
@@ -377,6 +383,18 @@ long oggpack_read(oggpack_buffer *b,int bits){
   unsigned long m;
 
   if(bits<0 || bits>32) goto err;
+
+#ifdef OGGPACK_LOAD64
+  if(oggpack_has64(b)){
+    ret=oggpack_look64(b,bits);
+    bits+=b->endbit;
+    b->ptr+=bits/8;
+    b->endbyte+=bits/8;
+    b->endbit=bits&7;
+    return ret;
+  }
+#endif
+
   m=mask[bits];
   bits+=b->endbit;
 
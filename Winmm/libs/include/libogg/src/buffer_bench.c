@@ -0,0 +1,176 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE Ogg CONTAINER SOURCE CODE.              *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2010             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: buffer compaction benchmark; plays an Ogg file (or a
+           framed stream of random packets) through ogg_sync and
+           ogg_stream the way vorbisfile does and counts the bytes
+           slid down inside them, next to what compacting on every
+           call would have moved
+
+ ********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ogg/ogg.h>
+
+#define STREAM_BYTES (16<<20)
+#define READSIZE     2048 /* what vorbisfile reads at a time */
+
+static unsigned char *stream;
+static long           streambytes;
+
+/* roughly a 160kbps 44.1kHz Vorbis stream */
+static void frame(void){
+  ogg_stream_state os;
+  ogg_packet op;
+  ogg_page og;
+  unsigned char *packet=malloc(4096);
+  long i;
+
+  ogg_stream_init(&os,0x12345678);
+  stream=malloc(STREAM_BYTES+(1<<17));
+  memset(&op,0,sizeof(op));
+  op.packet=packet;
+
+  srand(0);
+  while(streambytes<STREAM_BYTES){
+    op.bytes=(op.packetno&7)?30+rand()%60:300+rand()%400;
+    for(i=0;i<op.bytes;i++)packet[i]=rand();
+    op.b_o_s=op.packetno==0;
+    op.granulepos+=(op.packetno&7)?128:1024;
+    ogg_stream_packetin(&os,&op);
+    op.packetno++;
+    while(ogg_stream_pageout(&os,&og)){
+      memcpy(stream+streambytes,og.header,og.header_len);
+      memcpy(stream+streambytes+og.header_len,og.body,og.body_len);
+      streambytes+=og.header_len+og.body_len;
+    }
+  }
+  ogg_stream_clear(&os);
+  free(packet);
+}
+
+static int load(const char *path){
+  FILE *f=fopen(path,"rb");
+  long n;
+  if(!f)return -1;
+  fseek(f,0,SEEK_END);
+  n=ftell(f);
+  fseek(f,0,SEEK_SET);
+  stream=malloc(n);
+  streambytes=(long)fread(stream,1,n,f);
+  fclose(f);
+  return streambytes==n?0:-1;
+}
+
+static double eager;  /* bytes compacting every call would move */
+static double moved;  /* bytes actually moved */
+static long   packets;
+
+/* one pass over the stream; only the first logical stream is
+   followed. Returns the last granule position seen and the sample
+   rate when the first packet is a Vorbis id header. */
+static ogg_int64_t play(int count,long *rate){
+  ogg_sync_state oy;
+  ogg_stream_state os;
+  ogg_page og;
+  ogg_packet op;
+  ogg_int64_t granulepos=0;
+  long at=0,synced=0,bodied=0,laced=0;
+  int serialno=0,started=0;
+
+  ogg_sync_init(&oy);
+  ogg_stream_init(&os,0);
+  while(at<streambytes){
+    long n=streambytes-at<READSIZE?streambytes-at:READSIZE;
+    long fill=oy.fill,returned=oy.returned;
+
+    memcpy(ogg_sync_buffer(&oy,n),stream+at,n);
+    if(count){
+      /* the old code compacted whenever a page had gone since the
+         last call */
+      if(returned>synced)eager+=fill-returned;
+      if(returned && !oy.returned)moved+=fill-returned;
+    }
+    synced=oy.returned;
+    ogg_sync_wrote(&oy,n);
+    at+=n;
+
+    while(ogg_sync_pageout(&oy,&og)>0){
+      long bfill=os.body_fill,breturned=os.body_returned;
+      long lfill=os.lacing_fill,lreturned=os.lacing_returned;
+      long lbytes=sizeof(*os.lacing_vals)+sizeof(*os.granule_vals);
+
+      if(!started){
+        serialno=ogg_page_serialno(&og);
+        ogg_stream_reset_serialno(&os,serialno);
+        started=1;
+      }
+      if(ogg_page_serialno(&og)!=serialno)continue;
+
+      ogg_stream_pagein(&os,&og);
+      if(count){
+        if(breturned>bodied)eager+=bfill-breturned;
+        if(breturned && !os.body_returned)moved+=bfill-breturned;
+        if(lreturned>laced)eager+=(lfill-lreturned)*lbytes;
+        if(lreturned && !os.lacing_returned)moved+=(lfill-lreturned)*lbytes;
+      }
+      bodied=os.body_returned;
+      laced=os.lacing_returned;
+      if(ogg_page_granulepos(&og)>0)granulepos=ogg_page_granulepos(&og);
+
+      while(ogg_stream_packetout(&os,&op)>0){
+        if(op.packetno==0 && op.bytes>=16 && !memcmp(op.packet+1,"vorbis",6))
+          *rate=op.packet[12]|op.packet[13]<<8|
+            op.packet[14]<<16|(long)op.packet[15]<<24;
+        if(count)packets++;
+      }
+    }
+  }
+  ogg_stream_clear(&os);
+  ogg_sync_clear(&oy);
+  return granulepos;
+}
+
+int main(int argc,char **argv){
+  long rate=44100;
+  ogg_int64_t granulepos;
+  double secs,per;
+  clock_t start;
+  int i,passes=argc>2?atoi(argv[2]):20;
+
+  if(argc>1){
+    if(load(argv[1])){
+      fprintf(stderr,"can't read %s\n",argv[1]);
+      return 1;
+    }
+  }else
+    frame();
+
+  play(0,&rate);
+  start=clock();
+  for(i=0;i<passes;i++)granulepos=play(1,&rate);
+  secs=(double)(clock()-start)/CLOCKS_PER_SEC;
+
+  per=(double)granulepos/rate*passes;
+  printf("%ld bytes, %.1f s of audio at %ld Hz, %ld packets per pass\n",
+         streambytes,(double)granulepos/rate,rate,packets/passes);
+  printf("%-20s %10.0f bytes per second of audio\n","compact every call",
+         eager/per);
+  printf("%-20s %10.0f bytes per second of audio\n","compact when full",
+         moved/per);
+  printf("%-20s %10.1f MB/s through sync and stream\n","throughput",
+         secs>0?(double)streambytes*passes/secs/1e6:0.);
+  return 0;
+}
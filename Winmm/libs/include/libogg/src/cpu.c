@@ -0,0 +1,120 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE Ogg CONTAINER SOURCE CODE.              *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2010             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: CPU feature detection for the SIMD kernels
+
+ ********************************************************************/
+
+#include <ogg/cpu.h>
+
+#if defined(OGG_ARCH_X86) && defined(_MSC_VER)
+#  include <intrin.h>
+#elif defined(OGG_ARCH_ARM64) && defined(__linux__)
+#  include <sys/auxv.h>
+#  include <asm/hwcap.h>
+#endif
+
+#if defined(_WIN32)
+#  define CPU_WIN32
+#  include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#  include <unistd.h>
+#  if defined(_POSIX_THREADS) && _POSIX_THREADS>0
+#    define CPU_PTHREAD
+#    include <pthread.h>
+#  endif
+#endif
+
+static int cpu_detect(void){
+  int cpu=0;
+#if defined(OGG_ARCH_X86) && defined(_MSC_VER)
+  int info[4];
+
+  __cpuid(info,0);
+  if(info[0]>=1){
+    int max=info[0];
+    __cpuid(info,1);
+    if(info[3]&(1<<26))cpu|=OGG_CPU_SSE2;
+    if(info[2]&(1<<9))cpu|=OGG_CPU_SSSE3;
+    if(info[2]&(1<<1))cpu|=OGG_CPU_PCLMUL;
+
+    /* AVX state must also be enabled by the OS */
+    if((info[2]&(1<<27)) && (info[2]&(1<<28)) &&
+       (_xgetbv(0)&6)==6 && max>=7){
+      __cpuidex(info,7,0);
+      if(info[1]&(1<<5))cpu|=OGG_CPU_AVX2;
+    }
+  }
+#elif defined(OGG_ARCH_X86)
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("sse2"))cpu|=OGG_CPU_SSE2;
+  if(__builtin_cpu_supports("ssse3"))cpu|=OGG_CPU_SSSE3;
+  if(__builtin_cpu_supports("pclmul"))cpu|=OGG_CPU_PCLMUL;
+  if(__builtin_cpu_supports("avx2"))cpu|=OGG_CPU_AVX2;
+#elif defined(OGG_ARCH_ARM64)
+  /* Advanced SIMD is mandatory on AArch64 */
+  cpu|=OGG_CPU_NEON;
+#  if defined(__linux__)
+  if(getauxval(AT_HWCAP)&HWCAP_PMULL)cpu|=OGG_CPU_PMULL;
+#  elif defined(__APPLE__)
+  /* every Apple AArch64 core has the crypto extension */
+  cpu|=OGG_CPU_PMULL;
+#  endif
+#endif
+  return cpu;
+}
+
+/* decoder threads all ask at once; the first one probes and the rest
+   wait for its answer */
+static int cpu;
+
+#if defined(CPU_WIN32)
+
+static volatile LONG cpu_once;
+
+int ogg_cpu_features(void){
+  if(cpu_once!=2){
+    if(InterlockedCompareExchange(&cpu_once,1,0)==0){
+      cpu=cpu_detect();
+      InterlockedExchange(&cpu_once,2);
+    }else
+      while(cpu_once!=2)Sleep(0);
+  }
+  return cpu;
+}
+
+#elif defined(CPU_PTHREAD)
+
+static pthread_once_t cpu_once=PTHREAD_ONCE_INIT;
+
+static void cpu_init(void){
+  cpu=cpu_detect();
+}
+
+int ogg_cpu_features(void){
+  pthread_once(&cpu_once,cpu_init);
+  return cpu;
+}
+
+#else
+
+/* no threads */
+int ogg_cpu_features(void){
+  static int known;
+  if(!known){
+    cpu=cpu_detect();
+    known=1;
+  }
+  return cpu;
+}
+
+#endif
@@ -0,0 +1,310 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE Ogg CONTAINER SOURCE CODE.              *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2010             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: Ogg page CRC; direct table, slicing-by-8 and carry-less
+           multiply folding
+
+ note: The CRC code is directly derived from public domain code by
+ Ross Williams (ross@guest.adelaide.edu.au).  See docs/framing.html
+ for details.
+
+ ********************************************************************/
+
+#include <stdlib.h>
+#include <ogg/ogg.h>
+#include <ogg/cpu.h>
+#include "crc.h"
+#include "crctable.h"
+
+#ifdef OGG_ARCH_X86
+#  define CRC_X86
+#  include <immintrin.h>
+#elif defined(OGG_ARCH_ARM64) && defined(__GNUC__)
+#  define CRC_ARM64
+#  include <arm_neon.h>
+#endif
+
+#if 0
+/* helper to initialize lookup for direct-table CRC (illustrative; we
+   use the static init in crctable.h; the other slices are
+   crc_lookup[k][i]=crc_lookup[k-1][i]<<8^crc_lookup[0][crc_lookup[k-1][i]>>24]) */
+
+static ogg_uint32_t _ogg_crc_entry(unsigned long index){
+  int           i;
+  unsigned long r;
+
+  r = index << 24;
+  for (i=0; i<8; i++)
+    if (r & 0x80000000UL)
+      r = (r << 1) ^ 0x04c11db7; /* The same as the ethernet generator
+                                    polynomial, although we use an
+                                    unreflected alg and an init/final
+                                    of 0, not 0xffffffff */
+    else
+       r<<=1;
+ return (r & 0xffffffffUL);
+}
+#endif
+
+static ogg_uint32_t crc_byte(ogg_uint32_t crc,const unsigned char *data,
+                             long bytes){
+  long i;
+  for(i=0;i<bytes;i++)
+    crc=(crc<<8)^crc_lookup[0][((crc>>24)&0xff)^data[i]];
+  return crc;
+}
+
+/* eight bytes per step: the four that overlap the register and the
+   four after them each look up how far they still have to carry */
+static ogg_uint32_t crc_slice8(ogg_uint32_t crc,const unsigned char *data,
+                               long bytes){
+  while(bytes>=8){
+    crc^=((ogg_uint32_t)data[0]<<24)|((ogg_uint32_t)data[1]<<16)|
+      ((ogg_uint32_t)data[2]<<8)|data[3];
+    crc=crc_lookup[7][crc>>24]^crc_lookup[6][(crc>>16)&0xff]^
+      crc_lookup[5][(crc>>8)&0xff]^crc_lookup[4][crc&0xff]^
+      crc_lookup[3][data[4]]^crc_lookup[2][data[5]]^
+      crc_lookup[1][data[6]]^crc_lookup[0][data[7]];
+    data+=8;
+    bytes-=8;
+  }
+  return crc_byte(crc,data,bytes);
+}
+
+/* Folding. A 128 bit register holds the next 16 bytes as one big
+   endian polynomial, highest bit first, with the CRC so far xored into
+   its top 32 bits. Moving it 128 bits further along is multiplying its
+   halves by x^192 and x^128 mod P; neither product is wider than 96
+   bits, so the next 16 bytes can simply be xored on. Four registers
+   are folded 512 bits at a time to keep the multiplier busy, then
+   into one. What is left in it is run through the table like any
+   other 16 bytes, then the remainder of the data. */
+
+#define CRC_K128_HI 0xc5b9cd4c /* x^192 mod P */
+#define CRC_K128_LO 0xe8a45605 /* x^128 mod P */
+#define CRC_K512_HI 0x8833794c /* x^576 mod P */
+#define CRC_K512_LO 0xe6228b11 /* x^512 mod P */
+
+/* shorter than this isn't worth setting up for */
+#define CRC_FOLD_MIN 64
+
+#ifdef CRC_X86
+
+OGG_TARGET_PCLMUL static __inline __m128i crc_load_x86(const unsigned char *p){
+  const __m128i rev=_mm_set_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+  return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)p),rev);
+}
+
+OGG_TARGET_PCLMUL static __inline __m128i crc_fold_x86(__m128i x,__m128i k,
+                                                       __m128i next){
+  __m128i hi=_mm_clmulepi64_si128(x,k,0x11);
+  __m128i lo=_mm_clmulepi64_si128(x,k,0x00);
+  return _mm_xor_si128(_mm_xor_si128(hi,lo),next);
+}
+
+OGG_TARGET_PCLMUL static ogg_uint32_t crc_clmul(ogg_uint32_t crc,
+                                                const unsigned char *data,
+                                                long bytes){
+  const __m128i rev=_mm_set_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+  const __m128i k128=_mm_set_epi32(0,(int)CRC_K128_HI,0,(int)CRC_K128_LO);
+  const __m128i k512=_mm_set_epi32(0,(int)CRC_K512_HI,0,(int)CRC_K512_LO);
+  __m128i x0,x1,x2,x3;
+  unsigned char last[16];
+
+  if(bytes<CRC_FOLD_MIN)return crc_slice8(crc,data,bytes);
+
+  x0=_mm_xor_si128(crc_load_x86(data),_mm_set_epi32((int)crc,0,0,0));
+  x1=crc_load_x86(data+16);
+  x2=crc_load_x86(data+32);
+  x3=crc_load_x86(data+48);
+  data+=64;
+  bytes-=64;
+
+  while(bytes>=64){
+    x0=crc_fold_x86(x0,k512,crc_load_x86(data));
+    x1=crc_fold_x86(x1,k512,crc_load_x86(data+16));
+    x2=crc_fold_x86(x2,k512,crc_load_x86(data+32));
+    x3=crc_fold_x86(x3,k512,crc_load_x86(data+48));
+    data+=64;
+    bytes-=64;
+  }
+
+  x0=crc_fold_x86(x0,k128,x1);
+  x0=crc_fold_x86(x0,k128,x2);
+  x0=crc_fold_x86(x0,k128,x3);
+  while(bytes>=16){
+    x0=crc_fold_x86(x0,k128,crc_load_x86(data));
+    data+=16;
+    bytes-=16;
+  }
+
+  _mm_storeu_si128((__m128i *)last,_mm_shuffle_epi8(x0,rev));
+  crc=crc_slice8(0,last,16);
+  return crc_slice8(crc,data,bytes);
+}
+
+#elif defined(CRC_ARM64)
+
+/* byte reversal of the whole register, an involution */
+OGG_TARGET_PMULL static __inline uint8x16_t crc_rev_arm(uint8x16_t v){
+  v=vrev64q_u8(v);
+  return vextq_u8(v,v,8);
+}
+
+OGG_TARGET_PMULL static __inline uint8x16_t crc_fold_arm(uint8x16_t x,
+                                                         poly64_t hi,
+                                                         poly64_t lo,
+                                                         uint8x16_t next){
+  uint64x2_t v=vreinterpretq_u64_u8(x);
+  poly128_t h=vmull_p64((poly64_t)vgetq_lane_u64(v,1),hi);
+  poly128_t l=vmull_p64((poly64_t)vgetq_lane_u64(v,0),lo);
+  return veorq_u8(veorq_u8(vreinterpretq_u8_p128(h),vreinterpretq_u8_p128(l)),
+                  next);
+}
+
+#define crc_load_arm(p) crc_rev_arm(vld1q_u8(p))
+
+OGG_TARGET_PMULL static ogg_uint32_t crc_pmull(ogg_uint32_t crc,
+                                               const unsigned char *data,
+                                               long bytes){
+  uint8x16_t x0,x1,x2,x3;
+  unsigned char last[16];
+
+  if(bytes<CRC_FOLD_MIN)return crc_slice8(crc,data,bytes);
+
+  x0=veorq_u8(crc_load_arm(data),
+              vreinterpretq_u8_u32(vsetq_lane_u32(crc,vdupq_n_u32(0),3)));
+  x1=crc_load_arm(data+16);
+  x2=crc_load_arm(data+32);
+  x3=crc_load_arm(data+48);
+  data+=64;
+  bytes-=64;
+
+  while(bytes>=64){
+    x0=crc_fold_arm(x0,CRC_K512_HI,CRC_K512_LO,crc_load_arm(data));
+    x1=crc_fold_arm(x1,CRC_K512_HI,CRC_K512_LO,crc_load_arm(data+16));
+    x2=crc_fold_arm(x2,CRC_K512_HI,CRC_K512_LO,crc_load_arm(data+32));
+    x3=crc_fold_arm(x3,CRC_K512_HI,CRC_K512_LO,crc_load_arm(data+48));
+    data+=64;
+    bytes-=64;
+  }
+
+  x0=crc_fold_arm(x0,CRC_K128_HI,CRC_K128_LO,x1);
+  x0=crc_fold_arm(x0,CRC_K128_HI,CRC_K128_LO,x2);
+  x0=crc_fold_arm(x0,CRC_K128_HI,CRC_K128_LO,x3);
+  while(bytes>=16){
+    x0=crc_fold_arm(x0,CRC_K128_HI,CRC_K128_LO,crc_load_arm(data));
+    data+=16;
+    bytes-=16;
+  }
+
+  vst1q_u8(last,crc_rev_arm(x0));
+  crc=crc_slice8(0,last,16);
+  return crc_slice8(crc,data,bytes);
+}
+
+#endif
+
+/* bit 1<<OGG_CRC_x for every implementation this CPU can run */
+static int crc_cpu_impls(void){
+  int cpu=ogg_cpu_features();
+  int impls=(1<<OGG_CRC_BYTE)|(1<<OGG_CRC_SLICE8);
+#ifdef CRC_X86
+  if((cpu&OGG_CPU_PCLMUL) && (cpu&OGG_CPU_SSSE3))impls|=1<<OGG_CRC_CLMUL;
+#endif
+#ifdef CRC_ARM64
+  if(cpu&OGG_CPU_PMULL)impls|=1<<OGG_CRC_PMULL;
+#endif
+  return impls;
+}
+
+static ogg_uint32_t (*crc_update)(ogg_uint32_t,const unsigned char *,
+                                  long)=NULL;
+
+int _ogg_crc_select(int impl){
+  int impls=crc_cpu_impls();
+
+  if(impl<0 || impl>=OGG_CRC_IMPLS || !(impls&(1<<impl)))return 0;
+
+  switch(impl){
+  case OGG_CRC_BYTE:
+    crc_update=crc_byte;
+    break;
+#ifdef CRC_X86
+  case OGG_CRC_CLMUL:
+    crc_update=crc_clmul;
+    break;
+#endif
+#ifdef CRC_ARM64
+  case OGG_CRC_PMULL:
+    crc_update=crc_pmull;
+    break;
+#endif
+  default:
+    crc_update=crc_slice8;
+    break;
+  }
+  return 1;
+}
+
+/* the fastest this CPU runs, unless the selftest or bench has picked
+   one; nothing else writes crc_update, so threads can share this */
+ogg_uint32_t _ogg_crc_update(ogg_uint32_t crc,const unsigned char *data,
+                             long bytes){
+  if(crc_update)return crc_update(crc,data,bytes);
+#ifdef CRC_X86
+  if(crc_cpu_impls()&(1<<OGG_CRC_CLMUL))return crc_clmul(crc,data,bytes);
+#endif
+#ifdef CRC_ARM64
+  if(crc_cpu_impls()&(1<<OGG_CRC_PMULL))return crc_pmull(crc,data,bytes);
+#endif
+  return crc_slice8(crc,data,bytes);
+}
+
+#ifdef _V_SELFTEST
+#include <stdio.h>
+#include <string.h>
+
+static const char *names[OGG_CRC_IMPLS]={"byte","slice8","clmul","pmull"};
+
+int main(void){
+  unsigned char *buf=malloc(70000);
+  int impl,i;
+
+  srand(0);
+  for(i=0;i<70000;i++)buf[i]=rand();
+
+  for(impl=0;impl<OGG_CRC_IMPLS;impl++){
+    fprintf(stderr,"testing %s CRC against the direct table... ",names[impl]);
+    if(!_ogg_crc_select(impl)){
+      fprintf(stderr,"not available here.\n");
+      continue;
+    }
+
+    /* every length and alignment around the folding thresholds, then
+       random spans and carried in registers */
+    for(i=0;i<4000;i++){
+      long off=i<1024?i&15:rand()%1024;
+      long len=i<1024?i>>2:rand()%(70000-1024);
+      ogg_uint32_t crc=i&1?0:((ogg_uint32_t)rand()<<16)^rand();
+      if(_ogg_crc_update(crc,buf+off,len)!=crc_byte(crc,buf+off,len)){
+        fprintf(stderr,"mismatch at offset %ld, length %ld!\n",off,len);
+        exit(1);
+      }
+    }
+    fprintf(stderr,"ok.\n");
+  }
+
+  free(buf);
+  return 0;
+}
+#endif
@@ -0,0 +1,40 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE Ogg CONTAINER SOURCE CODE.              *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2010             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: Ogg page CRC
+
+ ********************************************************************/
+
+#ifndef _OGG_CRC_H_
+#define _OGG_CRC_H_
+
+#include <ogg/os_types.h>
+
+/* implementations, see _ogg_crc_select */
+#define OGG_CRC_BYTE   0
+#define OGG_CRC_SLICE8 1
+#define OGG_CRC_CLMUL  2
+#define OGG_CRC_PMULL  3
+#define OGG_CRC_IMPLS  4
+
+/* the CRC of bytes more bytes of data carried on from crc; polynomial
+   0x04c11db7, unreflected, with an init and final xor of 0 */
+extern ogg_uint32_t _ogg_crc_update(ogg_uint32_t crc,
+                                    const unsigned char *data,long bytes);
+
+/* makes impl the one _ogg_crc_update uses from then on, for the
+   selftest and bench; without it each call takes the fastest this CPU
+   can run. Returns 0 when impl isn't built in or the CPU can't run
+   it. */
+extern int _ogg_crc_select(int impl);
+
+#endif
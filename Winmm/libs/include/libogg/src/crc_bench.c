@@ -0,0 +1,76 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE Ogg CONTAINER SOURCE CODE.              *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2010             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: page CRC throughput benchmark; times every implementation
+           this CPU can run on spans from a page header to a large
+           page and checks each against the direct table
+
+ ********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ogg/ogg.h>
+#include "crc.h"
+
+static const char *names[OGG_CRC_IMPLS]={"byte","slice8","clmul","pmull"};
+
+int main(int argc,char **argv){
+  static const long sizes[]={27,282,4096,65307};
+  long budget=argc>1?atol(argv[1]):1<<28; /* bytes checksummed per test */
+  unsigned char *buf=malloc(65307);
+  int s,i,failed=0;
+
+  srand(0);
+  for(i=0;i<65307;i++)buf[i]=rand();
+
+  printf("%6s","bytes");
+  for(i=0;i<OGG_CRC_IMPLS;i++)printf(" %10s",names[i]);
+  printf("   (GB/s)\n");
+
+  for(s=0;s<(int)(sizeof(sizes)/sizeof(*sizes));s++){
+    long n=sizes[s],iters=budget/n;
+    ogg_uint32_t ref;
+
+    _ogg_crc_select(OGG_CRC_BYTE);
+    ref=_ogg_crc_update(0,buf,n);
+
+    printf("%6ld",n);
+    for(i=0;i<OGG_CRC_IMPLS;i++){
+      ogg_uint32_t crc=0;
+      clock_t start;
+      double secs;
+      long k;
+
+      if(!_ogg_crc_select(i)){
+        printf(" %10s","-");
+        continue;
+      }
+      if(_ogg_crc_update(0,buf,n)!=ref){
+        printf(" %10s","MISMATCH");
+        failed=1;
+        continue;
+      }
+
+      /* carry the result along so nothing can be skipped */
+      start=clock();
+      for(k=0;k<iters;k++)crc=_ogg_crc_update(crc,buf,n);
+      secs=(double)(clock()-start)/CLOCKS_PER_SEC;
+      printf(" %10.2f",secs>0?(double)n*iters/secs/1e9:0.);
+      if(crc==1)printf("!"); /* keeps crc live */
+    }
+    printf("\n");
+  }
+
+  free(buf);
+  return failed;
+}
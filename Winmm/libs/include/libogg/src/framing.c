@@ -14,16 +14,27 @@
            decode Ogg streams back into raw packets
  last mod: $Id: framing.c 18758 2013-01-08 16:29:56Z tterribe $
 
- note: The CRC code is directly derived from public domain code by
- Ross Williams (ross@guest.adelaide.edu.au).  See docs/framing.html
- for details.
-
  ********************************************************************/
 
 #include <stdlib.h>
 #include <limits.h>
 #include <string.h>
 #include <ogg/ogg.h>
+#include "crc.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#  define SCAN_SSE2
+#  include <emmintrin.h>
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  endif
+#endif
+
+/* smallest ogg_sync_buffer storage; at vorbisfile's 2KB reads the
+   unconsumed tail then slides down once every thirty-odd reads
+   rather than on each one */
+#define SYNC_STORAGE 65536
 
 /* A complete description of Ogg framing exists in docs/framing.html */
 
@@ -97,93 +108,6 @@ int ogg_page_packets(const ogg_page *og){
 }
 
 
-#if 0
-/* helper to initialize lookup for direct-table CRC (illustrative; we
-   use the static init below) */
-
-static ogg_uint32_t _ogg_crc_entry(unsigned long index){
-  int           i;
-  unsigned long r;
-
-  r = index << 24;
-  for (i=0; i<8; i++)
-    if (r & 0x80000000UL)
-      r = (r << 1) ^ 0x04c11db7; /* The same as the ethernet generator
-                                    polynomial, although we use an
-                                    unreflected alg and an init/final
-                                    of 0, not 0xffffffff */
-    else
-       r<<=1;
- return (r & 0xffffffffUL);
-}
-#endif
-
-static const ogg_uint32_t crc_lookup[256]={
-  0x00000000,0x04c11db7,0x09823b6e,0x0d4326d9,
-  0x130476dc,0x17c56b6b,0x1a864db2,0x1e475005,
-  0x2608edb8,0x22c9f00f,0x2f8ad6d6,0x2b4bcb61,
-  0x350c9b64,0x31cd86d3,0x3c8ea00a,0x384fbdbd,
-  0x4c11db70,0x48d0c6c7,0x4593e01e,0x4152fda9,
-  0x5f15adac,0x5bd4b01b,0x569796c2,0x52568b75,
-  0x6a1936c8,0x6ed82b7f,0x639b0da6,0x675a1011,
-  0x791d4014,0x7ddc5da3,0x709f7b7a,0x745e66cd,
-  0x9823b6e0,0x9ce2ab57,0x91a18d8e,0x95609039,
-  0x8b27c03c,0x8fe6dd8b,0x82a5fb52,0x8664e6e5,
-  0xbe2b5b58,0xbaea46ef,0xb7a96036,0xb3687d81,
-  0xad2f2d84,0xa9ee3033,0xa4ad16ea,0xa06c0b5d,
-  0xd4326d90,0xd0f37027,0xddb056fe,0xd9714b49,
-  0xc7361b4c,0xc3f706fb,0xceb42022,0xca753d95,
-  0xf23a8028,0xf6fb9d9f,0xfbb8bb46,0xff79a6f1,
-  0xe13ef6f4,0xe5ffeb43,0xe8bccd9a,0xec7dd02d,
-  0x34867077,0x30476dc0,0x3d044b19,0x39c556ae,
-  0x278206ab,0x23431b1c,0x2e003dc5,0x2ac12072,
-  0x128e9dcf,0x164f8078,0x1b0ca6a1,0x1fcdbb16,
-  0x018aeb13,0x054bf6a4,0x0808d07d,0x0cc9cdca,
-  0x7897ab07,0x7c56b6b0,0x71159069,0x75d48dde,
-  0x6b93dddb,0x6f52c06c,0x6211e6b5,0x66d0fb02,
-  0x5e9f46bf,0x5a5e5b08,0x571d7dd1,0x53dc6066,
-  0x4d9b3063,0x495a2dd4,0x44190b0d,0x40d816ba,
-  0xaca5c697,0xa864db20,0xa527fdf9,0xa1e6e04e,
-  0xbfa1b04b,0xbb60adfc,0xb6238b25,0xb2e29692,
-  0x8aad2b2f,0x8e6c3698,0x832f1041,0x87ee0df6,
-  0x99a95df3,0x9d684044,0x902b669d,0x94ea7b2a,
-  0xe0b41de7,0xe4750050,0xe9362689,0xedf73b3e,
-  0xf3b06b3b,0xf771768c,0xfa325055,0xfef34de2,
-  0xc6bcf05f,0xc27dede8,0xcf3ecb31,0xcbffd686,
-  0xd5b88683,0xd1799b34,0xdc3abded,0xd8fba05a,
-  0x690ce0ee,0x6dcdfd59,0x608edb80,0x644fc637,
-  0x7a089632,0x7ec98b85,0x738aad5c,0x774bb0eb,
-  0x4f040d56,0x4bc510e1,0x46863638,0x42472b8f,
-  0x5c007b8a,0x58c1663d,0x558240e4,0x51435d53,
-  0x251d3b9e,0x21dc2629,0x2c9f00f0,0x285e1d47,
-  0x36194d42,0x32d850f5,0x3f9b762c,0x3b5a6b9b,
-  0x0315d626,0x07d4cb91,0x0a97ed48,0x0e56f0ff,
-  0x1011a0fa,0x14d0bd4d,0x19939b94,0x1d528623,
-  0xf12f560e,0xf5ee4bb9,0xf8ad6d60,0xfc6c70d7,
-  0xe22b20d2,0xe6ea3d65,0xeba91bbc,0xef68060b,
-  0xd727bbb6,0xd3e6a601,0xdea580d8,0xda649d6f,
-  0xc423cd6a,0xc0e2d0dd,0xcda1f604,0xc960ebb3,
-  0xbd3e8d7e,0xb9ff90c9,0xb4bcb610,0xb07daba7,
-  0xae3afba2,0xaafbe615,0xa7b8c0cc,0xa379dd7b,
-  0x9b3660c6,0x9ff77d71,0x92b45ba8,0x9675461f,
-  0x8832161a,0x8cf30bad,0x81b02d74,0x857130c3,
-  0x5d8a9099,0x594b8d2e,0x5408abf7,0x50c9b640,
-  0x4e8ee645,0x4a4ffbf2,0x470cdd2b,0x43cdc09c,
-  0x7b827d21,0x7f436096,0x7200464f,0x76c15bf8,
-  0x68860bfd,0x6c47164a,0x61043093,0x65c52d24,
-  0x119b4be9,0x155a565e,0x18197087,0x1cd86d30,
-  0x029f3d35,0x065e2082,0x0b1d065b,0x0fdc1bec,
-  0x3793a651,0x3352bbe6,0x3e119d3f,0x3ad08088,
-  0x2497d08d,0x2056cd3a,0x2d15ebe3,0x29d4f654,
-  0xc5a92679,0xc1683bce,0xcc2b1d17,0xc8ea00a0,
-  0xd6ad50a5,0xd26c4d12,0xdf2f6bcb,0xdbee767c,
-  0xe3a1cbc1,0xe760d676,0xea23f0af,0xeee2ed18,
-  0xf0a5bd1d,0xf464a0aa,0xf9278673,0xfde69bc4,
-  0x89b8fd09,0x8d79e0be,0x803ac667,0x84fbdbd0,
-  0x9abc8bd5,0x9e7d9662,0x933eb0bb,0x97ffad0c,
-  0xafb010b1,0xab710d06,0xa6322bdf,0xa2f33668,
-  0xbcb4666d,0xb8757bda,0xb5365d03,0xb1f740b4};
-
 /* init the encode/decode logical stream state */
 
 int ogg_stream_init(ogg_stream_state *os,int serialno){
@@ -286,14 +210,27 @@ static int _os_lacing_expand(ogg_stream_state *os,long needed){
   return 0;
 }
 
-/* checksum the page */
-/* Direct table CRC; note that this will be faster in the future if we
-   perform the checksum simultaneously with other copies */
+/* checksum the page; see crc.c */
+
+static ogg_uint32_t _os_crc(ogg_uint32_t crc_reg,const unsigned char *data,
+                            long bytes){
+  return _ogg_crc_update(crc_reg,data,bytes);
+}
+
+/* the checksum of a page as stored, taking its checksum field as zero
+   without writing to it; the data may be read only */
+static ogg_uint32_t _os_page_crc(const unsigned char *header,long header_len,
+                                 const unsigned char *body,long body_len){
+  static const unsigned char zero[4]={0,0,0,0};
+  ogg_uint32_t crc_reg=_os_crc(0,header,22);
+  crc_reg=_os_crc(crc_reg,zero,4);
+  crc_reg=_os_crc(crc_reg,header+26,header_len-26);
+  return _os_crc(crc_reg,body,body_len);
+}
 
 void ogg_page_checksum_set(ogg_page *og){
   if(og){
-    ogg_uint32_t crc_reg=0;
-    int i;
+    ogg_uint32_t crc_reg;
 
     /* safety; needed for API behavior, but not framing code */
     og->header[22]=0;
@@ -301,10 +238,8 @@ void ogg_page_checksum_set(ogg_page *og){
     og->header[24]=0;
     og->header[25]=0;
 
-    for(i=0;i<og->header_len;i++)
-      crc_reg=(crc_reg<<8)^crc_lookup[((crc_reg >> 24)&0xff)^og->header[i]];
-    for(i=0;i<og->body_len;i++)
-      crc_reg=(crc_reg<<8)^crc_lookup[((crc_reg >> 24)&0xff)^og->body[i]];
+    crc_reg=_os_crc(0,og->header,og->header_len);
+    crc_reg=_os_crc(crc_reg,og->body,og->body_len);
 
     og->header[22]=(unsigned char)(crc_reg&0xff);
     og->header[23]=(unsigned char)((crc_reg>>8)&0xff);
@@ -628,11 +563,16 @@ int ogg_sync_check(ogg_sync_state *oy){
 char *ogg_sync_buffer(ogg_sync_state *oy, long size){
   if(ogg_sync_check(oy)) return NULL;
 
-  /* first, clear out any space that has been previously returned */
-  if(oy->returned){
+  /* clear out any space that has been previously returned. That's
+     free when everything was consumed; otherwise the unconsumed tail
+     is only slid down once the room past the fill mark runs out, so
+     steady reads append instead of moving the leftover every call */
+  if(oy->returned==oy->fill){
+    oy->fill=0;
+    oy->returned=0;
+  }else if(oy->returned && size>oy->storage-oy->fill){
     oy->fill-=oy->returned;
-    if(oy->fill>0)
-      memmove(oy->data,oy->data+oy->returned,oy->fill);
+    memmove(oy->data,oy->data+oy->returned,oy->fill);
     oy->returned=0;
   }
 
@@ -641,6 +581,9 @@ char *ogg_sync_buffer(ogg_sync_state *oy, long size){
     long newsize=size+oy->fill+4096; /* an extra page to be nice */
     void *ret;
 
+    /* and room for many reads between slides */
+    if(newsize<SYNC_STORAGE)newsize=SYNC_STORAGE;
+
     if(oy->data)
       ret=_ogg_realloc(oy->data,newsize);
     else
@@ -664,6 +607,60 @@ int ogg_sync_wrote(ogg_sync_state *oy, long bytes){
   return(0);
 }
 
+#ifdef SCAN_SSE2
+static int _os_lowest_bit(unsigned int v){
+#ifdef _MSC_VER
+  unsigned long i;
+  _BitScanForward(&i,v);
+  return (int)i;
+#else
+  return __builtin_ctz(v);
+#endif
+}
+#endif
+
+/* offset of the first "OggS" in data, or of a start of one running
+   off its end; bytes if there is neither.  The SSE2 path looks for
+   'O' at 64 offsets a step and only checks the rest of the pattern
+   where there is one */
+static long _os_find_capture(const unsigned char *data,long bytes){
+  long i=0;
+
+#ifdef SCAN_SSE2
+  const __m128i O=_mm_set1_epi8('O');
+  for(;i+67<=bytes;i+=64){
+    __m128i a=_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data+i)),O);
+    __m128i b=_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data+i+16)),O);
+    __m128i c=_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data+i+32)),O);
+    __m128i d=_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data+i+48)),O);
+    unsigned int mask;
+    int k;
+
+    if(!_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a,b),_mm_or_si128(c,d))))
+      continue;
+
+    for(k=0;k<64;k+=32){
+      mask=(unsigned int)_mm_movemask_epi8(k?c:a)|
+        (unsigned int)_mm_movemask_epi8(k?d:b)<<16;
+      while(mask){
+        int at=k+_os_lowest_bit(mask);
+        if(!memcmp(data+i+at,"OggS",4))return i+at;
+        mask&=mask-1;
+      }
+    }
+  }
+#endif
+
+  while(i<bytes){
+    const unsigned char *o=memchr(data+i,'O',bytes-i);
+    if(!o)return bytes;
+    i=(long)(o-data);
+    if(!memcmp(data+i,"OggS",bytes-i<4?bytes-i:4))return i;
+    i++;
+  }
+  return bytes;
+}
+
 /* sync the stream.  This is meant to be useful for finding page
    boundaries.
 
@@ -685,8 +682,9 @@ long ogg_sync_pageseek(ogg_sync_state *oy,ogg_page *og){
     int headerbytes,i;
     if(bytes<27)return(0); /* not enough for a header */
 
-    /* verify capture pattern */
-    if(memcmp(page,"OggS",4))goto sync_fail;
+    /* verify capture pattern and version; anything else is caught
+       out here before a whole bogus page is waited for and summed */
+    if(memcmp(page,"OggS",4) || page[4]!=0)goto sync_fail;
 
     headerbytes=page[26]+27;
     if(bytes<headerbytes)return(0); /* not enough for header + seg table */
@@ -700,28 +698,16 @@ long ogg_sync_pageseek(ogg_sync_state *oy,ogg_page *og){
 
   if(oy->bodybytes+oy->headerbytes>bytes)return(0);
 
-  /* The whole test page is buffered.  Verify the checksum */
+  /* The whole test page is buffered.  Verify the checksum; the page
+     is left untouched, so the buffer may be a read only mapping */
   {
-    /* Grab the checksum bytes, set the header field to zero */
-    char chksum[4];
-    ogg_page log;
-
-    memcpy(chksum,page+22,4);
-    memset(page+22,0,4);
-
-    /* set up a temp page struct and recompute the checksum */
-    log.header=page;
-    log.header_len=oy->headerbytes;
-    log.body=page+oy->headerbytes;
-    log.body_len=oy->bodybytes;
-    ogg_page_checksum_set(&log);
-
-    /* Compare */
-    if(memcmp(chksum,page+22,4)){
+    ogg_uint32_t chksum=page[22]|(page[23]<<8)|(page[24]<<16)|
+      ((ogg_uint32_t)page[25]<<24);
+
+    if(chksum!=_os_page_crc(page,oy->headerbytes,
+                            page+oy->headerbytes,oy->bodybytes)){
       /* D'oh.  Mismatch! Corrupt page (or miscapture and not a page
          at all) */
-      /* replace the computed checksum with the one actually read in */
-      memcpy(page+22,chksum,4);
 
       /* Bad checksum. Lose sync */
       goto sync_fail;
@@ -753,9 +739,7 @@ long ogg_sync_pageseek(ogg_sync_state *oy,ogg_page *og){
   oy->bodybytes=0;
 
   /* search for possible capture */
-  next=memchr(page+1,'O',bytes-1);
-  if(!next)
-    next=oy->data+oy->fill;
+  next=page+1+_os_find_capture(page+1,bytes-1);
 
   oy->returned=(int)(next-oy->data);
   return((long)-(next-page));
@@ -822,20 +806,23 @@ int ogg_stream_pagein(ogg_stream_state *os, ogg_page *og){
 
   if(ogg_stream_check(os)) return -1;
 
-  /* clean up 'returned data' */
+  /* clean up 'returned data'; as in ogg_sync_buffer, only moved when
+     the storage past the fill mark can't take this page */
   {
     long lr=os->lacing_returned;
     long br=os->body_returned;
 
     /* body data */
-    if(br){
+    if(br && (br==os->body_fill ||
+              os->body_storage-bodysize<=os->body_fill)){
       os->body_fill-=br;
       if(os->body_fill)
         memmove(os->body_data,os->body_data+br,os->body_fill);
       os->body_returned=0;
     }
 
-    if(lr){
+    if(lr && (lr==os->lacing_fill ||
+              os->lacing_storage-(segments+1)<=os->lacing_fill)){
       /* segment table */
       if(os->lacing_fill-lr){
         memmove(os->lacing_vals,os->lacing_vals+lr,
@@ -874,7 +861,7 @@ int ogg_stream_pagein(ogg_stream_state *os, ogg_page *og){
   /* are we a 'continued packet' page?  If so, we may need to skip
      some segments */
   if(continued){
-    if(os->lacing_fill<1 ||
+    if(os->lacing_fill<=os->lacing_returned ||
        os->lacing_vals[os->lacing_fill-1]==0x400){
       bos=0;
       for(;segptr<segments;segptr++){
@@ -0,0 +1,144 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE Ogg CONTAINER SOURCE CODE.              *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2010             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: resync benchmark; frames a stream of random packets, then
+           drops into it at random offsets the way a bisection seek
+           does and times ogg_sync_pageseek finding the next page,
+           next to a plain memchr scan for the same capture
+
+ ********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ogg/ogg.h>
+
+#define STREAM_BYTES (16<<20)
+#define READSIZE     2048 /* what vorbisfile reads at a time */
+
+static unsigned char *stream;
+static long           streambytes;
+static long          *pages;
+static long           pagecount;
+static long           calls;
+
+static void frame(void){
+  ogg_stream_state os;
+  ogg_packet op;
+  ogg_page og;
+  unsigned char *packet=malloc(4096);
+  long i;
+
+  ogg_stream_init(&os,0x12345678);
+  stream=malloc(STREAM_BYTES+(1<<17));
+  pages=malloc(sizeof(*pages)*(STREAM_BYTES/27));
+  memset(&op,0,sizeof(op));
+  op.packet=packet;
+
+  srand(0);
+  while(streambytes<STREAM_BYTES){
+    op.bytes=100+rand()%3000;
+    for(i=0;i<op.bytes;i++)packet[i]=rand();
+    op.b_o_s=op.packetno==0;
+    op.granulepos+=1024;
+    ogg_stream_packetin(&os,&op);
+    op.packetno++;
+    while(ogg_stream_pageout(&os,&og)){
+      pages[pagecount++]=streambytes;
+      memcpy(stream+streambytes,og.header,og.header_len);
+      memcpy(stream+streambytes+og.header_len,og.body,og.body_len);
+      streambytes+=og.header_len+og.body_len;
+    }
+  }
+  ogg_stream_clear(&os);
+  free(packet);
+}
+
+/* the first page at or after pos */
+static long next_page(long pos){
+  long lo=0,hi=pagecount;
+  while(lo<hi){
+    long mid=(lo+hi)/2;
+    if(pages[mid]<pos)lo=mid+1;
+    else hi=mid;
+  }
+  return lo<pagecount?pages[lo]:streambytes;
+}
+
+/* where ogg_sync_pageseek lands, reading from pos the way vorbisfile
+   does */
+static long resync(ogg_sync_state *oy,long pos){
+  long at=pos;
+  ogg_sync_reset(oy);
+  while(at<streambytes){
+    long n=streambytes-at<READSIZE?streambytes-at:READSIZE;
+    long ret;
+    memcpy(ogg_sync_buffer(oy,n),stream+at,n);
+    ogg_sync_wrote(oy,n);
+    at+=n;
+    while(calls++,(ret=ogg_sync_pageseek(oy,NULL))<0)pos-=ret;
+    if(ret>0)return pos;
+  }
+  return streambytes;
+}
+
+static long memchr_scan(long pos){
+  while(pos<streambytes){
+    const unsigned char *o=memchr(stream+pos,'O',streambytes-pos);
+    if(!o)return streambytes;
+    pos=(long)(o-stream);
+    if(!memcmp(stream+pos,"OggS",4))return pos;
+    pos++;
+  }
+  return streambytes;
+}
+
+int main(int argc,char **argv){
+  long count=argc>1?atol(argv[1]):20000;
+  long *offsets=malloc(sizeof(*offsets)*count);
+  ogg_sync_state oy;
+  double skipped=0,secs;
+  clock_t start;
+  long i,check=0;
+  int failed=0;
+
+  frame();
+  ogg_sync_init(&oy);
+  for(i=0;i<count;i++){
+    offsets[i]=(long)(((double)rand()/RAND_MAX)*(streambytes-1));
+    skipped+=next_page(offsets[i])-offsets[i];
+  }
+  printf("%ld pages, %ld resyncs, %.0f bytes to the next page on average\n",
+         pagecount,count,skipped/count);
+
+  for(i=0;i<count;i++)
+    if(resync(&oy,offsets[i])!=next_page(offsets[i]))failed=1;
+  if(failed)printf("ogg_sync_pageseek MISSED A PAGE\n");
+
+  calls=0;
+  start=clock();
+  for(i=0;i<count;i++)check+=resync(&oy,offsets[i]);
+  secs=(double)(clock()-start)/CLOCKS_PER_SEC;
+  printf("%-20s %8.0f ns per resync, %.1f calls\n","ogg_sync_pageseek",
+         secs*1e9/count,(double)calls/count);
+
+  start=clock();
+  for(i=0;i<count;i++)check+=memchr_scan(offsets[i]);
+  secs=(double)(clock()-start)/CLOCKS_PER_SEC;
+  printf("%-20s %8.0f ns per resync (capture scan alone, %.2f GB/s)\n",
+         "memchr+memcmp",secs*1e9/count,secs>0?skipped/secs/1e9:0.);
+
+  if(check==1)printf("!"); /* keeps the results live */
+  ogg_sync_clear(&oy);
+  return failed;
+}
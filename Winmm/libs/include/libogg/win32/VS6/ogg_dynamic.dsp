@@ -93,10 +93,22 @@ LINK32=link.exe
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=..\..\src\alloc.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\bitwise.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\cpu.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\crc.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\framing.c
 # End Source File
 # End Group
@@ -216,6 +216,9 @@ extern long     vorbis_packet_blocksize(vorbis_info *vi,ogg_packet *op);
 
 extern int      vorbis_synthesis_halfrate(vorbis_info *v,int flag);
 extern int      vorbis_synthesis_halfrate_p(vorbis_info *v);
+extern int      vorbis_synthesis_threads(vorbis_dsp_state *v,int threads,
+                                         int channels,long blocksize);
+extern void     vorbis_setup_cache_clear(void);
 
 /* Vorbis ERRORS and return codes ***********************************/
 
@@ -143,11 +143,24 @@ typedef struct OggVorbis_File {
 
   ov_callbacks callbacks;
 
+  struct synthpipe *pipe; /* decode threads, see ov_threads */
+  int              chthreads; /* see ov_channel_threads */
+  int              chchannels;
+  long             chblocksize;
+  struct ov_mapping *map; /* set by ov_fopen_mmap */
+  struct ov_seekindex *index; /* see ov_seek_index */
+  int              lazy; /* see ov_test_open_fast */
+  vorbis_info     *first_vi; /* kept by ov_test_open_fast's scan */
+  vorbis_comment  *first_vc;
+  ogg_pool        *arena; /* see ov_arenas */
+
 } OggVorbis_File;
 
 
 extern int ov_clear(OggVorbis_File *vf);
 extern int ov_fopen(const char *path,OggVorbis_File *vf);
+extern int ov_fopen_mmap(const char *path,OggVorbis_File *vf);
+extern int ov_fopen_fast(const char *path,OggVorbis_File *vf);
 extern int ov_open(FILE *f,OggVorbis_File *vf,const char *initial,long ibytes);
 extern int ov_open_callbacks(void *datasource, OggVorbis_File *vf,
                 const char *initial, long ibytes, ov_callbacks callbacks);
@@ -156,6 +169,7 @@ extern int ov_test(FILE *f,OggVorbis_File *vf,const char *initial,long ibytes);
 extern int ov_test_callbacks(void *datasource, OggVorbis_File *vf,
                 const char *initial, long ibytes, ov_callbacks callbacks);
 extern int ov_test_open(OggVorbis_File *vf);
+extern int ov_test_open_fast(OggVorbis_File *vf);
 
 extern long ov_bitrate(OggVorbis_File *vf,int i);
 extern long ov_bitrate_instant(OggVorbis_File *vf);
@@ -170,6 +184,9 @@ extern double ov_time_total(OggVorbis_File *vf,int i);
 extern int ov_raw_seek(OggVorbis_File *vf,ogg_int64_t pos);
 extern int ov_pcm_seek(OggVorbis_File *vf,ogg_int64_t pos);
 extern int ov_pcm_seek_page(OggVorbis_File *vf,ogg_int64_t pos);
+extern int ov_seek_index(OggVorbis_File *vf);
+extern int ov_seek_index_save(OggVorbis_File *vf,const char *path);
+extern int ov_seek_index_load(OggVorbis_File *vf,const char *path);
 extern int ov_time_seek(OggVorbis_File *vf,double pos);
 extern int ov_time_seek_page(OggVorbis_File *vf,double pos);
 
@@ -198,6 +215,14 @@ extern int ov_crosslap(OggVorbis_File *vf1,OggVorbis_File *vf2);
 extern int ov_halfrate(OggVorbis_File *vf,int flag);
 extern int ov_halfrate_p(OggVorbis_File *vf);
 
+extern int ov_threads(OggVorbis_File *vf,int threads);
+extern int ov_channel_threads(OggVorbis_File *vf,int threads,int channels,
+                              long blocksize);
+extern int ov_readahead(OggVorbis_File *vf,long bytes);
+extern int ov_readahead_stats(OggVorbis_File *vf,long *hits,long *misses);
+
+extern void ov_arenas(int on);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
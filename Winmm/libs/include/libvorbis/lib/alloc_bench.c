@@ -0,0 +1,191 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: allocator benchmark; cycles through a soundtrack the way a
+           player does, opening, decoding and clearing each file in
+           turn, with the libraries on the C heap, on a shared pool,
+           on per file arenas and on both, and reports the time each
+           step takes, how often the C heap was called and how much
+           of it was held at the peak
+
+ ********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ogg/ogg.h>
+#include "vorbis/codec.h"
+#include "vorbis/vorbisfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+static double now(void){
+#ifdef _WIN32
+  LARGE_INTEGER t,f;
+  QueryPerformanceCounter(&t);
+  QueryPerformanceFrequency(&f);
+  return (double)t.QuadPart/f.QuadPart;
+#else
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC,&t);
+  return t.tv_sec+t.tv_nsec*1e-9;
+#endif
+}
+
+/* the C heap, counted; everything below the pools ends up here */
+static long   heap_calls;
+static size_t heap_live;
+static size_t heap_peak;
+
+static void *count_alloc(void *ctx,size_t bytes){
+  heap_calls++;
+  heap_live+=bytes;
+  if(heap_live>heap_peak)heap_peak=heap_live;
+  return malloc(bytes);
+}
+
+static void *count_resize(void *ctx,void *ptr,size_t old,size_t bytes){
+  heap_calls++;
+  heap_live+=bytes-old;
+  if(heap_live>heap_peak)heap_peak=heap_live;
+  return realloc(ptr,bytes);
+}
+
+static void count_release(void *ctx,void *ptr,size_t bytes){
+  heap_calls++;
+  heap_live-=bytes;
+  free(ptr);
+}
+
+static const ogg_allocator heap={count_alloc,count_resize,count_release,
+                                 NULL};
+
+static const char *modes[]={"C heap","pool","arenas","pool+arenas"};
+
+static double open_s,decode_s,clear_s,audio_s;
+static long   tracks;
+
+static void cycle(char **files,int count,double limit){
+  static char buf[4096];
+  int i,sec;
+
+  for(i=0;i<count;i++){
+    OggVorbis_File vf;
+    vorbis_info *vi;
+    double t=now(),samples=0;
+    long bytes;
+
+    if(ov_fopen_fast(files[i],&vf)){
+      fprintf(stderr,"can't open %s\n",files[i]);
+      exit(1);
+    }
+    open_s+=now()-t;
+
+    t=now();
+    vi=ov_info(&vf,-1);
+    while((limit<=0 || samples<limit*vi->rate) &&
+          (bytes=ov_read(&vf,buf,sizeof(buf),0,2,1,&sec))>0)
+      samples+=bytes/(2*vi->channels);
+    decode_s+=now()-t;
+    audio_s+=samples/vi->rate;
+
+    t=now();
+    ov_clear(&vf);
+    clear_s+=now()-t;
+    tracks++;
+  }
+}
+
+static int bypeak(const void *a,const void *b){
+  size_t x=((const ogg_alloc_site *)a)->peak;
+  size_t y=((const ogg_alloc_site *)b)->peak;
+  return (y>x)-(y<x);
+}
+
+int main(int argc,char **argv){
+  double limit=0;
+  int passes=3,only=-1,mode,i;
+
+  while(argc>1 && argv[1][0]=='-'){
+    if(argc>2 && !strcmp(argv[1],"-n"))passes=atoi(argv[2]);
+    else if(argc>2 && !strcmp(argv[1],"-s"))limit=atof(argv[2]);
+    else if(argc>2 && !strcmp(argv[1],"-m"))only=atoi(argv[2]);
+    else break;
+    argc-=2;
+    argv+=2;
+  }
+  if(argc<2){
+    fprintf(stderr,"usage: alloc_bench [-n passes] [-s seconds] [-m mode] "
+            "file.ogg...\n"
+            "  each pass opens, decodes (the first seconds of) and clears\n"
+            "  every file in turn; -m runs one mode (0-3) alone, for peak\n"
+            "  figures later modes would share with the setup cache\n");
+    return 1;
+  }
+
+  printf("%d files, %d passes%s\n",argc-1,passes,
+         limit>0?", first seconds of each":"");
+  printf("%-12s %9s %9s %9s %11s %10s %10s\n","","open us","clear us",
+         "decode x","heap calls","peak KB","kept KB");
+
+  /* the process-wide pools are never destroyed, since the setup cache
+     keeps blocks from them across modes */
+  ogg_set_allocator(&heap);
+  for(mode=0;mode<4;mode++){
+    size_t base;
+    long calls;
+
+    if(only>=0 && mode!=only)continue;
+
+    ogg_set_allocator(mode&1?ogg_pool_allocator(ogg_pool_create(&heap)):
+                      &heap);
+    ov_arenas(mode>>1);
+
+    /* one pass to warm the setup cache and the pool */
+    cycle(argv+1,argc-1,limit);
+    open_s=decode_s=clear_s=audio_s=0;
+    tracks=0;
+    base=heap_peak=heap_live;
+    calls=heap_calls;
+
+    for(i=0;i<passes;i++)cycle(argv+1,argc-1,limit);
+
+    printf("%-12s %9.1f %9.1f %9.1f %11.1f %10.1f %10.1f\n",modes[mode],
+           open_s*1e6/tracks,clear_s*1e6/tracks,audio_s/decode_s,
+           (double)(heap_calls-calls)/tracks,(heap_peak-base)/1024.,
+           ((double)heap_live-base)/1024.);
+  }
+
+  {
+    ogg_alloc_site sites[64];
+    int n=ogg_alloc_sites(sites,64);
+    if(n>64)n=64;
+    if(n){
+      qsort(sites,n,sizeof(*sites),bypeak);
+      printf("\nlargest call sites (OGG_ALLOC_SITES)\n");
+      printf("%-28s %10s %10s %10s\n","","calls","live KB","peak KB");
+      for(i=0;i<n && i<16;i++){
+        const char *f=strrchr(sites[i].file,'/');
+        char name[64];
+        if(!f)f=strrchr(sites[i].file,'\\');
+        sprintf(name,"%.50s:%d",f?f+1:sites[i].file,sites[i].line);
+        printf("%-28s %10ld %10.1f %10.1f\n",name,sites[i].calls,
+               sites[i].bytes/1024.,sites[i].peak/1024.);
+      }
+    }
+  }
+  return 0;
+}
@@ -31,6 +31,14 @@
 #include "registry.h"
 #include "misc.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define BLOCK_SSE2
+#  include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#  define BLOCK_NEON
+#  include <arm_neon.h>
+#endif
+
 /* pcm accumulator examples (not exhaustive):
 
  <-------------- lW ---------------->
@@ -365,6 +373,8 @@ void vorbis_dsp_clear(vorbis_dsp_state *v){
       drft_clear(&b->fft_look[0]);
       drft_clear(&b->fft_look[1]);
 
+      chanpool_destroy(b->chpool);
+
     }
 
     if(v->pcm){
@@ -719,12 +729,39 @@ int vorbis_synthesis_init(vorbis_dsp_state *v,vorbis_info *vi){
    block.  The time domain envelope is not yet handled at the point of
    calling (as it relies on the previous block). */
 
+/* Overlap-add through the window: pcm[i]=pcm[i]*w[n-i-1] + p[i]*w[i].
+   The previous block's tail fades out on the mirrored window while the
+   new block fades in, in one pass.  Each lane does the same two
+   multiplies and one add as the scalar expression, so the result is
+   identical; n is normally a multiple of 4 (blocksizes are powers of two
+   of 64 and up), the scalar loop picks up anything left. */
+static void _vorbis_overlap_add(float *pcm,const float *p,const float *w,int n){
+  int i=0;
+#if defined(BLOCK_SSE2)
+  for(;i+4<=n;i+=4){
+    __m128 r=_mm_loadu_ps(w+n-i-4);
+    r=_mm_shuffle_ps(r,r,_MM_SHUFFLE(0,1,2,3));
+    _mm_storeu_ps(pcm+i,_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(pcm+i),r),
+                                   _mm_mul_ps(_mm_loadu_ps(p+i),_mm_loadu_ps(w+i))));
+  }
+#elif defined(BLOCK_NEON)
+  for(;i+4<=n;i+=4){
+    float32x4_t r=vrev64q_f32(vld1q_f32(w+n-i-4));
+    r=vextq_f32(r,r,2);
+    vst1q_f32(pcm+i,vaddq_f32(vmulq_f32(vld1q_f32(pcm+i),r),
+                              vmulq_f32(vld1q_f32(p+i),vld1q_f32(w+i))));
+  }
+#endif
+  for(;i<n;i++)
+    pcm[i]=pcm[i]*w[n-i-1] + p[i]*w[i];
+}
+
 int vorbis_synthesis_blockin(vorbis_dsp_state *v,vorbis_block *vb){
   vorbis_info *vi=v->vi;
   codec_setup_info *ci=vi->codec_setup;
   private_state *b=v->backend_state;
   int hs=ci->halfrate_flag;
-  int i,j;
+  int j;
 
   if(!vb)return(OV_EINVAL);
   if(v->pcm_current>v->pcm_returned  && v->pcm_returned!=-1)return(OV_EINVAL);
@@ -775,15 +812,13 @@ int vorbis_synthesis_blockin(vorbis_dsp_state *v,vorbis_block *vb){
           const float *w=_vorbis_window_get(b->window[1]-hs);
           float *pcm=v->pcm[j]+prevCenter;
           float *p=vb->pcm[j];
-          for(i=0;i<n1;i++)
-            pcm[i]=pcm[i]*w[n1-i-1] + p[i]*w[i];
+          _vorbis_overlap_add(pcm,p,w,n1);
         }else{
           /* large/small */
           const float *w=_vorbis_window_get(b->window[0]-hs);
           float *pcm=v->pcm[j]+prevCenter+n1/2-n0/2;
           float *p=vb->pcm[j];
-          for(i=0;i<n0;i++)
-            pcm[i]=pcm[i]*w[n0-i-1] +p[i]*w[i];
+          _vorbis_overlap_add(pcm,p,w,n0);
         }
       }else{
         if(v->W){
@@ -791,17 +826,14 @@ int vorbis_synthesis_blockin(vorbis_dsp_state *v,vorbis_block *vb){
           const float *w=_vorbis_window_get(b->window[0]-hs);
           float *pcm=v->pcm[j]+prevCenter;
           float *p=vb->pcm[j]+n1/2-n0/2;
-          for(i=0;i<n0;i++)
-            pcm[i]=pcm[i]*w[n0-i-1] +p[i]*w[i];
-          for(;i<n1/2+n0/2;i++)
-            pcm[i]=p[i];
+          _vorbis_overlap_add(pcm,p,w,n0);
+          memcpy(pcm+n0,p+n0,(n1/2-n0/2)*sizeof(*pcm));
         }else{
           /* small/small */
           const float *w=_vorbis_window_get(b->window[0]-hs);
           float *pcm=v->pcm[j]+prevCenter;
           float *p=vb->pcm[j];
-          for(i=0;i<n0;i++)
-            pcm[i]=pcm[i]*w[n0-i-1] +p[i]*w[i];
+          _vorbis_overlap_add(pcm,p,w,n0);
         }
       }
 
@@ -809,8 +841,7 @@ int vorbis_synthesis_blockin(vorbis_dsp_state *v,vorbis_block *vb){
       {
         float *pcm=v->pcm[j]+thisCenter;
         float *p=vb->pcm[j]+n;
-        for(i=0;i<n;i++)
-          pcm[i]=p[i];
+        memcpy(pcm,p,n*sizeof(*pcm));
       }
     }
 
@@ -0,0 +1,153 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: codeword decode benchmark; times vorbis_book_decode and
+           the residue stage vorbis_book_decodevv_add on the stock
+           44.1kHz stereo residue books for q3 to q6, and checks both
+           against re-encoding / looking up the decoded entries
+
+ ********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ogg/ogg.h>
+#include "vorbis/codec.h"
+#include "codebook.h"
+#include "books/coupled/res_books_stereo.h"
+
+#define RES_44S(q) \
+  &_44c##q##_s_p1_0,&_44c##q##_s_p2_0,&_44c##q##_s_p3_0,&_44c##q##_s_p4_0, \
+  &_44c##q##_s_p5_0,&_44c##q##_s_p6_0,&_44c##q##_s_p7_0,&_44c##q##_s_p7_1, \
+  &_44c##q##_s_p8_0,&_44c##q##_s_p8_1,&_44c##q##_s_p9_0,&_44c##q##_s_p9_1, \
+  &_44c##q##_s_p9_2
+
+static const static_codebook *const q3[]={RES_44S(3),NULL};
+static const static_codebook *const q4[]={RES_44S(4),NULL};
+static const static_codebook *const q5[]={RES_44S(5),NULL};
+static const static_codebook *const q6[]={RES_44S(6),&_44c6_s_p5_1,
+                                          &_44c6_s_p6_1,NULL};
+
+static const static_codebook *const *const sets[]={q3,q4,q5,q6};
+
+#define BYTES 65536
+#define PART  32   /* samples per residue partition, both channels */
+#define RING  2048 /* residue vector length the timed loop cycles over */
+
+int main(int argc,char **argv){
+  long budget=argc>1?atol(argv[1]):1<<22; /* codewords decoded per book */
+  unsigned char *src=malloc(BYTES);
+  long *entries=malloc(sizeof(*entries)*BYTES*8);
+  int q,i,failed=0;
+
+  /* random bits decode to each codeword with probability 2^-length,
+     which is how an entropy coded stream looks to the decoder */
+  srand(0);
+  for(i=0;i<BYTES;i++)src[i]=rand()>>7;
+
+  printf("%4s %6s %10s %10s %12s\n","q","books","codewords","ns/word",
+         "ns/residue");
+
+  for(q=0;q<4;q++){
+    const static_codebook *const *s;
+    double ns=0,vns=0;
+    long words=0,vwords=0;
+    int books=0;
+
+    for(s=sets[q];*s;s++){
+      codebook dec,enc;
+      oggpack_buffer b,w;
+      clock_t start;
+      long n=0,k,bits,rounds;
+
+      vorbis_book_init_decode(&dec,*s);
+      vorbis_book_init_encode(&enc,*s);
+
+      /* decode once and check; a failed decode at the end still
+         consumes bits, so count up to the last good one */
+      oggpack_readinit(&b,src,BYTES);
+      bits=0;
+      while((entries[n]=vorbis_book_decode(&dec,&b))>=0){
+        bits=oggpack_bits(&b);
+        n++;
+      }
+
+      oggpack_writeinit(&w);
+      for(k=0;k<n;k++)vorbis_book_encode(&enc,entries[k],&w);
+      if(oggpack_bits(&w)!=bits ||
+         memcmp(oggpack_get_buffer(&w),src,bits/8) ||
+         ((bits&7) &&
+          ((oggpack_get_buffer(&w)[bits/8]^src[bits/8])&((1<<(bits&7))-1)))){
+        printf("book %d of q%d: decode does not round trip\n",books,q+3);
+        failed=1;
+      }
+      oggpack_writeclear(&w);
+
+      rounds=budget/n+1;
+      start=clock();
+      for(k=0;k<rounds;k++){
+        oggpack_readinit(&b,src,BYTES);
+        while(vorbis_book_decode(&dec,&b)>=0);
+      }
+      ns+=(double)(clock()-start)/CLOCKS_PER_SEC*1e9;
+      words+=rounds*n;
+      books++;
+
+      /* the residue stage as res2 runs it for coupled stereo: whole
+         partitions added into two channel vectors */
+      if(dec.valuelist){
+        long half=n*dec.dim/2+RING;
+        float *res=calloc(half*2,sizeof(*res));
+        float *ref=calloc(half*2,sizeof(*ref));
+        float *vals=_book_unquantize(*s,(*s)->entries,NULL);
+        float *a[2];
+        long off;
+
+        for(k=0;k<n*dec.dim;k++)
+          ref[(k&1)*half+k/2]=vals[entries[k/dec.dim]*dec.dim+
+                                            k%dec.dim];
+        a[0]=res;
+        a[1]=res+half;
+        oggpack_readinit(&b,src,BYTES);
+        for(off=0;!vorbis_book_decodevv_add(&dec,a,off,2,&b,PART);off+=PART);
+        if(memcmp(res,ref,sizeof(*res)*half*2)){
+          printf("book %d of q%d: residue decode mismatch\n",books,q+3);
+          failed=1;
+        }
+
+        a[1]=res+RING/2;
+        start=clock();
+        for(k=0;k<rounds;k++){
+          oggpack_readinit(&b,src,BYTES);
+          for(off=0;!vorbis_book_decodevv_add(&dec,a,off,2,&b,PART);
+              off=(off+PART)%RING);
+        }
+        vns+=(double)(clock()-start)/CLOCKS_PER_SEC*1e9;
+        vwords+=rounds*n;
+        free(res);
+        free(ref);
+        free(vals);
+      }
+
+      vorbis_book_clear(&dec);
+      vorbis_book_clear(&enc);
+    }
+
+    printf("%4d %6d %10ld %10.2f %12.2f\n",q+3,books,words,ns/words,
+           vns/vwords);
+  }
+
+  free(src);
+  free(entries);
+  return failed;
+}
@@ -0,0 +1,187 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: small worker group splitting per channel synthesis work
+
+ ********************************************************************/
+
+/* A fork/join group: chanpool_run hands out the indices of a batch one
+   at a time to whichever thread asks next, the caller included, and
+   waits until the last one has finished. Workers sleep between
+   batches. */
+
+#include <stdlib.h>
+#include "vorbis/codec.h"
+#include "chanpool.h"
+#include "os.h"
+#include "threads.h"
+
+#ifdef VORBIS_THREADS
+
+struct chanpool {
+  int               threads;
+  v_thread         *thread;
+  v_mutex           mutex;
+  v_cond            go;   /* a batch was posted */
+  v_cond            done; /* a batch completed */
+  int               quit;
+  int               busy;
+
+  /* the batch in progress */
+  chanpool_func     fn;
+  void             *arg;
+  int               n;
+  int               next;
+  int               left;
+};
+
+#define pool_lock(p)   v_lock(&(p)->mutex)
+#define pool_unlock(p) v_unlock(&(p)->mutex)
+
+/* called locked, return locked */
+static void pool_wait_go(chanpool *p){
+  v_wait(&p->go,&p->mutex);
+}
+
+static void pool_wait_done(chanpool *p){
+  v_wait(&p->done,&p->mutex);
+}
+
+/* every waiter rechecks for work, so wake them all */
+static void pool_post_go(chanpool *p){
+  v_broadcast(&p->go);
+}
+
+static void pool_post_done(chanpool *p){
+  v_signal(&p->done);
+}
+
+/* runs indices of the current batch until there are none left to
+   start; called locked, returns locked */
+static void pool_drain(chanpool *p){
+  while(p->next<p->n){
+    int i=p->next++;
+    chanpool_func fn=p->fn;
+    void *arg=p->arg;
+
+    pool_unlock(p);
+    fn(arg,i);
+    pool_lock(p);
+
+    if(--p->left==0)pool_post_done(p);
+  }
+}
+
+static void pool_worker(chanpool *p){
+  pool_lock(p);
+  while(!p->quit){
+    if(p->next<p->n)
+      pool_drain(p);
+    else
+      pool_wait_go(p);
+  }
+  pool_unlock(p);
+}
+
+static v_thread_ret V_THREAD_CALL pool_thread(void *arg){
+  pool_worker(arg);
+  return V_THREAD_RET;
+}
+
+chanpool *chanpool_create(int threads){
+  chanpool *p;
+  int i;
+
+  if(threads<2)return NULL;
+  p=_ogg_calloc(1,sizeof(*p));
+  p->thread=_ogg_calloc(threads-1,sizeof(*p->thread));
+
+  v_mutex_init(&p->mutex);
+  v_cond_init(&p->go);
+  v_cond_init(&p->done);
+  for(i=0;i<threads-1;i++)
+    if(v_thread_create(p->thread+i,pool_thread,p))break;
+  p->threads=i;
+
+  if(p->threads==0){
+    chanpool_destroy(p);
+    return NULL;
+  }
+  return p;
+}
+
+void chanpool_destroy(chanpool *p){
+  int i;
+  if(!p)return;
+
+  pool_lock(p);
+  p->quit=1;
+  pool_unlock(p);
+  pool_post_go(p);
+
+  for(i=0;i<p->threads;i++)
+    v_thread_join(p->thread[i]);
+  v_cond_clear(&p->go);
+  v_cond_clear(&p->done);
+  v_mutex_clear(&p->mutex);
+
+  _ogg_free(p->thread);
+  _ogg_free(p);
+}
+
+void chanpool_run(chanpool *p,chanpool_func fn,void *arg,int n){
+  int i;
+
+  if(p && n>1){
+    pool_lock(p);
+    if(!p->busy){
+      p->busy=1;
+      p->fn=fn;
+      p->arg=arg;
+      p->n=n;
+      p->next=0;
+      p->left=n;
+      pool_unlock(p);
+      pool_post_go(p);
+
+      pool_lock(p);
+      pool_drain(p);
+      while(p->left)
+        pool_wait_done(p);
+      p->busy=0;
+      pool_unlock(p);
+      return;
+    }
+    pool_unlock(p);
+  }
+
+  for(i=0;i<n;i++)
+    fn(arg,i);
+}
+
+#else
+
+/* no threads here; synthesis stays serial */
+
+chanpool *chanpool_create(int threads){
+  return NULL;
+}
+
+void chanpool_destroy(chanpool *p){}
+
+void chanpool_run(chanpool *p,chanpool_func fn,void *arg,int n){
+  int i;
+  for(i=0;i<n;i++)
+    fn(arg,i);
+}
+
+#endif
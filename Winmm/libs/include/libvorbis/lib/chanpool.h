@@ -0,0 +1,35 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: small worker group splitting per channel synthesis work
+
+ ********************************************************************/
+
+#ifndef _V_CHANPOOL_H_
+#define _V_CHANPOOL_H_
+
+typedef struct chanpool chanpool;
+typedef void (*chanpool_func)(void *arg,int i);
+
+/* threads counts the calling thread, so threads-1 workers are
+   started. Returns NULL when threads < 2 or the platform has no
+   thread support. */
+extern chanpool *chanpool_create(int threads);
+extern void      chanpool_destroy(chanpool *p);
+
+/* fn(arg,i) for every i in 0..n-1, spread over the workers and the
+   calling thread; returns once all are done. When another thread is
+   already running a batch on p, the caller does all of this one
+   itself. */
+extern void      chanpool_run(chanpool *p,chanpool_func fn,void *arg,int n);
+
+#endif
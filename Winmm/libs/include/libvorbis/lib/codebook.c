@@ -19,6 +19,7 @@
 #include <string.h>
 #include <math.h>
 #include <ogg/ogg.h>
+#include <ogg/bitwise.h>
 #include "vorbis/codec.h"
 #include "codebook.h"
 #include "scales.h"
@@ -295,33 +296,41 @@ static ogg_uint32_t bitreverse(ogg_uint32_t x){
 
 STIN long decode_packed_entry_number(codebook *book, oggpack_buffer *b){
   int  read=book->dec_maxlength;
+  int  skip=book->dec_firsttablen;
   long lo,hi;
-  long lok = oggpack_look(b,book->dec_firsttablen);
+  long lok = oggpack_look_fast(b,skip);
 
   if (lok >= 0) {
-    long entry = book->dec_firsttable[lok];
-    if(entry&0x80000000UL){
-      lo=(entry>>15)&0x7fff;
-      hi=book->used_entries-(entry&0x7fff);
-    }else{
-      oggpack_adv(b, book->dec_codelengths[entry-1]);
+    ogg_uint32_t entry = book->dec_firsttable[lok];
+
+    /* walk down the subtables; only near the end of the packet can a
+       look come up short, the search below sorts that case out */
+    while(entry&DEC_SUBTABLE){
+      int bits=(entry>>26)&0x1f;
+      lok=oggpack_look_fast(b,skip+bits);
+      if(lok<0)break;
+      entry=book->dec_firsttable[(entry&0x3ffffff)+(lok>>skip)];
+      skip+=bits;
+    }
+    if(entry && !(entry&DEC_SUBTABLE)){
+      oggpack_adv_fast(b, book->dec_codelengths[entry-1]);
       return(entry-1);
     }
-  }else{
-    lo=0;
-    hi=book->used_entries;
   }
 
+  lo=0;
+  hi=book->used_entries;
+
   /* Single entry codebooks use a firsttablen of 1 and a
      dec_maxlength of 1.  If a single-entry codebook gets here (due to
      failure to read one bit above), the next look attempt will also
      fail and we'll correctly kick out instead of trying to walk the
      underformed tree */
 
-  lok = oggpack_look(b, read);
+  lok = oggpack_look_fast(b, read);
 
   while(lok<0 && read>1)
-    lok = oggpack_look(b, --read);
+    lok = oggpack_look_fast(b, --read);
   if(lok<0)return -1;
 
   /* bisect search for the codeword in the ordered list */
@@ -336,12 +345,12 @@ STIN long decode_packed_entry_number(codebook *book, oggpack_buffer *b){
       }
 
     if(book->dec_codelengths[lo]<=read){
-      oggpack_adv(b, book->dec_codelengths[lo]);
+      oggpack_adv_fast(b, book->dec_codelengths[lo]);
       return(lo);
     }
   }
 
-  oggpack_adv(b, read);
+  oggpack_adv_fast(b, read);
 
   return(-1);
 }
@@ -372,66 +381,101 @@ long vorbis_book_decode(codebook *book, oggpack_buffer *b){
   return(-1);
 }
 
-/* returns 0 on OK or -1 on eof *************************************/
+/* The vector decoders below are written once against a dim argument.
+   Each is instanced with a constant dim for the dimensions the stock
+   books use, where the compiler unrolls the per entry loops, and once
+   with book->dim as the fallback. vorbis_book_init_decodev picks the
+   instance per book so the decode loops never look at book->dim. */
+
 /* decode vector / dim granularity gaurding is done in the upper layer */
-long vorbis_book_decodevs_add(codebook *book,float *a,oggpack_buffer *b,int n){
-  if(book->used_entries>0){
-    int step=n/book->dim;
-    long *entry = alloca(sizeof(*entry)*step);
-    float **t = alloca(sizeof(*t)*step);
-    int i,j,o;
-
-    for (i = 0; i < step; i++) {
-      entry[i]=decode_packed_entry_number(book,b);
-      if(entry[i]==-1)return(-1);
-      t[i] = book->valuelist+entry[i]*book->dim;
-    }
-    for(i=0,o=0;i<book->dim;i++,o+=step)
-      for (j=0;j<step;j++)
-        a[o+j]+=t[j][i];
+STIN long decodevs_add_dim(codebook *book,float *a,oggpack_buffer *b,
+                           int n,const int dim){
+  int step=n/dim;
+  const float **t = alloca(sizeof(*t)*step);
+  int i,j,o;
+
+  for (i = 0; i < step; i++) {
+    long entry=decode_packed_entry_number(book,b);
+    if(entry==-1)return(-1);
+    t[i] = book->valuelist+entry*dim;
   }
+  for(i=0,o=0;i<dim;i++,o+=step)
+    for (j=0;j<step;j++)
+      a[o+j]+=t[j][i];
   return(0);
 }
 
 /* decode vector / dim granularity gaurding is done in the upper layer */
-long vorbis_book_decodev_add(codebook *book,float *a,oggpack_buffer *b,int n){
-  if(book->used_entries>0){
-    int i,j,entry;
-    float *t;
-
-    if(book->dim>8){
-      for(i=0;i<n;){
-        entry = decode_packed_entry_number(book,b);
-        if(entry==-1)return(-1);
-        t     = book->valuelist+entry*book->dim;
-        for (j=0;j<book->dim;)
-          a[i++]+=t[j++];
-      }
+STIN long decodev_add_dim(codebook *book,float *a,oggpack_buffer *b,
+                          int n,const int dim){
+  int i,j;
+
+  for(i=0;i<n;){
+    long entry = decode_packed_entry_number(book,b);
+    const float *t;
+    if(entry==-1)return(-1);
+    t = book->valuelist+entry*dim;
+    for (j=0;j<dim;j++)
+      a[i+j]+=t[j];
+    i+=dim;
+  }
+  return(0);
+}
+
+/* n need not be a multiple of dim here; the last vector is cut short */
+STIN long decodev_set_dim(codebook *book,float *a,oggpack_buffer *b,
+                          int n,const int dim){
+  int i,j;
+
+  for(i=0;i<n;){
+    long entry = decode_packed_entry_number(book,b);
+    const float *t;
+    if(entry==-1)return(-1);
+    t = book->valuelist+entry*dim;
+    if(n-i>=dim){
+      for (j=0;j<dim;j++)
+        a[i+j]=t[j];
+      i+=dim;
     }else{
-      for(i=0;i<n;){
-        entry = decode_packed_entry_number(book,b);
-        if(entry==-1)return(-1);
-        t     = book->valuelist+entry*book->dim;
-        j=0;
-        switch((int)book->dim){
-        case 8:
-          a[i++]+=t[j++];
-        case 7:
-          a[i++]+=t[j++];
-        case 6:
-          a[i++]+=t[j++];
-        case 5:
-          a[i++]+=t[j++];
-        case 4:
-          a[i++]+=t[j++];
-        case 3:
-          a[i++]+=t[j++];
-        case 2:
-          a[i++]+=t[j++];
-        case 1:
-          a[i++]+=t[j++];
-        case 0:
-          break;
+      for (j=0;i<n;)
+        a[i++]=t[j++];
+    }
+  }
+  return(0);
+}
+
+STIN long decodevv_add_dim(codebook *book,float **a,long offset,int ch,
+                           oggpack_buffer *b,int n,const int dim){
+  long i,j,entry;
+  int chptr=0;
+
+  if(ch==2 && !(dim&1)){
+    /* the usual coupled stereo case: every vector is whole frames, so
+       it goes straight into the two channels */
+    float *a0=a[0],*a1=a[1];
+    for(i=offset/2;i<(offset+n)/2;){
+      const float *t;
+      entry = decode_packed_entry_number(book,b);
+      if(entry==-1)return(-1);
+      t = book->valuelist+entry*dim;
+      for (j=0;j<dim;j+=2,i++){
+        a0[i]+=t[j];
+        a1[i]+=t[j+1];
+      }
+    }
+    return(0);
+  }
+
+  for(i=offset/ch;i<(offset+n)/ch;){
+    entry = decode_packed_entry_number(book,b);
+    if(entry==-1)return(-1);
+    {
+      const float *t = book->valuelist+entry*dim;
+      for (j=0;j<dim;j++){
+        a[chptr++][i]+=t[j];
+        if(chptr==ch){
+          chptr=0;
+          i++;
         }
       }
     }
@@ -439,23 +483,80 @@ long vorbis_book_decodev_add(codebook *book,float *a,oggpack_buffer *b,int n){
   return(0);
 }
 
+#define DECODEV_INSTANCES(name,dim)                                     \
+  static long decodevs_add_##name(codebook *book,float *a,              \
+                                  oggpack_buffer *b,int n){             \
+    return decodevs_add_dim(book,a,b,n,dim);                            \
+  }                                                                     \
+  static long decodev_add_##name(codebook *book,float *a,               \
+                                 oggpack_buffer *b,int n){              \
+    return decodev_add_dim(book,a,b,n,dim);                             \
+  }                                                                     \
+  static long decodev_set_##name(codebook *book,float *a,               \
+                                 oggpack_buffer *b,int n){              \
+    return decodev_set_dim(book,a,b,n,dim);                             \
+  }                                                                     \
+  static long decodevv_add_##name(codebook *book,float **a,long off,    \
+                                  int ch,oggpack_buffer *b,int n){      \
+    return decodevv_add_dim(book,a,off,ch,b,n,dim);                     \
+  }
+
+DECODEV_INSTANCES(1,1)
+DECODEV_INSTANCES(2,2)
+DECODEV_INSTANCES(4,4)
+DECODEV_INSTANCES(8,8)
+DECODEV_INSTANCES(any,(int)book->dim)
+
+#define DECODEV_SELECT(book,name)               \
+  do{                                           \
+    (book)->decodevs_add=decodevs_add_##name;   \
+    (book)->decodev_add=decodev_add_##name;     \
+    (book)->decodev_set=decodev_set_##name;     \
+    (book)->decodevv_add=decodevv_add_##name;   \
+  }while(0)
+
+void vorbis_book_init_decodev(codebook *book){
+  switch((int)book->dim){
+  case 1:
+    DECODEV_SELECT(book,1);
+    break;
+  case 2:
+    DECODEV_SELECT(book,2);
+    break;
+  case 4:
+    DECODEV_SELECT(book,4);
+    break;
+  case 8:
+    DECODEV_SELECT(book,8);
+    break;
+  default:
+    DECODEV_SELECT(book,any);
+    break;
+  }
+}
+
+/* returns 0 on OK or -1 on eof *************************************/
+/* decode vector / dim granularity gaurding is done in the upper layer */
+long vorbis_book_decodevs_add(codebook *book,float *a,oggpack_buffer *b,int n){
+  if(book->used_entries>0)
+    return(book->decodevs_add(book,a,b,n));
+  return(0);
+}
+
+/* decode vector / dim granularity gaurding is done in the upper layer */
+long vorbis_book_decodev_add(codebook *book,float *a,oggpack_buffer *b,int n){
+  if(book->used_entries>0)
+    return(book->decodev_add(book,a,b,n));
+  return(0);
+}
+
 /* unlike the others, we guard against n not being an integer number
    of <dim> internally rather than in the upper layer (called only by
    floor0) */
 long vorbis_book_decodev_set(codebook *book,float *a,oggpack_buffer *b,int n){
-  if(book->used_entries>0){
-    int i,j,entry;
-    float *t;
-
-    for(i=0;i<n;){
-      entry = decode_packed_entry_number(book,b);
-      if(entry==-1)return(-1);
-      t     = book->valuelist+entry*book->dim;
-      for (j=0;i<n && j<book->dim;){
-        a[i++]=t[j++];
-      }
-    }
-  }else{
+  if(book->used_entries>0)
+    return(book->decodev_set(book,a,b,n));
+  else{
     int i;
 
     for(i=0;i<n;){
@@ -467,24 +568,7 @@ long vorbis_book_decodev_set(codebook *book,float *a,oggpack_buffer *b,int n){
 
 long vorbis_book_decodevv_add(codebook *book,float **a,long offset,int ch,
                               oggpack_buffer *b,int n){
-
-  long i,j,entry;
-  int chptr=0;
-  if(book->used_entries>0){
-    for(i=offset/ch;i<(offset+n)/ch;){
-      entry = decode_packed_entry_number(book,b);
-      if(entry==-1)return(-1);
-      {
-        const float *t = book->valuelist+entry*book->dim;
-        for (j=0;j<book->dim;j++){
-          a[chptr++][i]+=t[j];
-          if(chptr==ch){
-            chptr=0;
-            i++;
-          }
-        }
-      }
-    }
-  }
+  if(book->used_entries>0)
+    return(book->decodevv_add(book,a,offset,ch,b,n));
   return(0);
 }
@@ -55,6 +55,13 @@ typedef struct static_codebook{
   int allocedp;
 } static_codebook;
 
+/* decode table slots pointing at a subtable; bits 26-30 hold its width */
+#define DEC_SUBTABLE      0x80000000UL
+/* widest subtable, and the most subtable slots a book may use; books
+   that need more get narrower subtables */
+#define DEC_SUBTABLE_BITS 6
+#define DEC_TABLE_BUDGET  4096
+
 typedef struct codebook{
   long dim;           /* codebook dimensions (elements per vector) */
   long entries;       /* codebook entries */
@@ -69,19 +76,34 @@ typedef struct codebook{
 
   int          *dec_index;  /* only used if sparseness collapsed */
   char         *dec_codelengths;
-  ogg_uint32_t *dec_firsttable;
+  ogg_uint32_t *dec_firsttable; /* multi-level, see _make_decode_table */
   int           dec_firsttablen;
   int           dec_maxlength;
+  int           dec_stock;  /* the above are constant, see stockbooks.h */
 
   /* The current encoder uses only centered, integer-only lattice books. */
   int           quantvals;
   int           minval;
   int           delta;
+
+  /* vector decoders; unrolled for the book's dim where there is a
+     specialized one, picked by vorbis_book_init_decode */
+  long (*decodevs_add)(struct codebook *book,float *a,oggpack_buffer *b,
+                       int n);
+  long (*decodev_add)(struct codebook *book,float *a,oggpack_buffer *b,
+                      int n);
+  long (*decodev_set)(struct codebook *book,float *a,oggpack_buffer *b,
+                      int n);
+  long (*decodevv_add)(struct codebook *book,float **a,long off,int ch,
+                       oggpack_buffer *b,int n);
 } codebook;
 
 extern void vorbis_staticbook_destroy(static_codebook *b);
 extern int vorbis_book_init_encode(codebook *dest,const static_codebook *source);
 extern int vorbis_book_init_decode(codebook *dest,const static_codebook *source);
+extern int vorbis_book_build_decode(codebook *dest,const static_codebook *source);
+extern ogg_uint32_t _vorbis_book_hash(const static_codebook *b);
+extern long _vorbis_book_table_size(const codebook *c);
 extern void vorbis_book_clear(codebook *b);
 
 extern float *_book_unquantize(const static_codebook *b,int n,int *map);
@@ -102,6 +124,7 @@ extern static_codebook *vorbis_staticbook_unpack(oggpack_buffer *b);
 
 extern int vorbis_book_encode(codebook *book, int a, oggpack_buffer *b);
 
+extern void vorbis_book_init_decodev(codebook *book);
 extern long vorbis_book_decode(codebook *book, oggpack_buffer *b);
 extern long vorbis_book_decodevs_add(codebook *book, float *a,
                                      oggpack_buffer *b,int n);
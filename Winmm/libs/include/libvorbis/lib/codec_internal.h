@@ -20,6 +20,7 @@
 
 #include "envelope.h"
 #include "codebook.h"
+#include "chanpool.h"
 
 #define BLOCKTYPE_IMPULSE    0
 #define BLOCKTYPE_PADDING    1
@@ -82,6 +83,11 @@ typedef struct private_state {
   bitrate_manager_state bms;
 
   ogg_int64_t sample_count;
+
+  /* decode side channel threads; see vorbis_synthesis_threads */
+  chanpool *chpool;
+  int       chpool_channels;
+  long      chpool_blocksize;
 } private_state;
 
 /* codec_setup_info contains all the setup information specific to the
@@ -128,6 +134,9 @@ typedef struct codec_setup_info {
                                 highly redundant structure, but
                                 improves clarity of program flow. */
   int         halfrate_flag; /* painless downsample for decode */
+
+  struct vorbis_setup *setup; /* when the above is shared with other
+                                 streams; see setupcache.c */
 } codec_setup_info;
 
 extern vorbis_look_psy_global *_vp_global_look(vorbis_info *vi);
@@ -151,6 +160,9 @@ typedef struct {
   long phrasebits;
   long postbits;
   long frames;
+
+  /* multiplies d[x0..min(x1,n)) by the dB curve from y0 to y1 */
+  void (*render_line)(int n,int x0,int x1,int y0,int y1,float *d);
 } vorbis_look_floor1;
 
 
@@ -0,0 +1,290 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: inverse square polar channel coupling
+
+ ********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ogg/cpu.h>
+#include "vorbis/codec.h"
+#include "os.h"
+#include "couple.h"
+
+#ifdef OGG_ARCH_X86
+#  define COUPLE_X86
+#  include <immintrin.h>
+#elif defined(OGG_ARCH_ARM64)
+#  define COUPLE_NEON
+#  include <arm_neon.h>
+#endif
+
+/* the loop as it was in mapping0_inverse; the reference for the rest */
+static void couple_inverse_c(float *pcmM,float *pcmA,long n){
+  long j;
+
+  for(j=0;j<n;j++){
+    float mag=pcmM[j];
+    float ang=pcmA[j];
+
+    if(mag>0)
+      if(ang>0){
+        pcmM[j]=mag;
+        pcmA[j]=mag-ang;
+      }else{
+        pcmA[j]=mag;
+        pcmM[j]=mag+ang;
+      }
+    else
+      if(ang>0){
+        pcmM[j]=mag;
+        pcmA[j]=mag+ang;
+      }else{
+        pcmA[j]=mag;
+        pcmM[j]=mag-ang;
+      }
+  }
+}
+
+/* The four branches above come down to: one channel keeps mag, and
+   that is M when ang>0 and A otherwise; the other gets mag-ang when
+   mag>0 and ang>0 agree and mag+ang when they don't. The vector
+   kernels compute both sums and pick with the two compare masks.
+   Nothing is rewritten as a sign flip, so -0, infinities and NaN come
+   out bit for bit as in the loop above. */
+
+#if defined(COUPLE_X86) || defined(COUPLE_NEON)
+
+#ifdef COUPLE_X86
+
+typedef __m128 v4;
+
+#define V4_TARGET OGG_TARGET_SSE2
+
+V4_TARGET STIN v4 v4_load(const float *p){ return _mm_loadu_ps(p); }
+V4_TARGET STIN void v4_store(float *p,v4 a){ _mm_storeu_ps(p,a); }
+V4_TARGET STIN v4 v4_add(v4 a,v4 b){ return _mm_add_ps(a,b); }
+V4_TARGET STIN v4 v4_sub(v4 a,v4 b){ return _mm_sub_ps(a,b); }
+V4_TARGET STIN v4 v4_gtzero(v4 a){ return _mm_cmpgt_ps(a,_mm_setzero_ps()); }
+V4_TARGET STIN v4 v4_xor(v4 a,v4 b){ return _mm_xor_ps(a,b); }
+/* m?a:b for all-ones / all-zeros lanes of m */
+V4_TARGET STIN v4 v4_select(v4 m,v4 a,v4 b){
+  return _mm_or_ps(_mm_and_ps(m,a),_mm_andnot_ps(m,b));
+}
+
+#else /* COUPLE_NEON */
+
+typedef float32x4_t v4;
+
+#define V4_TARGET
+
+STIN v4 v4_load(const float *p){ return vld1q_f32(p); }
+STIN void v4_store(float *p,v4 a){ vst1q_f32(p,a); }
+STIN v4 v4_add(v4 a,v4 b){ return vaddq_f32(a,b); }
+STIN v4 v4_sub(v4 a,v4 b){ return vsubq_f32(a,b); }
+STIN v4 v4_gtzero(v4 a){
+  return vreinterpretq_f32_u32(vcgtq_f32(a,vdupq_n_f32(0.f)));
+}
+STIN v4 v4_xor(v4 a,v4 b){
+  return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a),
+                                         vreinterpretq_u32_f32(b)));
+}
+STIN v4 v4_select(v4 m,v4 a,v4 b){
+  return vbslq_f32(vreinterpretq_u32_f32(m),a,b);
+}
+
+#endif
+
+V4_TARGET static long couple_inverse_v4(float *pcmM,float *pcmA,long n){
+  long j;
+
+  for(j=0;j+4<=n;j+=4){
+    v4 mag=v4_load(pcmM+j);
+    v4 ang=v4_load(pcmA+j);
+    v4 angp=v4_gtzero(ang);
+    v4 diff=v4_xor(v4_gtzero(mag),angp);
+    v4 other=v4_select(diff,v4_add(mag,ang),v4_sub(mag,ang));
+
+    v4_store(pcmM+j,v4_select(angp,mag,other));
+    v4_store(pcmA+j,v4_select(angp,other,mag));
+  }
+  return j;
+}
+
+#endif
+
+#ifdef COUPLE_X86
+
+OGG_TARGET_AVX2 static long couple_inverse_avx2(float *pcmM,float *pcmA,
+                                                long n){
+  __m256 zero=_mm256_setzero_ps();
+  long j;
+
+  for(j=0;j+8<=n;j+=8){
+    __m256 mag=_mm256_loadu_ps(pcmM+j);
+    __m256 ang=_mm256_loadu_ps(pcmA+j);
+    __m256 angp=_mm256_cmp_ps(ang,zero,_CMP_GT_OQ);
+    __m256 diff=_mm256_xor_ps(_mm256_cmp_ps(mag,zero,_CMP_GT_OQ),angp);
+    __m256 other=_mm256_blendv_ps(_mm256_sub_ps(mag,ang),
+                                  _mm256_add_ps(mag,ang),diff);
+
+    _mm256_storeu_ps(pcmM+j,_mm256_blendv_ps(other,mag,angp));
+    _mm256_storeu_ps(pcmA+j,_mm256_blendv_ps(mag,other,angp));
+  }
+  return j;
+}
+
+#endif
+
+/* bit 1<<COUPLE_IMPL_x for every implementation this CPU can run */
+static int couple_cpu_impls(void){
+  int cpu=ogg_cpu_features(),impls=1<<COUPLE_IMPL_C;
+#ifdef COUPLE_X86
+  if(cpu&OGG_CPU_SSE2)impls|=1<<COUPLE_IMPL_SSE2;
+  if(cpu&OGG_CPU_AVX2)impls|=1<<COUPLE_IMPL_AVX2;
+#endif
+#ifdef COUPLE_NEON
+  if(cpu&OGG_CPU_NEON)impls|=1<<COUPLE_IMPL_NEON;
+#endif
+  return impls;
+}
+
+int couple_inverse_impl(int impl,float *mag,float *ang,long n){
+  int impls=couple_cpu_impls();
+  long j;
+
+  if(impl<0 || !(impls&(1<<impl)))return 0;
+
+  switch(impl){
+#ifdef COUPLE_X86
+  case COUPLE_IMPL_SSE2:
+    j=couple_inverse_v4(mag,ang,n);
+    break;
+  case COUPLE_IMPL_AVX2:
+    j=couple_inverse_avx2(mag,ang,n);
+    break;
+#endif
+#ifdef COUPLE_NEON
+  case COUPLE_IMPL_NEON:
+    j=couple_inverse_v4(mag,ang,n);
+    break;
+#endif
+  default:
+    j=0;
+    break;
+  }
+
+  if(j<n)
+    couple_inverse_c(mag+j,ang+j,n-j);
+  return 1;
+}
+
+void couple_inverse(float *mag,float *ang,long n){
+  if(!couple_inverse_impl(COUPLE_IMPL_AVX2,mag,ang,n) &&
+     !couple_inverse_impl(COUPLE_IMPL_SSE2,mag,ang,n) &&
+     !couple_inverse_impl(COUPLE_IMPL_NEON,mag,ang,n))
+    couple_inverse_c(mag,ang,n);
+}
+
+#ifdef _V_SELFTEST
+
+/* Runs every pairing of a set of magnitudes and angles that covers
+   each sign, both zeros, denormals, infinities and NaN of either sign
+   through every implementation this CPU can run, at every offset and
+   length up to a few vectors, and compares the bits with the reference
+   loop. Then times a long block of music-like random signs. */
+
+#include <stdio.h>
+#include <time.h>
+
+#define TEST_VALUES 14
+#define TEST_PAIRS  (TEST_VALUES*TEST_VALUES)
+#define BLOCK       1024
+#define BLOCKS      100000
+
+static const char *names[]={"c","sse2","avx2","neon"};
+
+static float test_value(int i){
+  static const float s[]={0.f,1e-40f,.5f,3.f,1e30f};
+  float inf=(float)HUGE_VAL;
+  float v;
+
+  switch(i>>1){
+  case 5: v=inf; break;
+  case 6: v=inf-inf; break;
+  default: v=s[i>>1]; break;
+  }
+  return (i&1)?-v:v;
+}
+
+int main(){
+  float mag[TEST_PAIRS],ang[TEST_PAIRS];
+  float refM[TEST_PAIRS],refA[TEST_PAIRS];
+  float outM[TEST_PAIRS],outA[TEST_PAIRS];
+  float *bM=malloc(sizeof(*bM)*BLOCK);
+  float *bA=malloc(sizeof(*bA)*BLOCK);
+  int impl,i,failed=0;
+  long off,n,k;
+
+  /* every (mag,ang) pairing once; the offsets and lengths below move
+     each one through every lane and the scalar tail */
+  for(i=0;i<TEST_PAIRS;i++){
+    mag[i]=test_value(i/TEST_VALUES);
+    ang[i]=test_value(i%TEST_VALUES);
+  }
+
+  srand(0);
+  for(k=0;k<BLOCK;k++){
+    bM[k]=((float)rand()/RAND_MAX-.5f)*64.f;
+    bA[k]=((float)rand()/RAND_MAX-.5f)*64.f;
+  }
+
+  for(impl=0;impl<(int)(sizeof(names)/sizeof(*names));impl++){
+    clock_t start;
+
+    if(!couple_inverse_impl(impl,outM,outA,0))continue;
+    fprintf(stderr,"Coupling with %s... ",names[impl]);
+
+    for(off=0;off<TEST_PAIRS && !failed;off++)
+      for(n=1;n<=33 && !failed;n++){
+        for(k=0;k<TEST_PAIRS;k++){
+          refM[k]=outM[k]=mag[(k+off)%TEST_PAIRS];
+          refA[k]=outA[k]=ang[(k+off)%TEST_PAIRS];
+        }
+        couple_inverse_c(refM,refA,n);
+        couple_inverse_impl(impl,outM,outA,n);
+        if(memcmp(refM,outM,sizeof(refM)) || memcmp(refA,outA,sizeof(refA))){
+          fprintf(stderr,"\n  mismatch: offset %ld, length %ld",off,n);
+          failed=1;
+        }
+      }
+    if(failed){
+      fprintf(stderr,"\n");
+      break;
+    }
+
+    /* each pass leaves the block a new set of signs to go on with */
+    start=clock();
+    for(k=0;k<BLOCKS;k++)
+      couple_inverse_impl(impl,bM,bA,BLOCK);
+    fprintf(stderr,"OK, %.0f ns per %d pair block\n",
+            (double)(clock()-start)/CLOCKS_PER_SEC*1e9/BLOCKS,BLOCK);
+  }
+
+  free(bM);
+  free(bA);
+  return(failed);
+}
+
+#endif
@@ -0,0 +1,32 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: inverse square polar channel coupling
+
+ ********************************************************************/
+
+#ifndef _V_COUPLE_H_
+#define _V_COUPLE_H_
+
+#define COUPLE_IMPL_C    0
+#define COUPLE_IMPL_SSE2 1
+#define COUPLE_IMPL_AVX2 2
+#define COUPLE_IMPL_NEON 3
+
+/* turns n magnitude/angle pairs back into the two channels, in place */
+extern void couple_inverse(float *mag,float *ang,long n);
+
+/* same with a given implementation; returns 0 and leaves the vectors
+   alone when impl isn't built in or the CPU can't run it */
+extern int couple_inverse_impl(int impl,float *mag,float *ang,long n);
+
+#endif
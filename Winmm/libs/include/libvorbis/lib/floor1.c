@@ -19,15 +19,30 @@
 #include <string.h>
 #include <math.h>
 #include <ogg/ogg.h>
+#include <ogg/cpu.h>
 #include "vorbis/codec.h"
 #include "codec_internal.h"
 #include "registry.h"
 #include "codebook.h"
 #include "misc.h"
 #include "scales.h"
+#include "os.h"
 
 #include <stdio.h>
 
+#ifdef OGG_ARCH_X86
+#  define FLOOR1_X86
+#  include <immintrin.h>
+#elif defined(OGG_ARCH_ARM64)
+#  define FLOOR1_NEON
+#  include <arm_neon.h>
+#endif
+
+#define FLOOR1_IMPL_C    0
+#define FLOOR1_IMPL_SSE2 1
+#define FLOOR1_IMPL_AVX2 2
+#define FLOOR1_IMPL_NEON 3
+
 #define floor1_rangedB 140 /* floor 1 fixed at -140dB to 0dB range */
 
 typedef struct lsfit_acc{
@@ -178,6 +193,8 @@ static vorbis_info_floor *floor1_unpack (vorbis_info *vi,oggpack_buffer *opb){
   return(NULL);
 }
 
+static void floor1_select(vorbis_look_floor1 *look);
+
 static vorbis_look_floor *floor1_look(vorbis_dsp_state *vd,
                                       vorbis_info_floor *in){
 
@@ -190,6 +207,7 @@ static vorbis_look_floor *floor1_look(vorbis_dsp_state *vd,
 
   look->vi=info;
   look->n=info->postlist[1];
+  floor1_select(look);
 
   /* we drop each position value in-between already decoded values,
      and use linear interpolation to predict each new value past the
@@ -374,6 +392,278 @@ static void render_line(int n, int x0,int x1,int y0,int y1,float *d){
   }
 }
 
+/* render_line unrolled across lanes. Lane l handles every Wth sample
+   from x0+l on, and moves W samples per step: err by W*ady mod adx, y
+   by W*base plus sy-base for every time err wraps. The first W samples
+   are stepped one at a time to seed the lanes, so every lane visits
+   exactly the (y,err) sequence of the scalar loop and the products are
+   bit for bit the same. When the line is shallow enough that the W
+   samples of a step span at most two adjacent y, the two lookups are
+   broadcast and blended instead of gathered. */
+
+#if defined(FLOOR1_X86) || defined(FLOOR1_NEON)
+
+#ifdef FLOOR1_X86
+
+typedef __m128 v4;
+typedef __m128i v4i;
+
+#define V4_TARGET OGG_TARGET_SSE2
+
+V4_TARGET STIN v4 v4_load(const float *p){ return _mm_loadu_ps(p); }
+V4_TARGET STIN void v4_store(float *p,v4 a){ _mm_storeu_ps(p,a); }
+V4_TARGET STIN v4 v4_mul(v4 a,v4 b){ return _mm_mul_ps(a,b); }
+V4_TARGET STIN v4 v4_set1(float f){ return _mm_set1_ps(f); }
+V4_TARGET STIN v4 v4_select(v4i m,v4 a,v4 b){
+  return _mm_or_ps(_mm_and_ps(_mm_castsi128_ps(m),a),
+                   _mm_andnot_ps(_mm_castsi128_ps(m),b));
+}
+V4_TARGET STIN v4i v4i_load(const int *p){ return _mm_loadu_si128((const __m128i *)p); }
+V4_TARGET STIN void v4i_store(int *p,v4i a){ _mm_storeu_si128((__m128i *)p,a); }
+V4_TARGET STIN v4i v4i_set1(int i){ return _mm_set1_epi32(i); }
+V4_TARGET STIN v4i v4i_add(v4i a,v4i b){ return _mm_add_epi32(a,b); }
+V4_TARGET STIN v4i v4i_sub(v4i a,v4i b){ return _mm_sub_epi32(a,b); }
+V4_TARGET STIN v4i v4i_and(v4i a,v4i b){ return _mm_and_si128(a,b); }
+V4_TARGET STIN v4i v4i_gt(v4i a,v4i b){ return _mm_cmpgt_epi32(a,b); }
+V4_TARGET STIN v4i v4i_eq(v4i a,v4i b){ return _mm_cmpeq_epi32(a,b); }
+V4_TARGET STIN int v4i_lane0(v4i a){ return _mm_cvtsi128_si32(a); }
+
+#else /* FLOOR1_NEON */
+
+typedef float32x4_t v4;
+typedef int32x4_t v4i;
+
+#define V4_TARGET
+
+STIN v4 v4_load(const float *p){ return vld1q_f32(p); }
+STIN void v4_store(float *p,v4 a){ vst1q_f32(p,a); }
+STIN v4 v4_mul(v4 a,v4 b){ return vmulq_f32(a,b); }
+STIN v4 v4_set1(float f){ return vdupq_n_f32(f); }
+STIN v4 v4_select(v4i m,v4 a,v4 b){
+  return vbslq_f32(vreinterpretq_u32_s32(m),a,b);
+}
+STIN v4i v4i_load(const int *p){ return vld1q_s32(p); }
+STIN void v4i_store(int *p,v4i a){ vst1q_s32(p,a); }
+STIN v4i v4i_set1(int i){ return vdupq_n_s32(i); }
+STIN v4i v4i_add(v4i a,v4i b){ return vaddq_s32(a,b); }
+STIN v4i v4i_sub(v4i a,v4i b){ return vsubq_s32(a,b); }
+STIN v4i v4i_and(v4i a,v4i b){ return vandq_s32(a,b); }
+STIN v4i v4i_gt(v4i a,v4i b){ return vreinterpretq_s32_u32(vcgtq_s32(a,b)); }
+STIN v4i v4i_eq(v4i a,v4i b){ return vreinterpretq_s32_u32(vceqq_s32(a,b)); }
+STIN int v4i_lane0(v4i a){ return vgetq_lane_s32(a,0); }
+
+#endif
+
+V4_TARGET static void render_line_v4(int n,int x0,int x1,int y0,int y1,
+                                     float *d){
+  int dy=y1-y0;
+  int adx=x1-x0;
+  int ady=abs(dy);
+  int base=dy/adx;
+  int sy=(dy<0?base-1:base+1);
+  int x=x0;
+  int y=y0;
+  int err=0;
+  int ly[4],le[4],l;
+
+  ady-=abs(base*adx);
+
+  if(n>x1)n=x1;
+
+  if(n-x0<4){
+    render_line(n,x0,x1,y0,y1,d);
+    return;
+  }
+
+  ly[0]=y;
+  le[0]=err;
+  for(l=1;l<=4;l++){
+    err=err+ady;
+    if(err>=adx){
+      err-=adx;
+      y+=sy;
+    }else{
+      y+=base;
+    }
+    if(l<4){
+      ly[l]=y;
+      le[l]=err;
+    }
+  }
+
+  {
+    /* y and err are now those of sample x0+4, so what a lane gains
+       over four samples */
+    int shallow=(base==0 && ady*3<adx);
+    v4i vy=v4i_load(ly);
+    v4i verr=v4i_load(le);
+    v4i vstep=v4i_set1(y-y0);
+    v4i vwrap=v4i_set1(sy-base);
+    v4i vady=v4i_set1(err);
+    v4i vadx=v4i_set1(adx);
+    v4i vlim=v4i_set1(adx-1);
+
+    for(x=x0;x+4<=n;x+=4){
+      v4i m;
+      v4 f;
+
+      if(shallow){
+        int y0l=v4i_lane0(vy);
+        f=v4_select(v4i_eq(vy,v4i_set1(y0l)),
+                    v4_set1(FLOOR1_fromdB_LOOKUP[y0l]),
+                    v4_set1(FLOOR1_fromdB_LOOKUP[(y0l+sy-base)&255]));
+      }else{
+        float t[4];
+        v4i_store(ly,vy);
+        for(l=0;l<4;l++)t[l]=FLOOR1_fromdB_LOOKUP[ly[l]];
+        f=v4_load(t);
+      }
+      v4_store(d+x,v4_mul(v4_load(d+x),f));
+
+      verr=v4i_add(verr,vady);
+      m=v4i_gt(verr,vlim);
+      verr=v4i_sub(verr,v4i_and(m,vadx));
+      vy=v4i_add(vy,v4i_add(vstep,v4i_and(m,vwrap)));
+    }
+
+    /* the lanes already hold the y of the last few samples */
+    v4i_store(ly,vy);
+    for(l=0;x<n;x++,l++)
+      d[x]*=FLOOR1_fromdB_LOOKUP[ly[l]];
+  }
+}
+
+#endif
+
+#ifdef FLOOR1_X86
+
+OGG_TARGET_AVX2 static void render_line_avx2(int n,int x0,int x1,
+                                             int y0,int y1,float *d){
+  int dy=y1-y0;
+  int adx=x1-x0;
+  int ady=abs(dy);
+  int base=dy/adx;
+  int sy=(dy<0?base-1:base+1);
+  int x=x0;
+  int y=y0;
+  int err=0;
+  int ly[8],le[8],l;
+
+  ady-=abs(base*adx);
+
+  if(n>x1)n=x1;
+
+  if(n-x0<8){
+    render_line(n,x0,x1,y0,y1,d);
+    return;
+  }
+
+  ly[0]=y;
+  le[0]=err;
+  for(l=1;l<=8;l++){
+    err=err+ady;
+    if(err>=adx){
+      err-=adx;
+      y+=sy;
+    }else{
+      y+=base;
+    }
+    if(l<8){
+      ly[l]=y;
+      le[l]=err;
+    }
+  }
+
+  {
+    /* y and err are now those of sample x0+8, so what a lane gains
+       over eight samples */
+    int shallow=(base==0 && ady*7<adx);
+    __m256i vy=_mm256_loadu_si256((const __m256i *)ly);
+    __m256i verr=_mm256_loadu_si256((const __m256i *)le);
+    __m256i vstep=_mm256_set1_epi32(y-y0);
+    __m256i vwrap=_mm256_set1_epi32(sy-base);
+    __m256i vady=_mm256_set1_epi32(err);
+    __m256i vadx=_mm256_set1_epi32(adx);
+    __m256i vlim=_mm256_set1_epi32(adx-1);
+
+    for(x=x0;x+8<=n;x+=8){
+      __m256i m;
+      __m256 f;
+
+      if(shallow){
+        int y0l=_mm_cvtsi128_si32(_mm256_castsi256_si128(vy));
+        f=_mm256_blendv_ps(
+          _mm256_set1_ps(FLOOR1_fromdB_LOOKUP[(y0l+sy-base)&255]),
+          _mm256_set1_ps(FLOOR1_fromdB_LOOKUP[y0l]),
+          _mm256_castsi256_ps(_mm256_cmpeq_epi32(vy,_mm256_set1_epi32(y0l))));
+      }else{
+        f=_mm256_i32gather_ps(FLOOR1_fromdB_LOOKUP,vy,4);
+      }
+      _mm256_storeu_ps(d+x,_mm256_mul_ps(_mm256_loadu_ps(d+x),f));
+
+      verr=_mm256_add_epi32(verr,vady);
+      m=_mm256_cmpgt_epi32(verr,vlim);
+      verr=_mm256_sub_epi32(verr,_mm256_and_si256(m,vadx));
+      vy=_mm256_add_epi32(vy,_mm256_add_epi32(vstep,
+                                              _mm256_and_si256(m,vwrap)));
+    }
+
+    /* the lanes already hold the y of the last few samples */
+    _mm256_storeu_si256((__m256i *)ly,vy);
+    for(l=0;x<n;x++,l++)
+      d[x]*=FLOOR1_fromdB_LOOKUP[ly[l]];
+  }
+}
+
+#endif
+
+/* bit 1<<FLOOR1_IMPL_x for every implementation this CPU can run */
+static int floor1_cpu_impls(void){
+  int cpu=ogg_cpu_features(),impls=1<<FLOOR1_IMPL_C;
+#ifdef FLOOR1_X86
+  if(cpu&OGG_CPU_SSE2)impls|=1<<FLOOR1_IMPL_SSE2;
+  if(cpu&OGG_CPU_AVX2)impls|=1<<FLOOR1_IMPL_AVX2;
+#endif
+#ifdef FLOOR1_NEON
+  if(cpu&OGG_CPU_NEON)impls|=1<<FLOOR1_IMPL_NEON;
+#endif
+  return impls;
+}
+
+typedef void (*render_line_func)(int n,int x0,int x1,int y0,int y1,float *d);
+
+/* the render_line of implementation impl, or NULL if this CPU can't
+   run it */
+static render_line_func floor1_render_impl(int impl){
+  int impls=floor1_cpu_impls();
+
+  if(impl<0 || !(impls&(1<<impl)))return NULL;
+
+  switch(impl){
+  case FLOOR1_IMPL_C:
+    return render_line;
+#ifdef FLOOR1_X86
+  case FLOOR1_IMPL_SSE2:
+    return render_line_v4;
+  case FLOOR1_IMPL_AVX2:
+    return render_line_avx2;
+#endif
+#ifdef FLOOR1_NEON
+  case FLOOR1_IMPL_NEON:
+    return render_line_v4;
+#endif
+  }
+  return NULL;
+}
+
+/* the fastest render_line this CPU runs */
+static void floor1_select(vorbis_look_floor1 *look){
+  if(!(look->render_line=floor1_render_impl(FLOOR1_IMPL_AVX2)) &&
+     !(look->render_line=floor1_render_impl(FLOOR1_IMPL_SSE2)) &&
+     !(look->render_line=floor1_render_impl(FLOOR1_IMPL_NEON)))
+    look->render_line=render_line;
+}
+
 static void render_line0(int n, int x0,int x1,int y0,int y1,int *d){
   int dy=y1-y0;
   int adx=x1-x0;
@@ -1067,7 +1357,7 @@ static int floor1_inverse2(vorbis_block *vb,vorbis_look_floor *in,void *memo,
         /* guard lookup against out-of-range values */
         hy=(hy<0?0:hy>255?255:hy);
 
-        render_line(n,lx,hx,ly,hy,out);
+        look->render_line(n,lx,hx,ly,hy,out);
 
         lx=hx;
         ly=hy;
@@ -1085,3 +1375,91 @@ const vorbis_func_floor floor1_exportbundle={
   &floor1_pack,&floor1_unpack,&floor1_look,&floor1_free_info,
   &floor1_free_look,&floor1_inverse1,&floor1_inverse2
 };
+
+#ifdef _V_SELFTEST
+
+/* Renders lines of every slope from flat to full range, from both ends
+   of the dB table, over runs shorter than a vector, across the end of
+   the line and stopping short of it, through every implementation this
+   CPU can run and compares the bits with render_line. Then times a
+   typical floor curve. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BLOCK  1024
+#define BLOCKS 100000
+
+static const char *names[]={"c","sse2","avx2","neon"};
+
+int main(){
+  static const int adxs[]={1,2,3,4,5,7,8,9,15,16,17,31,33,64,100,255,
+                           512,BLOCK-8};
+  static const int ys[]={0,1,2,60,127,128,200,253,254,255};
+  float *src=malloc(sizeof(*src)*(BLOCK+16));
+  float *ref=malloc(sizeof(*ref)*(BLOCK+16));
+  float *out=malloc(sizeof(*out)*(BLOCK+16));
+  int impl,failed=0;
+  unsigned a,i,j;
+  long k;
+
+  srand(0);
+  for(k=0;k<BLOCK+16;k++)
+    src[k]=((float)rand()/RAND_MAX-.5f)*64.f;
+
+  for(impl=0;impl<(int)(sizeof(names)/sizeof(*names));impl++){
+    render_line_func fn=floor1_render_impl(impl);
+    clock_t start;
+
+    if(!fn)continue;
+    fprintf(stderr,"Rendering with %s... ",names[impl]);
+
+    for(a=0;a<sizeof(adxs)/sizeof(*adxs) && !failed;a++)
+      for(i=0;i<sizeof(ys)/sizeof(*ys) && !failed;i++)
+        for(j=0;j<sizeof(ys)/sizeof(*ys) && !failed;j++){
+          int x0=(a*3+i)&7,x1=x0+adxs[a];
+          int n;
+
+          /* n below x0+1 leaves nothing to render; above x1 renders
+             to the end of the line */
+          for(n=x0+1;n<=x1+8 && !failed;
+              n+=(n<x0+20 || n>x1-20)?1:(x1-x0)/7+1){
+            memcpy(ref,src,sizeof(*ref)*(BLOCK+16));
+            memcpy(out,src,sizeof(*out)*(BLOCK+16));
+            render_line(n,x0,x1,ys[i],ys[j],ref);
+            fn(n,x0,x1,ys[i],ys[j],out);
+            if(memcmp(ref,out,sizeof(*out)*(BLOCK+16))){
+              fprintf(stderr,"\n  mismatch: x0 %d, x1 %d, y0 %d, y1 %d, n %d",
+                      x0,x1,ys[i],ys[j],n);
+              failed=1;
+            }
+          }
+        }
+    if(failed){
+      fprintf(stderr,"\n");
+      break;
+    }
+
+    /* a floor is mostly long shallow segments */
+    start=clock();
+    for(k=0;k<BLOCKS;k++){
+      int x,y=(int)(k%40)+150;
+      for(x=0;x<BLOCK;x+=128){
+        int ny=y+(int)((k+x)%17)-8;
+        fn(BLOCK,x,x+128,y,ny,out);
+        y=ny;
+      }
+      if((k&255)==0)memcpy(out,src,sizeof(*out)*BLOCK);
+    }
+    fprintf(stderr,"OK, %.0f ns per %d sample floor\n",
+            (double)(clock()-start)/CLOCKS_PER_SEC*1e9/BLOCKS,BLOCK);
+  }
+
+  free(src);
+  free(ref);
+  free(out);
+  return(failed);
+}
+
+#endif
@@ -28,6 +28,7 @@
 #include "registry.h"
 #include "window.h"
 #include "psy.h"
+#include "setupcache.h"
 #include "misc.h"
 #include "os.h"
 
@@ -151,7 +152,11 @@ void vorbis_info_clear(vorbis_info *vi){
   codec_setup_info     *ci=vi->codec_setup;
   int i;
 
-  if(ci){
+  if(ci && ci->setup){
+    /* the modes, maps, floors, residues and books are the cache's */
+    _vorbis_setup_release(ci->setup);
+    _ogg_free(ci);
+  }else if(ci){
 
     for(i=0;i<ci->modes;i++)
       if(ci->mode_param[i])_ogg_free(ci->mode_param[i]);
@@ -421,7 +426,17 @@ int vorbis_synthesis_headerin(vorbis_info *vi,vorbis_comment *vc,ogg_packet *op)
           return(OV_EBADHEADER);
         }
 
-        return(_vorbis_unpack_books(vi,&opb));
+        /* another stream may already have unpacked the same setup */
+        if(_vorbis_setup_find(vi,op))return(0);
+        {
+          /* the cache outlives this stream, so what it keeps can't
+             come from an allocator the stream's thread was given */
+          const ogg_allocator *prev=ogg_use_allocator(NULL);
+          int ret=_vorbis_unpack_books(vi,&opb);
+          if(!ret)_vorbis_setup_share(vi,op);
+          ogg_use_allocator(prev);
+          return(ret);
+        }
 
       default:
         /* Not a valid vorbis header type */
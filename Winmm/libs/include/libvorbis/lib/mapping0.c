@@ -27,6 +27,7 @@
 #include "registry.h"
 #include "psy.h"
 #include "misc.h"
+#include "couple.h"
 
 /* simplistic, wasteful way of doing this (unique lookup for each
    mode/submapping); there should be a central repository for
@@ -697,6 +698,42 @@ static int mapping0_forward(vorbis_block *vb){
   return(0);
 }
 
+/* the per channel tail of mapping0_inverse; channels are independent
+   once coupling is undone, so these may run on the chanpool */
+typedef struct {
+  vorbis_block         *vb;
+  vorbis_info_mapping0 *info;
+  void                **floormemo;
+} mapping0_chjob;
+
+static void mapping0_inverse_channel(void *arg,int i){
+  mapping0_chjob       *job=arg;
+  vorbis_block         *vb=job->vb;
+  codec_setup_info     *ci=vb->vd->vi->codec_setup;
+  private_state        *b=vb->vd->backend_state;
+  float                *pcm=vb->pcm[i];
+  int                   submap=job->info->chmuxlist[i];
+
+  _floor_P[ci->floor_type[job->info->floorsubmap[submap]]]->
+    inverse2(vb,b->flr[job->info->floorsubmap[submap]],
+             job->floormemo[i],pcm);
+  mdct_backward(b->transform[vb->W][0],pcm,pcm);
+}
+
+/* floor0 fills in its lookups on first use, so it stays serial */
+static int mapping0_threaded(vorbis_block *vb,vorbis_info_mapping0 *info){
+  vorbis_info          *vi=vb->vd->vi;
+  codec_setup_info     *ci=vi->codec_setup;
+  private_state        *b=vb->vd->backend_state;
+  int                   i;
+
+  if(!b->chpool || vi->channels<b->chpool_channels ||
+     vb->pcmend<b->chpool_blocksize)return 0;
+  for(i=0;i<info->submaps;i++)
+    if(ci->floor_type[info->floorsubmap[i]]==0)return 0;
+  return 1;
+}
+
 static int mapping0_inverse(vorbis_block *vb,vorbis_info_mapping *l){
   vorbis_dsp_state     *vd=vb->vd;
   vorbis_info          *vi=vd->vi;
@@ -757,27 +794,16 @@ static int mapping0_inverse(vorbis_block *vb,vorbis_info_mapping *l){
     float *pcmM=vb->pcm[info->coupling_mag[i]];
     float *pcmA=vb->pcm[info->coupling_ang[i]];
 
-    for(j=0;j<n/2;j++){
-      float mag=pcmM[j];
-      float ang=pcmA[j];
+    couple_inverse(pcmM,pcmA,n/2);
+  }
 
-      if(mag>0)
-        if(ang>0){
-          pcmM[j]=mag;
-          pcmA[j]=mag-ang;
-        }else{
-          pcmA[j]=mag;
-          pcmM[j]=mag+ang;
-        }
-      else
-        if(ang>0){
-          pcmM[j]=mag;
-          pcmA[j]=mag+ang;
-        }else{
-          pcmA[j]=mag;
-          pcmM[j]=mag-ang;
-        }
-    }
+  if(mapping0_threaded(vb,info)){
+    mapping0_chjob job;
+    job.vb=vb;
+    job.info=info;
+    job.floormemo=floormemo;
+    chanpool_run(b->chpool,mapping0_inverse_channel,&job,vi->channels);
+    return(0);
   }
 
   /* compute and apply spectral envelope */
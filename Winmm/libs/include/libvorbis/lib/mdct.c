@@ -41,11 +41,22 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <ogg/cpu.h>
 #include "vorbis/codec.h"
 #include "mdct.h"
 #include "os.h"
 #include "misc.h"
 
+#ifndef MDCT_INTEGERIZED
+#  ifdef OGG_ARCH_X86
+#    define MDCT_X86
+#    include <immintrin.h>
+#  elif defined(OGG_ARCH_ARM64)
+#    define MDCT_NEON
+#    include <arm_neon.h>
+#  endif
+#endif
+
 /* build lookups for trig functions; also pre-figure scaling and
    some window function algebra. */
 
@@ -88,6 +99,11 @@ void mdct_init(mdct_lookup *lookup,int n){
     }
   }
   lookup->scale=FLOAT_CONV(4.f/n);
+
+  if(!mdct_select(lookup,MDCT_IMPL_AVX2) &&
+     !mdct_select(lookup,MDCT_IMPL_SSE2) &&
+     !mdct_select(lookup,MDCT_IMPL_NEON))
+    mdct_select(lookup,MDCT_IMPL_C);
 }
 
 /* 8 point butterfly (in place, 4 register) */
@@ -394,7 +410,7 @@ STIN void mdct_bitreverse(mdct_lookup *init,
   }while(w0<w1);
 }
 
-void mdct_backward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
+static void mdct_backward_c(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
   int n=init->n;
   int n2=n>>1;
   int n4=n>>2;
@@ -490,6 +506,413 @@ void mdct_backward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
   }
 }
 
+/* SIMD inverse transform.
+
+   Every lane below performs exactly the IEEE single precision operations
+   of the scalar code above, in the same order, just several at a time.
+   Subtractions are either kept as subtractions or done as the addition
+   of an exactly negated product, which IEEE defines to be the same
+   operation, and nothing is fused or reassociated.  The output is
+   therefore bit-exact with mdct_backward_c whenever that is itself
+   compiled to single precision SSE (any x64 build, x86 with SSE2 math)
+   or AArch64 arithmetic.  Only x87 builds, whose scalar path carries
+   excess precision, can differ, by the last bit of a sample.
+
+   NEON is only used on AArch64; ARMv7 NEON flushes denormals and is not
+   IEEE. The 32/16/8 point leaf butterflies stay scalar in every path,
+   they are fixed register shuffles where SIMD would not pay off. */
+
+#if defined(MDCT_X86) || defined(MDCT_NEON)
+
+#ifdef MDCT_X86
+
+typedef __m128 v4;
+
+#define V4_TARGET OGG_TARGET_SSE2
+
+V4_TARGET STIN v4 v4_load(const float *p){ return _mm_loadu_ps(p); }
+V4_TARGET STIN void v4_store(float *p,v4 a){ _mm_storeu_ps(p,a); }
+V4_TARGET STIN v4 v4_set1(float f){ return _mm_set1_ps(f); }
+V4_TARGET STIN v4 v4_add(v4 a,v4 b){ return _mm_add_ps(a,b); }
+V4_TARGET STIN v4 v4_sub(v4 a,v4 b){ return _mm_sub_ps(a,b); }
+V4_TARGET STIN v4 v4_mul(v4 a,v4 b){ return _mm_mul_ps(a,b); }
+
+/* a[0] a[1] b[0] b[1] */
+V4_TARGET STIN v4 v4_load2(const float *a,const float *b){
+  return _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(),(const __m64 *)a),
+                      (const __m64 *)b);
+}
+
+/* a0 a2 b0 b2 / a1 a3 b1 b3 */
+V4_TARGET STIN v4 v4_even(v4 a,v4 b){ return _mm_shuffle_ps(a,b,_MM_SHUFFLE(2,0,2,0)); }
+V4_TARGET STIN v4 v4_odd(v4 a,v4 b){ return _mm_shuffle_ps(a,b,_MM_SHUFFLE(3,1,3,1)); }
+
+/* a0 a0 a2 a2 / a1 a1 a3 a3 */
+V4_TARGET STIN v4 v4_dupeven(v4 a){ return _mm_shuffle_ps(a,a,_MM_SHUFFLE(2,2,0,0)); }
+V4_TARGET STIN v4 v4_dupodd(v4 a){ return _mm_shuffle_ps(a,a,_MM_SHUFFLE(3,3,1,1)); }
+
+/* a1 a0 a3 a2 / a2 a3 a0 a1 / a3 a2 a1 a0 */
+V4_TARGET STIN v4 v4_swappairs(v4 a){ return _mm_shuffle_ps(a,a,_MM_SHUFFLE(2,3,0,1)); }
+V4_TARGET STIN v4 v4_swaphalves(v4 a){ return _mm_shuffle_ps(a,a,_MM_SHUFFLE(1,0,3,2)); }
+V4_TARGET STIN v4 v4_reverse(v4 a){ return _mm_shuffle_ps(a,a,_MM_SHUFFLE(0,1,2,3)); }
+
+/* a0 b1 a2 b3 */
+V4_TARGET STIN v4 v4_blend(v4 a,v4 b){
+  v4 t=_mm_shuffle_ps(a,b,_MM_SHUFFLE(3,1,2,0));
+  return _mm_shuffle_ps(t,t,_MM_SHUFFLE(3,1,2,0));
+}
+
+/* sign flips, exact */
+V4_TARGET STIN v4 v4_neg(v4 a){
+  return _mm_xor_ps(a,_mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+}
+V4_TARGET STIN v4 v4_negeven(v4 a){
+  return _mm_xor_ps(a,_mm_castsi128_ps(_mm_set_epi32(0,0x80000000,0,0x80000000)));
+}
+V4_TARGET STIN v4 v4_negodd(v4 a){
+  return _mm_xor_ps(a,_mm_castsi128_ps(_mm_set_epi32(0x80000000,0,0x80000000,0)));
+}
+
+#else /* MDCT_NEON */
+
+typedef float32x4_t v4;
+
+#define V4_TARGET
+
+STIN v4 v4_load(const float *p){ return vld1q_f32(p); }
+STIN void v4_store(float *p,v4 a){ vst1q_f32(p,a); }
+STIN v4 v4_set1(float f){ return vdupq_n_f32(f); }
+STIN v4 v4_add(v4 a,v4 b){ return vaddq_f32(a,b); }
+STIN v4 v4_sub(v4 a,v4 b){ return vsubq_f32(a,b); }
+STIN v4 v4_mul(v4 a,v4 b){ return vmulq_f32(a,b); }
+STIN v4 v4_load2(const float *a,const float *b){
+  return vcombine_f32(vld1_f32(a),vld1_f32(b));
+}
+STIN v4 v4_even(v4 a,v4 b){ return vuzp1q_f32(a,b); }
+STIN v4 v4_odd(v4 a,v4 b){ return vuzp2q_f32(a,b); }
+STIN v4 v4_dupeven(v4 a){ return vtrn1q_f32(a,a); }
+STIN v4 v4_dupodd(v4 a){ return vtrn2q_f32(a,a); }
+STIN v4 v4_swappairs(v4 a){ return vrev64q_f32(a); }
+STIN v4 v4_swaphalves(v4 a){ return vextq_f32(a,a,2); }
+STIN v4 v4_reverse(v4 a){ return vextq_f32(vrev64q_f32(a),vrev64q_f32(a),2); }
+STIN v4 v4_blend(v4 a,v4 b){
+  static const uint32_t odd[4]={0,0xffffffffU,0,0xffffffffU};
+  return vbslq_f32(vld1q_u32(odd),b,a);
+}
+STIN v4 v4_neg(v4 a){ return vnegq_f32(a); }
+STIN v4 v4_negeven(v4 a){
+  static const uint32_t sign[4]={0x80000000U,0,0x80000000U,0};
+  return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a),vld1q_u32(sign)));
+}
+STIN v4 v4_negodd(v4 a){
+  static const uint32_t sign[4]={0,0x80000000U,0,0x80000000U};
+  return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a),vld1q_u32(sign)));
+}
+
+#endif
+
+/* both pre-rotation loops of mdct_backward_c */
+V4_TARGET STIN void mdct_rotate_in_v4(mdct_lookup *init,
+                                      DATA_TYPE *in, DATA_TYPE *out){
+  int n=init->n;
+  int n2=n>>1;
+  int n4=n>>2;
+
+  DATA_TYPE *iX = in+n2-7;
+  DATA_TYPE *oX = out+n2+n4;
+  DATA_TYPE *T  = init->trig+n4;
+
+  do{
+    v4 e = v4_even(v4_load(iX),v4_load(iX+4));   /* iX 0 2 4 6 */
+    v4 t = v4_load(T);
+    oX  -= 4;
+    v4_store(oX,v4_sub(v4_mul(v4_negeven(v4_swappairs(e)),
+                              v4_swaphalves(v4_dupodd(t))),
+                       v4_mul(e,v4_swaphalves(v4_dupeven(t)))));
+    iX  -= 8;
+    T   += 4;
+  }while(iX>=in);
+
+  iX = in+n2-8;
+  oX = out+n2+n4;
+  T  = init->trig+n4;
+
+  do{
+    v4 e = v4_even(v4_load(iX),v4_load(iX+4));
+    v4 p = v4_swaphalves(v4_dupeven(e));         /* iX 4 4 0 0 */
+    v4 q = v4_swaphalves(v4_dupodd(e));          /* iX 6 6 2 2 */
+    v4 t;
+    T   -= 4;
+    t    = v4_load(T);
+    v4_store(oX,v4_add(v4_mul(p,v4_reverse(t)),
+                       v4_negodd(v4_mul(q,v4_swaphalves(t)))));
+    iX  -= 8;
+    oX  += 4;
+  }while(iX>=in);
+}
+
+/* one stage of mdct_butterfly_first/generic (first is trigint 4) */
+V4_TARGET STIN void mdct_butterfly_v4(DATA_TYPE *T,
+                                      DATA_TYPE *x,
+                                      int points,
+                                      int trigint){
+  DATA_TYPE *x1 = x + points      - 8;
+  DATA_TYPE *x2 = x + (points>>1) - 8;
+
+  do{
+    v4 a1 = v4_load(x1);
+    v4 b1 = v4_load(x1+4);
+    v4 a2 = v4_load(x2);
+    v4 b2 = v4_load(x2+4);
+    v4 ta = v4_load2(T+trigint*3,T+trigint*2);   /* x2 0-1, 2-3 */
+    v4 tb = v4_load2(T+trigint,T);               /* x2 4-5, 6-7 */
+    v4 da = v4_sub(a1,a2);                       /* r0 r1 r0 r1 */
+    v4 db = v4_sub(b1,b2);
+
+    v4_store(x1,  v4_add(a1,a2));
+    v4_store(x1+4,v4_add(b1,b2));
+    v4_store(x2,  v4_add(v4_mul(v4_dupodd(da),v4_swappairs(ta)),
+                         v4_negodd(v4_mul(v4_dupeven(da),ta))));
+    v4_store(x2+4,v4_add(v4_mul(v4_dupodd(db),v4_swappairs(tb)),
+                         v4_negodd(v4_mul(v4_dupeven(db),tb))));
+
+    x1 -= 8;
+    x2 -= 8;
+    T  += trigint*4;
+  }while(x2>=x);
+}
+
+V4_TARGET STIN void mdct_butterflies_v4(mdct_lookup *init,
+                                        DATA_TYPE *x,
+                                        int points){
+
+  DATA_TYPE *T=init->trig;
+  int stages=init->log2n-5;
+  int i,j;
+
+  if(--stages>0){
+    mdct_butterfly_v4(T,x,points,4);
+  }
+
+  for(i=1;--stages>0;i++){
+    for(j=0;j<(1<<i);j++)
+      mdct_butterfly_v4(T,x+(points>>i)*j,points>>i,4<<i);
+  }
+
+  for(j=0;j<points;j+=32)
+    mdct_butterfly_32(x+j);
+}
+
+/* two iterations of the scalar loop per pass */
+V4_TARGET STIN void mdct_bitreverse_v4(mdct_lookup *init,
+                                       DATA_TYPE *x){
+  int        n       = init->n;
+  int       *bit     = init->bitrev;
+  DATA_TYPE *w0      = x;
+  DATA_TYPE *w1      = x = w0+(n>>1);
+  DATA_TYPE *T       = init->trig+n;
+  v4         half    = v4_set1(.5f);
+
+  do{
+    v4 a = v4_load2(x+bit[0],x+bit[2]);          /* x0 */
+    v4 b = v4_load2(x+bit[1],x+bit[3]);          /* x1 */
+    v4 t = v4_load(T);
+    v4 s = v4_add(a,b);                          /* r1 . */
+    v4 d = v4_sub(a,b);                          /* .  r0 */
+
+    /* r2 r3 */
+    v4 r = v4_add(v4_mul(v4_dupeven(s),t),
+                  v4_negodd(v4_mul(v4_dupodd(d),v4_swappairs(t))));
+    /* halved r0 r1 */
+    v4 h = v4_mul(v4_blend(v4_swappairs(s),v4_swappairs(d)),half);
+
+    w1 -= 4;
+
+    v4_store(w0,v4_add(h,r));
+    v4_store(w1,v4_swaphalves(v4_sub(v4_blend(h,r),v4_blend(r,h))));
+
+    T   += 4;
+    bit += 4;
+    w0  += 4;
+  }while(w0<w1);
+}
+
+/* the rotate + window tail of mdct_backward_c */
+V4_TARGET STIN void mdct_rotate_out_v4(mdct_lookup *init,
+                                       DATA_TYPE *out){
+  int n=init->n;
+  int n2=n>>1;
+  int n4=n>>2;
+
+  DATA_TYPE *oX1=out+n2+n4;
+  DATA_TYPE *oX2=out+n2+n4;
+  DATA_TYPE *iX =out;
+  DATA_TYPE *T  =init->trig+n2;
+
+  do{
+    v4 i0 = v4_load(iX);
+    v4 i1 = v4_load(iX+4);
+    v4 t0 = v4_load(T);
+    v4 t1 = v4_load(T+4);
+    v4 ie = v4_even(i0,i1);
+    v4 io = v4_odd(i0,i1);
+    v4 te = v4_even(t0,t1);
+    v4 to = v4_odd(t0,t1);
+
+    oX1-=4;
+
+    v4_store(oX1,v4_reverse(v4_sub(v4_mul(ie,to),v4_mul(io,te))));
+    v4_store(oX2,v4_neg(v4_add(v4_mul(ie,te),v4_mul(io,to))));
+
+    oX2+=4;
+    iX +=8;
+    T  +=8;
+  }while(iX<oX1);
+
+  iX=out+n2+n4;
+  oX1=out+n4;
+  oX2=oX1;
+
+  do{
+    v4 v;
+    oX1-=4;
+    iX-=4;
+
+    v=v4_load(iX);
+    v4_store(oX1,v);
+    v4_store(oX2,v4_neg(v4_reverse(v)));
+
+    oX2+=4;
+  }while(oX2<iX);
+
+  iX=out+n2+n4;
+  oX1=out+n2+n4;
+  oX2=out+n2;
+  do{
+    oX1-=4;
+    v4_store(oX1,v4_reverse(v4_load(iX)));
+    iX+=4;
+  }while(oX1>oX2);
+}
+
+V4_TARGET static void mdct_backward_v4(mdct_lookup *init,
+                                       DATA_TYPE *in, DATA_TYPE *out){
+  int n2=init->n>>1;
+
+  mdct_rotate_in_v4(init,in,out);
+  mdct_butterflies_v4(init,out+n2,n2);
+  mdct_bitreverse_v4(init,out);
+  mdct_rotate_out_v4(init,out);
+}
+
+#endif
+
+#ifdef MDCT_X86
+
+/* AVX2: the butterfly stages, which carry most of the work, a whole
+   scalar iteration per 256 bit register; the rest is the SSE2 code */
+OGG_TARGET_AVX2 static void mdct_butterfly_avx2(DATA_TYPE *T,
+                                                DATA_TYPE *x,
+                                                int points,
+                                                int trigint){
+  DATA_TYPE *x1 = x + points      - 8;
+  DATA_TYPE *x2 = x + (points>>1) - 8;
+  __m256 negodd = _mm256_castsi256_ps(_mm256_set_epi32(0x80000000,0,0x80000000,0,
+                                                       0x80000000,0,0x80000000,0));
+
+  do{
+    __m256 a1 = _mm256_loadu_ps(x1);
+    __m256 a2 = _mm256_loadu_ps(x2);
+    __m256 t  = _mm256_insertf128_ps(
+      _mm256_castps128_ps256(v4_load2(T+trigint*3,T+trigint*2)),
+      v4_load2(T+trigint,T),1);
+    __m256 d  = _mm256_sub_ps(a1,a2);
+
+    _mm256_storeu_ps(x1,_mm256_add_ps(a1,a2));
+    _mm256_storeu_ps(x2,_mm256_add_ps(
+      _mm256_mul_ps(_mm256_movehdup_ps(d),_mm256_permute_ps(t,_MM_SHUFFLE(2,3,0,1))),
+      _mm256_xor_ps(_mm256_mul_ps(_mm256_moveldup_ps(d),t),negodd)));
+
+    x1 -= 8;
+    x2 -= 8;
+    T  += trigint*4;
+  }while(x2>=x);
+}
+
+OGG_TARGET_AVX2 static void mdct_backward_avx2(mdct_lookup *init,
+                                               DATA_TYPE *in, DATA_TYPE *out){
+  int n2=init->n>>1;
+  DATA_TYPE *x=out+n2;
+  DATA_TYPE *T=init->trig;
+  int stages=init->log2n-5;
+  int i,j;
+
+  mdct_rotate_in_v4(init,in,out);
+
+  if(--stages>0){
+    mdct_butterfly_avx2(T,x,n2,4);
+  }
+
+  for(i=1;--stages>0;i++){
+    for(j=0;j<(1<<i);j++)
+      mdct_butterfly_avx2(T,x+(n2>>i)*j,n2>>i,4<<i);
+  }
+
+  _mm256_zeroupper();
+
+  for(j=0;j<n2;j+=32)
+    mdct_butterfly_32(x+j);
+
+  mdct_bitreverse_v4(init,out);
+  mdct_rotate_out_v4(init,out);
+}
+
+#endif
+
+/* bit 1<<MDCT_IMPL_x for every implementation this CPU can run */
+static int mdct_cpu_impls(void){
+  int cpu=ogg_cpu_features(),impls=1<<MDCT_IMPL_C;
+#ifdef MDCT_X86
+  if(cpu&OGG_CPU_SSE2)impls|=1<<MDCT_IMPL_SSE2;
+  if(cpu&OGG_CPU_AVX2)impls|=1<<MDCT_IMPL_AVX2;
+#endif
+#ifdef MDCT_NEON
+  if(cpu&OGG_CPU_NEON)impls|=1<<MDCT_IMPL_NEON;
+#endif
+  return impls;
+}
+
+/* returns 0 when impl isn't built in or the CPU can't run it */
+int mdct_select(mdct_lookup *l,int impl){
+  int impls=mdct_cpu_impls();
+
+  if(impl<0 || !(impls&(1<<impl)))return 0;
+
+  switch(impl){
+#ifdef MDCT_X86
+  case MDCT_IMPL_SSE2:
+    l->backward=mdct_backward_v4;
+    break;
+  case MDCT_IMPL_AVX2:
+    l->backward=mdct_backward_avx2;
+    break;
+#endif
+#ifdef MDCT_NEON
+  case MDCT_IMPL_NEON:
+    l->backward=mdct_backward_v4;
+    break;
+#endif
+  default:
+    l->backward=mdct_backward_c;
+    break;
+  }
+  return 1;
+}
+
+void mdct_backward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
+  init->backward(init,in,out);
+}
+
 void mdct_forward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
   int n=init->n;
   int n2=n>>1;
@@ -53,7 +53,7 @@
 #endif
 
 
-typedef struct {
+typedef struct mdct_lookup {
   int n;
   int log2n;
 
@@ -61,10 +61,20 @@ typedef struct {
   int       *bitrev;
 
   DATA_TYPE scale;
+
+  /* inverse transform picked for this CPU by mdct_init */
+  void (*backward)(struct mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out);
 } mdct_lookup;
 
+/* inverse transform implementations, see mdct_select */
+#define MDCT_IMPL_C     0
+#define MDCT_IMPL_SSE2  1
+#define MDCT_IMPL_AVX2  2
+#define MDCT_IMPL_NEON  3
+
 extern void mdct_init(mdct_lookup *lookup,int n);
 extern void mdct_clear(mdct_lookup *l);
+extern int  mdct_select(mdct_lookup *l,int impl);
 extern void mdct_forward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out);
 extern void mdct_backward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out);
 
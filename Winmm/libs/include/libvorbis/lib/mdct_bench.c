@@ -0,0 +1,91 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: inverse MDCT kernel benchmark; times every implementation
+           this CPU can run at block sizes 256 to 8192 and checks each
+           against the scalar path bit for bit
+
+ ********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "vorbis/codec.h"
+#include "mdct.h"
+
+static const char *names[]={"c","sse2","avx2","neon"};
+
+int main(int argc,char **argv){
+  int impls=sizeof(names)/sizeof(*names);
+  int n,i,j,failed=0;
+  long budget=argc>1?atol(argv[1]):1<<24; /* samples transformed per test */
+
+  printf("%6s","n");
+  for(i=0;i<impls;i++)printf(" %12s",names[i]);
+  printf("   (ns per transform)\n");
+
+  for(n=256;n<=8192;n<<=1){
+    mdct_lookup m;
+    float *src=malloc(sizeof(*src)*n);
+    float *ref=malloc(sizeof(*ref)*n);
+    float *buf=malloc(sizeof(*buf)*n);
+    long iters=budget/n;
+
+    mdct_init(&m,n);
+
+    /* something spectrum shaped, with a few exact zeros thrown in */
+    srand(n);
+    for(j=0;j<n/2;j++)
+      src[j]=(rand()%7==0)?0.f:((float)rand()/RAND_MAX-.5f)*(4096.f/(j+1));
+
+    mdct_select(&m,MDCT_IMPL_C);
+    memcpy(ref,src,sizeof(*ref)*n);
+    mdct_backward(&m,ref,ref);
+
+    printf("%6d",n);
+    for(i=0;i<impls;i++){
+      clock_t start;
+      double ns;
+      long k;
+
+      if(!mdct_select(&m,i)){
+        printf(" %12s","-");
+        continue;
+      }
+
+      memcpy(buf,src,sizeof(*buf)*n);
+      mdct_backward(&m,buf,buf);
+      if(memcmp(buf,ref,sizeof(*buf)*n)){
+        printf(" %12s","MISMATCH");
+        failed=1;
+        continue;
+      }
+
+      start=clock();
+      for(k=0;k<iters;k++){
+        memcpy(buf,src,sizeof(*buf)*n/2);
+        mdct_backward(&m,buf,buf);
+      }
+      ns=(double)(clock()-start)/CLOCKS_PER_SEC*1e9/iters;
+      printf(" %12.0f",ns);
+    }
+    printf("\n");
+
+    mdct_clear(&m);
+    free(src);
+    free(ref);
+    free(buf);
+  }
+
+  return failed;
+}
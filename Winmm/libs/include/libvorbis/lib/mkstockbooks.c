@@ -0,0 +1,265 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: writes stockbooks.h; runs the stock encoder setups for
+           the given channel counts at every rate, quality and
+           managed bitrate step, collects the distinct codebooks
+           their setup headers carry and prints each one's decode
+           tables as vorbis_book_build_decode makes them
+
+ ********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ogg/ogg.h>
+#include "vorbis/codec.h"
+#include "vorbis/vorbisenc.h"
+#include "codebook.h"
+
+static const long rates[]={8000,11025,16000,22050,32000,44100,48000};
+
+static static_codebook **books;
+static int               bookcount;
+static long              encodes;
+
+static long quantvals(const static_codebook *s){
+  switch(s->maptype){
+  case 1:
+    return _book_maptype1_quantvals(s);
+  case 2:
+    return s->entries*s->dim;
+  }
+  return 0;
+}
+
+static int same(const static_codebook *a,const static_codebook *b){
+  long i;
+  if(a->dim!=b->dim || a->entries!=b->entries || a->maptype!=b->maptype)
+    return 0;
+  if(memcmp(a->lengthlist,b->lengthlist,a->entries))return 0;
+  if(a->maptype){
+    if(a->q_min!=b->q_min || a->q_delta!=b->q_delta ||
+       a->q_quant!=b->q_quant || a->q_sequencep!=b->q_sequencep)return 0;
+    for(i=0;i<quantvals(a);i++)
+      if(a->quantlist[i]!=b->quantlist[i])return 0;
+  }
+  return 1;
+}
+
+/* the books of a setup header, skipping the packet type and 'vorbis' */
+static void collect(ogg_packet *op){
+  oggpack_buffer opb;
+  int i,j,n;
+
+  oggpack_readinit(&opb,op->packet,op->bytes);
+  oggpack_adv(&opb,56);
+  n=oggpack_read(&opb,8)+1;
+  for(i=0;i<n;i++){
+    static_codebook *s=vorbis_staticbook_unpack(&opb);
+    if(!s){
+      fprintf(stderr,"mkstockbooks: bad book in a stock setup\n");
+      exit(1);
+    }
+    for(j=0;j<bookcount;j++)
+      if(same(books[j],s))break;
+    if(j<bookcount){
+      vorbis_staticbook_destroy(s);
+      continue;
+    }
+    books=realloc(books,sizeof(*books)*(bookcount+1));
+    books[bookcount++]=s;
+  }
+}
+
+/* vi is set up but not yet initialized; encoder modes that don't
+   exist for the rate and channels are skipped */
+static void run(vorbis_info *vi){
+  vorbis_comment vc;
+  vorbis_dsp_state vd;
+  ogg_packet id,comment,setup;
+
+  if(!vorbis_encode_setup_init(vi)){
+    vorbis_comment_init(&vc);
+    vorbis_analysis_init(&vd,vi);
+    vorbis_analysis_headerout(&vd,&vc,&id,&comment,&setup);
+    collect(&setup);
+    vorbis_dsp_clear(&vd);
+    vorbis_comment_clear(&vc);
+    encodes++;
+  }
+  vorbis_info_clear(vi);
+}
+
+static void print_array(const char *type,const char *name,int book,
+                        const void *data,long n,int kind){
+  long i;
+  printf("static const %s _stock_%s_%d[%ld]={",type,name,book,n);
+  for(i=0;i<n;i++){
+    if(i%8==0)printf("\n ");
+    switch(kind){
+    case 0:
+      printf(" %d,",((const char *)data)[i]);
+      break;
+    case 1:
+      printf(" %d,",((const int *)data)[i]);
+      break;
+    case 2:
+      printf(" 0x%08lxUL,",(unsigned long)((const ogg_uint32_t *)data)[i]);
+      break;
+    case 3:
+      printf(" %ld,",((const long *)data)[i]);
+      break;
+    case 4:
+      {
+        /* nine digits bring a float back exactly */
+        char buf[32];
+        sprintf(buf,"%.9g",((const float *)data)[i]);
+        printf(" %s%sf,",buf,strpbrk(buf,".e")?"":".");
+      }
+      break;
+    case 5:
+      /* leaves are small; subtable slots have the top bit set */
+      if(((const ogg_uint32_t *)data)[i]&DEC_SUBTABLE)
+        printf(" 0x%08lxUL,",(unsigned long)((const ogg_uint32_t *)data)[i]);
+      else
+        printf(" %lu,",(unsigned long)((const ogg_uint32_t *)data)[i]);
+      break;
+    }
+  }
+  printf("\n};\n\n");
+}
+
+static int byhash(const void *a,const void *b){
+  ogg_uint32_t x=_vorbis_book_hash(*(static_codebook *const *)a);
+  ogg_uint32_t y=_vorbis_book_hash(*(static_codebook *const *)b);
+  return (x>y)-(x<y);
+}
+
+int main(int argc,char **argv){
+  int i,k,r,printed=0;
+  long bytes=0;
+
+  if(argc<2){
+    fprintf(stderr,"usage: mkstockbooks channels... > stockbooks.h\n");
+    return 1;
+  }
+
+  for(i=1;i<argc;i++){
+    int ch=atoi(argv[i]);
+    for(r=0;r<(int)(sizeof(rates)/sizeof(*rates));r++){
+      vorbis_info vi;
+
+      /* quality mode walks setup points a tenth apart */
+      for(k=-2;k<=20;k++){
+        vorbis_info_init(&vi);
+        if(vorbis_encode_setup_vbr(&vi,ch,rates[r],k*.05f)){
+          vorbis_info_clear(&vi);
+          continue;
+        }
+        run(&vi);
+      }
+
+      /* managed bitrates pick from their own books */
+      for(k=8;k<=512;k+=8){
+        vorbis_info_init(&vi);
+        if(vorbis_encode_setup_managed(&vi,ch,rates[r],-1,k*1000*ch/2,-1)){
+          vorbis_info_clear(&vi);
+          continue;
+        }
+        run(&vi);
+      }
+    }
+  }
+
+  qsort(books,bookcount,sizeof(*books),byhash);
+
+  printf("/********************************************************************\n"
+         " *                                                                  *\n"
+         " * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *\n"
+         " * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *\n"
+         " * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *\n"
+         " * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *\n"
+         " *                                                                  *\n"
+         " * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *\n"
+         " * by the Xiph.Org Foundation http://www.xiph.org/                  *\n"
+         " *                                                                  *\n"
+         " ********************************************************************\n"
+         "\n"
+         " function: decode tables of the codebooks stock encoder setups\n"
+         "           write; generated by mkstockbooks");
+  for(i=1;i<argc;i++)printf(" %s",argv[i]);
+  printf(", edit there\n\n"
+         " ********************************************************************/\n\n");
+
+  for(k=0;k<bookcount;k++){
+    static_codebook *s=books[k];
+    codebook c;
+
+    if(vorbis_book_build_decode(&c,s)){
+      fprintf(stderr,"mkstockbooks: stock book %d won't build\n",k);
+      return 1;
+    }
+    if(c.used_entries){
+      long n=c.used_entries,t=_vorbis_book_table_size(&c);
+      if(s->maptype)
+        print_array("long","quantlist",k,s->quantlist,quantvals(s),3);
+      print_array("ogg_uint32_t","codelist",k,c.codelist,n,2);
+      if(c.valuelist)
+        print_array("float","valuelist",k,c.valuelist,n*c.dim,4);
+      print_array("int","index",k,c.dec_index,n,1);
+      print_array("char","lengths",k,c.dec_codelengths,n,0);
+      print_array("ogg_uint32_t","firsttable",k,c.dec_firsttable,t,5);
+      bytes+=n*(sizeof(*c.codelist)+sizeof(*c.dec_index)+1)+
+        t*sizeof(*c.dec_firsttable)+(c.valuelist?n*c.dim*sizeof(float):0);
+    }
+    vorbis_book_clear(&c);
+  }
+
+  printf("static const stock_book stock_books[]={\n");
+  for(k=0;k<bookcount;k++){
+    static_codebook *s=books[k];
+    codebook c;
+
+    vorbis_book_build_decode(&c,s);
+    if(c.used_entries){
+      /* the packed floats as the 32 bits they were read from, since
+         long may be wider */
+      printf("  {0x%08lxUL,%ld,%ld,%d,0x%08lxUL,0x%08lxUL,%d,%d,",
+             (unsigned long)_vorbis_book_hash(s),s->dim,s->entries,
+             s->maptype,(unsigned long)s->q_min&0xffffffffUL,
+             (unsigned long)s->q_delta&0xffffffffUL,s->q_quant,
+             s->q_sequencep);
+      if(s->maptype)
+        printf("%ld,_stock_quantlist_%d,\n",quantvals(s),k);
+      else
+        printf("0,NULL,\n");
+      printf("   %ld,_stock_codelist_%d,",c.used_entries,k);
+      if(c.valuelist)
+        printf("_stock_valuelist_%d,",k);
+      else
+        printf("NULL,");
+      printf("_stock_index_%d,_stock_lengths_%d,\n",k,k);
+      printf("   _stock_firsttable_%d,%d,%d},\n",k,c.dec_firsttablen,
+             c.dec_maxlength);
+      printed++;
+    }
+    vorbis_book_clear(&c);
+  }
+  printf("};\n\n#define STOCK_BOOKS %d\n",printed);
+
+  fprintf(stderr,"mkstockbooks: %ld setups, %d books, %ld bytes of tables\n",
+          encodes,printed,bytes);
+  for(k=0;k<bookcount;k++)vorbis_staticbook_destroy(books[k]);
+  free(books);
+  return 0;
+}
@@ -0,0 +1,595 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: float to interleaved integer PCM packing for ov_read
+
+ ********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ogg/cpu.h>
+#include "vorbis/codec.h"
+#include "os.h"
+#include "pcmpack.h"
+
+#ifdef OGG_ARCH_X86
+#  define PCM_X86
+#  include <immintrin.h>
+#elif defined(OGG_ARCH_ARM64)
+#  define PCM_NEON
+#  include <arm_neon.h>
+#endif
+
+static int host_is_big_endian() {
+  ogg_int32_t pattern = 0xfeedface; /* deadbeef */
+  unsigned char *bytewise = (unsigned char *)&pattern;
+  if (bytewise[0] == 0xfe) return 1;
+  return 0;
+}
+
+/* the original ov_read packing loops; the scalar fallback, and the
+   reference every other path has to match bit for bit */
+static void pcm_pack_c(char *buffer,float **pcm,int channels,long samples,
+                       int bigendianp,int word,int sgned){
+  int i,j;
+  int host_endian = host_is_big_endian();
+  vorbis_fpu_control fpu;
+  int val;
+
+  if(word==1){
+    int off=(sgned?0:128);
+    vorbis_fpu_setround(&fpu);
+    for(j=0;j<samples;j++)
+      for(i=0;i<channels;i++){
+        val=vorbis_ftoi(pcm[i][j]*128.f);
+        if(val>127)val=127;
+        else if(val<-128)val=-128;
+        *buffer++=val+off;
+      }
+    vorbis_fpu_restore(fpu);
+  }else{
+    int off=(sgned?0:32768);
+
+    if(host_endian==bigendianp){
+      if(sgned){
+
+        vorbis_fpu_setround(&fpu);
+        for(i=0;i<channels;i++) { /* It's faster in this order */
+          float *src=pcm[i];
+          short *dest=((short *)buffer)+i;
+          for(j=0;j<samples;j++) {
+            val=vorbis_ftoi(src[j]*32768.f);
+            if(val>32767)val=32767;
+            else if(val<-32768)val=-32768;
+            *dest=val;
+            dest+=channels;
+          }
+        }
+        vorbis_fpu_restore(fpu);
+
+      }else{
+
+        vorbis_fpu_setround(&fpu);
+        for(i=0;i<channels;i++) {
+          float *src=pcm[i];
+          short *dest=((short *)buffer)+i;
+          for(j=0;j<samples;j++) {
+            val=vorbis_ftoi(src[j]*32768.f);
+            if(val>32767)val=32767;
+            else if(val<-32768)val=-32768;
+            *dest=val+off;
+            dest+=channels;
+          }
+        }
+        vorbis_fpu_restore(fpu);
+
+      }
+    }else if(bigendianp){
+
+      vorbis_fpu_setround(&fpu);
+      for(j=0;j<samples;j++)
+        for(i=0;i<channels;i++){
+          val=vorbis_ftoi(pcm[i][j]*32768.f);
+          if(val>32767)val=32767;
+          else if(val<-32768)val=-32768;
+          val+=off;
+          *buffer++=(val>>8);
+          *buffer++=(val&0xff);
+        }
+      vorbis_fpu_restore(fpu);
+
+    }else{
+
+      vorbis_fpu_setround(&fpu);
+      for(j=0;j<samples;j++)
+        for(i=0;i<channels;i++){
+          val=vorbis_ftoi(pcm[i][j]*32768.f);
+          if(val>32767)val=32767;
+          else if(val<-32768)val=-32768;
+          val+=off;
+          *buffer++=(val&0xff);
+          *buffer++=(val>>8);
+        }
+      vorbis_fpu_restore(fpu);
+
+    }
+  }
+}
+
+#if defined(PCM_X86) || defined(PCM_NEON)
+
+/* Frames from j on, after a vector kernel has done the ones before.
+   Byte order is written out explicitly, so this is the reference loop
+   whatever the host is. */
+static void pcm_pack_tail(char *buffer,float **pcm,int channels,long j,
+                          long samples,int bigendianp,int word,int sgned){
+  vorbis_fpu_control fpu;
+  int i,val;
+
+  buffer+=j*channels*word;
+  vorbis_fpu_setround(&fpu);
+  for(;j<samples;j++)
+    for(i=0;i<channels;i++){
+      if(word==1){
+        val=vorbis_ftoi(pcm[i][j]*128.f);
+        if(val>127)val=127;
+        else if(val<-128)val=-128;
+        *buffer++=val+(sgned?0:128);
+      }else{
+        val=vorbis_ftoi(pcm[i][j]*32768.f);
+        if(val>32767)val=32767;
+        else if(val<-32768)val=-32768;
+        val+=(sgned?0:32768);
+        if(bigendianp){
+          *buffer++=(val>>8);
+          *buffer++=(val&0xff);
+        }else{
+          *buffer++=(val&0xff);
+          *buffer++=(val>>8);
+        }
+      }
+    }
+  vorbis_fpu_restore(fpu);
+}
+
+/* The vector kernels replace convert-and-clamp with a rounding convert
+   and saturating narrows, and the offset for unsigned output with an
+   xor of the top bit, which is the same thing modulo the word size.
+
+   The conversion has to round exactly like vorbis_ftoi. On x86 that is
+   round to nearest even in every build (cvtsd2si, or fistp with the
+   rounding mode vorbis_fpu_setround sets), which cvtps2dq matches, out
+   of range and NaN giving 0x80000000 in all of them. AArch64 uses the
+   generic (int)floor(f+.5); see v4_round there. */
+
+#ifdef PCM_X86
+
+typedef __m128  v4;
+typedef __m128i v4d;  /* 4 dwords */
+typedef __m128i v4w;  /* 8 words */
+typedef __m128i v4b;  /* 16 bytes */
+
+#define V4_TARGET OGG_TARGET_SSE2
+
+V4_TARGET STIN v4 v4_load(const float *p){ return _mm_loadu_ps(p); }
+V4_TARGET STIN v4 v4_mul(v4 a,float f){ return _mm_mul_ps(a,_mm_set1_ps(f)); }
+V4_TARGET STIN v4 v4_ziplo(v4 a,v4 b){ return _mm_unpacklo_ps(a,b); }
+V4_TARGET STIN v4 v4_ziphi(v4 a,v4 b){ return _mm_unpackhi_ps(a,b); }
+V4_TARGET STIN v4d v4_round(v4 a){ return _mm_cvtps_epi32(a); }
+
+/* saturating narrows, a's lanes first */
+V4_TARGET STIN v4w v4_pack16(v4d a,v4d b){ return _mm_packs_epi32(a,b); }
+V4_TARGET STIN v4b v4_pack8(v4w a,v4w b){ return _mm_packs_epi16(a,b); }
+
+V4_TARGET STIN v4w v4_xor16(v4w a,int x){
+  return _mm_xor_si128(a,_mm_set1_epi16((short)x));
+}
+V4_TARGET STIN v4b v4_xor8(v4b a,int x){
+  return _mm_xor_si128(a,_mm_set1_epi8((char)x));
+}
+V4_TARGET STIN v4w v4_swap16(v4w a){
+  return _mm_or_si128(_mm_slli_epi16(a,8),_mm_srli_epi16(a,8));
+}
+V4_TARGET STIN void v4_store16(char *p,v4w a){ _mm_storeu_si128((__m128i *)p,a); }
+V4_TARGET STIN void v4_store8(char *p,v4b a){ _mm_storeu_si128((__m128i *)p,a); }
+
+#else /* PCM_NEON */
+
+typedef float32x4_t v4;
+typedef int32x4_t   v4d;
+typedef int16x8_t   v4w;
+typedef int8x16_t   v4b;
+
+#define V4_TARGET
+
+STIN v4 v4_load(const float *p){ return vld1q_f32(p); }
+STIN v4 v4_mul(v4 a,float f){ return vmulq_f32(a,vdupq_n_f32(f)); }
+STIN v4 v4_ziplo(v4 a,v4 b){ return vzip1q_f32(a,b); }
+STIN v4 v4_ziphi(v4 a,v4 b){ return vzip2q_f32(a,b); }
+
+/* floor(f+.5) without forming f+.5 in single precision, which can
+   round up; f-floor(f) is exact. The convert saturates and takes NaN
+   to 0 like the scalar double to int conversion does. */
+STIN v4d v4_round(v4 a){
+  v4 f=vrndmq_f32(a);
+  uint32x4_t up=vcgeq_f32(vsubq_f32(a,f),vdupq_n_f32(.5f));
+  return vsubq_s32(vcvtq_s32_f32(f),vreinterpretq_s32_u32(up));
+}
+
+STIN v4w v4_pack16(v4d a,v4d b){
+  return vcombine_s16(vqmovn_s32(a),vqmovn_s32(b));
+}
+STIN v4b v4_pack8(v4w a,v4w b){
+  return vcombine_s8(vqmovn_s16(a),vqmovn_s16(b));
+}
+STIN v4w v4_xor16(v4w a,int x){ return veorq_s16(a,vdupq_n_s16((short)x)); }
+STIN v4b v4_xor8(v4b a,int x){ return veorq_s8(a,vdupq_n_s8((signed char)x)); }
+STIN v4w v4_swap16(v4w a){
+  return vreinterpretq_s16_u8(vrev16q_u8(vreinterpretq_u8_s16(a)));
+}
+STIN void v4_store16(char *p,v4w a){
+  vst1q_u8((unsigned char *)p,vreinterpretq_u8_s16(a));
+}
+STIN void v4_store8(char *p,v4b a){
+  vst1q_u8((unsigned char *)p,vreinterpretq_u8_s8(a));
+}
+
+#endif
+
+V4_TARGET STIN v4d v4_convert(const float *p,float scale){
+  return v4_round(v4_mul(v4_load(p),scale));
+}
+
+/* 4 frames of two channels, interleaved */
+V4_TARGET STIN v4w v4_zip16(const float *a,const float *b){
+  v4 l=v4_mul(v4_load(a),32768.f);
+  v4 r=v4_mul(v4_load(b),32768.f);
+  return v4_pack16(v4_round(v4_ziplo(l,r)),v4_round(v4_ziphi(l,r)));
+}
+
+/* 8 frames of two channels, interleaved */
+V4_TARGET STIN v4b v4_zip8(const float *a,const float *b){
+  v4 l0=v4_mul(v4_load(a),128.f);
+  v4 r0=v4_mul(v4_load(b),128.f);
+  v4 l1=v4_mul(v4_load(a+4),128.f);
+  v4 r1=v4_mul(v4_load(b+4),128.f);
+  return v4_pack8(v4_pack16(v4_round(v4_ziplo(l0,r0)),v4_round(v4_ziphi(l0,r0))),
+                  v4_pack16(v4_round(v4_ziplo(l1,r1)),v4_round(v4_ziphi(l1,r1))));
+}
+
+/* Each kernel packs the first n frames (a multiple of 16) of one
+   channel, or of a pair of adjacent ones, to out, which points at the
+   channel's slot in frame 0. When that is all the channels the vector
+   is the finished output; otherwise its samples are scattered a frame
+   apart. */
+
+V4_TARGET static void pcm_single16_v4(char *out,const float *src,long n,
+                                      int channels,int x,int swap){
+  long j;
+  int k;
+  for(j=0;j<n;j+=8){
+    char t[16];
+    v4w v=v4_xor16(v4_pack16(v4_convert(src+j,32768.f),
+                             v4_convert(src+j+4,32768.f)),x);
+    if(swap)v=v4_swap16(v);
+    if(channels==1){
+      v4_store16(out+j*2,v);
+    }else{
+      v4_store16(t,v);
+      for(k=0;k<8;k++)
+        memcpy(out+(j+k)*channels*2,t+k*2,2);
+    }
+  }
+}
+
+V4_TARGET static void pcm_pair16_v4(char *out,const float *a,const float *b,
+                                    long n,int channels,int x,int swap){
+  long j;
+  int k;
+  for(j=0;j<n;j+=4){
+    char t[16];
+    v4w v=v4_xor16(v4_zip16(a+j,b+j),x);
+    if(swap)v=v4_swap16(v);
+    if(channels==2){
+      v4_store16(out+j*4,v);
+    }else{
+      v4_store16(t,v);
+      for(k=0;k<4;k++)
+        memcpy(out+(j+k)*channels*2,t+k*4,4);
+    }
+  }
+}
+
+V4_TARGET static void pcm_single8_v4(char *out,const float *src,long n,
+                                     int channels,int x){
+  long j;
+  int k;
+  for(j=0;j<n;j+=16){
+    char t[16];
+    v4b v=v4_xor8(v4_pack8(v4_pack16(v4_convert(src+j,128.f),
+                                     v4_convert(src+j+4,128.f)),
+                           v4_pack16(v4_convert(src+j+8,128.f),
+                                     v4_convert(src+j+12,128.f))),x);
+    if(channels==1){
+      v4_store8(out+j,v);
+    }else{
+      v4_store8(t,v);
+      for(k=0;k<16;k++)
+        out[(j+k)*channels]=t[k];
+    }
+  }
+}
+
+V4_TARGET static void pcm_pair8_v4(char *out,const float *a,const float *b,
+                                   long n,int channels,int x){
+  long j;
+  int k;
+  for(j=0;j<n;j+=8){
+    char t[16];
+    v4b v=v4_xor8(v4_zip8(a+j,b+j),x);
+    if(channels==2){
+      v4_store8(out+j*2,v);
+    }else{
+      v4_store8(t,v);
+      for(k=0;k<8;k++)
+        memcpy(out+(j+k)*channels,t+k*2,2);
+    }
+  }
+}
+
+/* returns the number of frames packed; the caller does the rest */
+static long pcm_pack_v4(char *buffer,float **pcm,int channels,long samples,
+                        int bigendianp,int word,int sgned){
+  long n=samples&~15L;
+  int i=0;
+
+  if(word==1){
+    int x=(sgned?0:0x80);
+    for(;i+1<channels;i+=2)
+      pcm_pair8_v4(buffer+i,pcm[i],pcm[i+1],n,channels,x);
+    if(i<channels)
+      pcm_single8_v4(buffer+i,pcm[i],n,channels,x);
+  }else{
+    int x=(sgned?0:0x8000);
+    int swap=(bigendianp!=0);
+    for(;i+1<channels;i+=2)
+      pcm_pair16_v4(buffer+i*2,pcm[i],pcm[i+1],n,channels,x,swap);
+    if(i<channels)
+      pcm_single16_v4(buffer+i*2,pcm[i],n,channels,x,swap);
+  }
+  return n;
+}
+
+#endif
+
+#ifdef PCM_X86
+
+/* AVX2: mono and stereo, where the output is contiguous and a whole
+   256 bit store can go out at once; more channels use the SSE2 code.
+   The 256 bit narrows work within 128 bit halves, the permutes put
+   the results back in frame order. */
+
+OGG_TARGET_AVX2 STIN __m256i avx2_convert(const float *p,float scale){
+  return _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(p),
+                                          _mm256_set1_ps(scale)));
+}
+
+/* 8 frames of two channels, interleaved; the unpacks and the narrow
+   all stay within a half, so this one needs no permute */
+OGG_TARGET_AVX2 STIN __m256i avx2_zip16(const float *a,const float *b,
+                                        float scale){
+  __m256 s=_mm256_set1_ps(scale);
+  __m256 l=_mm256_mul_ps(_mm256_loadu_ps(a),s);
+  __m256 r=_mm256_mul_ps(_mm256_loadu_ps(b),s);
+  return _mm256_packs_epi32(_mm256_cvtps_epi32(_mm256_unpacklo_ps(l,r)),
+                            _mm256_cvtps_epi32(_mm256_unpackhi_ps(l,r)));
+}
+
+OGG_TARGET_AVX2 STIN __m256i avx2_post16(__m256i v,int x,int swap){
+  v=_mm256_xor_si256(v,_mm256_set1_epi16((short)x));
+  if(swap)v=_mm256_or_si256(_mm256_slli_epi16(v,8),_mm256_srli_epi16(v,8));
+  return v;
+}
+
+OGG_TARGET_AVX2 static long pcm_pack_avx2(char *buffer,float **pcm,
+                                          int channels,long samples,
+                                          int bigendianp,int word,int sgned){
+  long n=samples&~31L;
+  long j;
+
+  if(channels>2)
+    return pcm_pack_v4(buffer,pcm,channels,samples,bigendianp,word,sgned);
+
+  if(word==1){
+    __m256i x=_mm256_set1_epi8((char)(sgned?0:0x80));
+    if(channels==1){
+      const float *src=pcm[0];
+      __m256i order=_mm256_setr_epi32(0,4,1,5,2,6,3,7);
+      for(j=0;j<n;j+=32){
+        __m256i v=_mm256_packs_epi16(
+          _mm256_packs_epi32(avx2_convert(src+j,128.f),
+                             avx2_convert(src+j+8,128.f)),
+          _mm256_packs_epi32(avx2_convert(src+j+16,128.f),
+                             avx2_convert(src+j+24,128.f)));
+        v=_mm256_permutevar8x32_epi32(v,order);
+        _mm256_storeu_si256((__m256i *)(buffer+j),_mm256_xor_si256(v,x));
+      }
+    }else{
+      for(j=0;j<n;j+=16){
+        __m256i v=_mm256_packs_epi16(avx2_zip16(pcm[0]+j,pcm[1]+j,128.f),
+                                     avx2_zip16(pcm[0]+j+8,pcm[1]+j+8,128.f));
+        v=_mm256_permute4x64_epi64(v,_MM_SHUFFLE(3,1,2,0));
+        _mm256_storeu_si256((__m256i *)(buffer+j*2),_mm256_xor_si256(v,x));
+      }
+    }
+  }else{
+    int x=(sgned?0:0x8000);
+    int swap=(bigendianp!=0);
+    if(channels==1){
+      const float *src=pcm[0];
+      for(j=0;j<n;j+=16){
+        __m256i v=_mm256_packs_epi32(avx2_convert(src+j,32768.f),
+                                     avx2_convert(src+j+8,32768.f));
+        v=_mm256_permute4x64_epi64(v,_MM_SHUFFLE(3,1,2,0));
+        _mm256_storeu_si256((__m256i *)(buffer+j*2),avx2_post16(v,x,swap));
+      }
+    }else{
+      for(j=0;j<n;j+=8){
+        __m256i v=avx2_zip16(pcm[0]+j,pcm[1]+j,32768.f);
+        _mm256_storeu_si256((__m256i *)(buffer+j*4),avx2_post16(v,x,swap));
+      }
+    }
+  }
+  return n;
+}
+
+#endif
+
+/* bit 1<<PCM_IMPL_x for every implementation this CPU can run */
+static int pcm_cpu_impls(void){
+  int cpu=ogg_cpu_features(),impls=1<<PCM_IMPL_C;
+#ifdef PCM_X86
+  if(cpu&OGG_CPU_SSE2)impls|=1<<PCM_IMPL_SSE2;
+  if(cpu&OGG_CPU_AVX2)impls|=1<<PCM_IMPL_AVX2;
+#endif
+#ifdef PCM_NEON
+  if(cpu&OGG_CPU_NEON)impls|=1<<PCM_IMPL_NEON;
+#endif
+  return impls;
+}
+
+int pcm_pack_impl(int impl,char *buffer,float **pcm,int channels,
+                  long samples,int bigendianp,int word,int sgned){
+  int impls=pcm_cpu_impls();
+  long n;
+
+  if(impl<0 || !(impls&(1<<impl)))return 0;
+
+  switch(impl){
+#ifdef PCM_X86
+  case PCM_IMPL_SSE2:
+    n=pcm_pack_v4(buffer,pcm,channels,samples,bigendianp,word,sgned);
+    break;
+  case PCM_IMPL_AVX2:
+    n=pcm_pack_avx2(buffer,pcm,channels,samples,bigendianp,word,sgned);
+    break;
+#endif
+#ifdef PCM_NEON
+  case PCM_IMPL_NEON:
+    n=pcm_pack_v4(buffer,pcm,channels,samples,bigendianp,word,sgned);
+    break;
+#endif
+  default:
+    pcm_pack_c(buffer,pcm,channels,samples,bigendianp,word,sgned);
+    return 1;
+  }
+
+#if defined(PCM_X86) || defined(PCM_NEON)
+  if(n<samples)
+    pcm_pack_tail(buffer,pcm,channels,n,samples,bigendianp,word,sgned);
+#endif
+  return 1;
+}
+
+void pcm_pack(char *buffer,float **pcm,int channels,long samples,
+              int bigendianp,int word,int sgned){
+  if(!pcm_pack_impl(PCM_IMPL_AVX2,buffer,pcm,channels,samples,bigendianp,word,sgned) &&
+     !pcm_pack_impl(PCM_IMPL_SSE2,buffer,pcm,channels,samples,bigendianp,word,sgned) &&
+     !pcm_pack_impl(PCM_IMPL_NEON,buffer,pcm,channels,samples,bigendianp,word,sgned))
+    pcm_pack_c(buffer,pcm,channels,samples,bigendianp,word,sgned);
+}
+
+#ifdef _V_SELFTEST
+
+/* Packs the same input with every implementation this CPU can run, in
+   every output format and for 1 to 8 channels, and compares the bytes
+   with the reference loops. The input covers the rounding ties of both
+   word sizes, the clip points, denormals, infinities and NaN. */
+
+#include <stdio.h>
+
+#define TEST_FRAMES 70000
+
+static const char *names[]={"c","sse2","avx2","neon"};
+
+static float test_special(int i){
+  static const float s[]={0.f,-0.f,1.f,-1.f,1.0000001f,-1.0000001f,
+                          .99998474f,-.99998474f,.99999994f,-.99999994f,
+                          2.f,-2.f,1e-40f,-1e-40f,1e10f,-1e10f,
+                          65536.f,-65536.f,3e9f,-3e9f};
+  float inf=(float)HUGE_VAL;
+  switch(i){
+  case 0: return inf;
+  case 1: return -inf;
+  case 2: return inf-inf;
+  }
+  return s[(i-3)%(sizeof(s)/sizeof(*s))];
+}
+
+int main(){
+  float *pcm[8];
+  char *ref=malloc(TEST_FRAMES*8*2+16);
+  char *out=malloc(TEST_FRAMES*8*2+16);
+  static const long lengths[]={1,15,16,17,31,33,100,1037,TEST_FRAMES};
+  int impl,ch,i,fmt,failed=0;
+  long j,l;
+
+  srand(0);
+  for(i=0;i<8;i++){
+    pcm[i]=malloc(sizeof(**pcm)*TEST_FRAMES);
+    for(j=0;j<TEST_FRAMES;j++){
+      long k=(j*7+i*1031)%TEST_FRAMES;
+      if(k<66000)
+        /* every .5 tie of the 16 bit scale, and of the 8 bit one twice over */
+        pcm[i][j]=(i&1)?(k-33000+.5f)/32768.f:(k%520-260+.5f)/128.f;
+      else if(k<66100)
+        pcm[i][j]=test_special(k-66000);
+      else
+        pcm[i][j]=((float)rand()/RAND_MAX-.5f)*2.2f;
+    }
+  }
+
+  for(impl=0;impl<(int)(sizeof(names)/sizeof(*names));impl++){
+    if(!pcm_pack_impl(impl,out,pcm,1,1,0,2,1))continue;
+    fprintf(stderr,"Packing with %s... ",names[impl]);
+
+    for(ch=1;ch<=8;ch++)
+      for(fmt=0;fmt<8;fmt++){
+        int word=1+(fmt&1),sgned=(fmt>>1)&1,bigendianp=fmt>>2;
+        for(l=0;l<(long)(sizeof(lengths)/sizeof(*lengths));l++){
+          long n=lengths[l],bytes=n*ch*word;
+          memset(ref,0x5a,bytes+16);
+          memset(out,0x5a,bytes+16);
+          pcm_pack_c(ref,pcm,ch,n,bigendianp,word,sgned);
+          pcm_pack_impl(impl,out,pcm,ch,n,bigendianp,word,sgned);
+          if(memcmp(ref,out,bytes+16)){
+            fprintf(stderr,"\n  mismatch: %d channels, %d bit %s %s, %ld frames",
+                    ch,word*8,sgned?"signed":"unsigned",
+                    bigendianp?"big endian":"little endian",n);
+            failed=1;
+            break;
+          }
+        }
+      }
+
+    fprintf(stderr,failed?"\n":"OK\n");
+    if(failed)break;
+  }
+
+  for(i=0;i<8;i++)free(pcm[i]);
+  free(ref);
+  free(out);
+  return(failed);
+}
+
+#endif
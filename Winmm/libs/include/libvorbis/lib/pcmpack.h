@@ -0,0 +1,36 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: float to interleaved integer PCM packing for ov_read
+
+ ********************************************************************/
+
+#ifndef _V_PCMPACK_H_
+#define _V_PCMPACK_H_
+
+#define PCM_IMPL_C    0
+#define PCM_IMPL_SSE2 1
+#define PCM_IMPL_AVX2 2
+#define PCM_IMPL_NEON 3
+
+/* packs samples frames of channels float vectors into buffer in the
+   ov_read layout: interleaved, word 1 or 2 bytes, signed or offset
+   binary, 16 bit words in the requested byte order. */
+extern void pcm_pack(char *buffer,float **pcm,int channels,long samples,
+                     int bigendianp,int word,int sgned);
+
+/* same with a given implementation; returns 0 and packs nothing when
+   impl isn't built in or the CPU can't run it */
+extern int pcm_pack_impl(int impl,char *buffer,float **pcm,int channels,
+                         long samples,int bigendianp,int word,int sgned);
+
+#endif
@@ -0,0 +1,293 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: reader thread prefetching a vorbisfile datasource
+
+ ********************************************************************/
+
+/* The thread owns the datasource position and keeps a ring topped up
+   from it; the consumer owns head. The thread only ever writes past
+   head+fill and only reads outside the lock, in chunks of a quarter
+   of the ring so the consumer gets room back early. A seek that
+   leaves the ring holds the thread, waits for its read to finish and
+   only then touches the datasource. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#define OV_EXCLUDE_STATIC_CALLBACKS
+#include "readahead.h"
+#include "os.h"
+#include "threads.h"
+
+#ifdef VORBIS_THREADS
+
+#define CHUNK_MIN 4096
+
+struct readahead {
+  void             *src;
+  ov_callbacks      io;
+
+  unsigned char    *ring;
+  long              size;
+  long              chunk;
+  long              head;
+  long              fill;
+  ogg_int64_t       pos;   /* datasource offset of head */
+
+  int               eof;   /* nothing more until a seek */
+  int               error; /* and it was a read error */
+  int               busy;  /* the thread is in a read */
+  int               hold;  /* a seek wants the datasource */
+  int               quit;
+
+  long              hits;
+  long              misses;
+
+  v_thread          thread;
+  v_mutex           mutex;
+  v_cond            more;  /* a read finished */
+  v_cond            room;  /* the thread may go on */
+};
+
+#define ra_lock(r)   v_lock(&(r)->mutex)
+#define ra_unlock(r) v_unlock(&(r)->mutex)
+
+/* called locked, return locked */
+static void ra_wait_more(readahead *r){
+  v_wait(&r->more,&r->mutex);
+}
+
+static void ra_wait_room(readahead *r){
+  v_wait(&r->room,&r->mutex);
+}
+
+static void ra_post_more(readahead *r){
+  v_signal(&r->more);
+}
+
+static void ra_post_room(readahead *r){
+  v_signal(&r->room);
+}
+
+static void ra_reader(readahead *r){
+  ra_lock(r);
+  while(!r->quit){
+    long at,n;
+    size_t got;
+    int err;
+
+    if(r->eof || r->hold || r->fill==r->size){
+      ra_wait_room(r);
+      continue;
+    }
+
+    at=(r->head+r->fill)%r->size;
+    n=r->size-r->fill;
+    if(n>r->size-at)n=r->size-at;
+    if(n>r->chunk)n=r->chunk;
+    r->busy=1;
+    ra_unlock(r);
+
+    errno=0;
+    got=(r->io.read_func)(r->ring+at,1,n,r->src);
+    err=errno;
+
+    ra_lock(r);
+    r->busy=0;
+    if(got>0)
+      r->fill+=(long)got;
+    else{
+      r->eof=1;
+      r->error=err!=0;
+    }
+    ra_post_more(r);
+  }
+  ra_unlock(r);
+}
+
+static v_thread_ret V_THREAD_CALL ra_thread(void *arg){
+  ra_reader(arg);
+  return V_THREAD_RET;
+}
+
+readahead *readahead_create(void *datasource,ov_callbacks io,long bytes){
+  readahead *r;
+
+  if(bytes<CHUNK_MIN)bytes=CHUNK_MIN;
+  r=_ogg_calloc(1,sizeof(*r));
+  r->ring=_ogg_malloc(bytes);
+  if(!r->ring){
+    _ogg_free(r);
+    return NULL;
+  }
+  r->src=datasource;
+  r->io=io;
+  r->size=bytes;
+  r->chunk=bytes/4<CHUNK_MIN?CHUNK_MIN:bytes/4;
+  r->pos=io.tell_func?(io.tell_func)(datasource):0;
+
+  v_mutex_init(&r->mutex);
+  v_cond_init(&r->more);
+  v_cond_init(&r->room);
+  if(v_thread_create(&r->thread,ra_thread,r)){
+    v_cond_clear(&r->more);
+    v_cond_clear(&r->room);
+    v_mutex_clear(&r->mutex);
+    _ogg_free(r->ring);
+    _ogg_free(r);
+    return NULL;
+  }
+  return r;
+}
+
+size_t readahead_read(void *ptr,size_t size,size_t nmemb,void *datasource){
+  readahead *r=datasource;
+  long want=(long)(size*nmemb),got=0;
+  int waited=0;
+
+  if(want<=0)return 0;
+  ra_lock(r);
+  while(got<want){
+    long n=want-got;
+
+    if(!r->fill){
+      /* return what is here once it is whole elements */
+      if(r->eof || (got && got%size==0))break;
+      waited=1;
+      ra_wait_more(r);
+      continue;
+    }
+    if(n>r->fill)n=r->fill;
+    if(n>r->size-r->head)n=r->size-r->head;
+    memcpy((char *)ptr+got,r->ring+r->head,n);
+    r->head=(r->head+n)%r->size;
+    r->fill-=n;
+    r->pos+=n;
+    got+=n;
+  }
+  if(waited)r->misses++;
+  else if(got)r->hits++;
+  if(!got && r->error)errno=EIO;
+  ra_unlock(r);
+  if(got)ra_post_room(r);
+
+  return got/size;
+}
+
+int readahead_seek(void *datasource,ogg_int64_t offset,int whence){
+  readahead *r=datasource;
+  int ret;
+
+  if(!r->io.seek_func)return -1;
+
+  ra_lock(r);
+  if(whence==SEEK_CUR){
+    offset+=r->pos;
+    whence=SEEK_SET;
+  }
+  if(whence==SEEK_SET && offset>=r->pos && offset<=r->pos+r->fill){
+    long n=(long)(offset-r->pos);
+    r->head=(r->head+n)%r->size;
+    r->fill-=n;
+    r->pos=offset;
+    ra_unlock(r);
+    if(n)ra_post_room(r);
+    return 0;
+  }
+
+  r->hold=1;
+  while(r->busy)
+    ra_wait_more(r);
+
+  ret=(r->io.seek_func)(r->src,offset,whence);
+  if(!ret){
+    if(whence==SEEK_SET)
+      r->pos=offset;
+    else
+      r->pos=r->io.tell_func?(r->io.tell_func)(r->src):0;
+    r->head=0;
+    r->fill=0;
+    r->eof=0;
+    r->error=0;
+  }
+  r->hold=0;
+  ra_unlock(r);
+  ra_post_room(r);
+
+  return ret;
+}
+
+long readahead_tell(void *datasource){
+  readahead *r=datasource;
+  long ret;
+
+  ra_lock(r);
+  ret=(long)r->pos;
+  ra_unlock(r);
+  return ret;
+}
+
+int readahead_close(void *datasource){
+  readahead *r=datasource;
+  int ret=0;
+
+  ra_lock(r);
+  r->quit=1;
+  ra_unlock(r);
+  ra_post_room(r);
+
+  v_thread_join(r->thread);
+  v_cond_clear(&r->more);
+  v_cond_clear(&r->room);
+  v_mutex_clear(&r->mutex);
+
+  if(r->io.close_func)ret=(r->io.close_func)(r->src);
+  _ogg_free(r->ring);
+  _ogg_free(r);
+  return ret;
+}
+
+void readahead_stats(readahead *r,long *hits,long *misses){
+  ra_lock(r);
+  if(hits)*hits=r->hits;
+  if(misses)*misses=r->misses;
+  ra_unlock(r);
+}
+
+#else
+
+/* no threads here; reads stay on the decoder */
+
+readahead *readahead_create(void *datasource,ov_callbacks io,long bytes){
+  return NULL;
+}
+
+size_t readahead_read(void *ptr,size_t size,size_t nmemb,void *datasource){
+  return 0;
+}
+
+int readahead_seek(void *datasource,ogg_int64_t offset,int whence){
+  return -1;
+}
+
+int readahead_close(void *datasource){
+  return 0;
+}
+
+long readahead_tell(void *datasource){
+  return -1;
+}
+
+void readahead_stats(readahead *r,long *hits,long *misses){}
+
+#endif
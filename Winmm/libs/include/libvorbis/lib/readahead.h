@@ -0,0 +1,44 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: reader thread prefetching a vorbisfile datasource
+
+ ********************************************************************/
+
+#ifndef _V_READAHEAD_H_
+#define _V_READAHEAD_H_
+
+#include "vorbis/vorbisfile.h"
+
+typedef struct readahead readahead;
+
+/* a thread reading up to bytes of datasource ahead of the consumer,
+   from wherever it is now, through io. Returns NULL when the platform
+   has no thread support. */
+extern readahead *readahead_create(void *datasource,ov_callbacks io,
+                                   long bytes);
+
+/* ov_callbacks over a readahead. Seeks inside what is already read
+   ahead skip to it; others wait out the read in progress and start
+   over. readahead_close stops the thread, then closes the datasource
+   through io.close_func if there is one. */
+extern size_t readahead_read(void *ptr,size_t size,size_t nmemb,
+                             void *datasource);
+extern int    readahead_seek(void *datasource,ogg_int64_t offset,int whence);
+extern int    readahead_close(void *datasource);
+extern long   readahead_tell(void *datasource);
+
+/* reads served straight from the ring, and reads that had to wait
+   for the thread */
+extern void   readahead_stats(readahead *r,long *hits,long *misses);
+
+#endif
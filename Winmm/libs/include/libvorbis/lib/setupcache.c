@@ -0,0 +1,213 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: process-wide cache of decoded setup headers
+
+ ********************************************************************/
+
+/* Tracks from one encoder share byte-identical setup headers, so the
+   unpacked modes, mappings, floors, residues and decode codebooks are
+   kept once per distinct packet. Each cached setup holds a private
+   codec_setup_info that owns them; a stream's codec_setup_info gets
+   copies of its pointers and a reference instead. Nothing in it is
+   written once decode books are built, so streams share it without
+   locking. Per-stream state (blocksizes, halfrate_flag) stays in the
+   stream's own copy, and floor/residue lookups stay per
+   vorbis_dsp_state as before. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "vorbis/codec.h"
+#include "codec_internal.h"
+#include "codebook.h"
+#include "setupcache.h"
+#include "os.h"
+#include "threads.h"
+
+#ifdef VORBIS_THREADS
+
+/* unreferenced setups kept for the next open */
+#define SETUP_IDLE 4
+
+struct vorbis_setup {
+  vorbis_setup     *next;
+  long              refs;
+
+  /* the key; unpacking checks the setup against the channel count */
+  ogg_uint32_t      hash;
+  long              bytes;
+  unsigned char    *packet;
+  int               channels;
+  long              blocksizes[2];
+
+  codec_setup_info *ci;
+};
+
+static vorbis_setup *cache; /* most recently used first */
+
+static v_mutex cache_mutex=V_MUTEX_INIT;
+
+#define cache_lock()   v_lock(&cache_mutex)
+#define cache_unlock() v_unlock(&cache_mutex)
+
+/* FNV-1a */
+static ogg_uint32_t setup_hash(const unsigned char *p,long bytes){
+  ogg_uint32_t h=2166136261U;
+  long i;
+  for(i=0;i<bytes;i++)
+    h=(h^p[i])*16777619U;
+  return h;
+}
+
+static void setup_free(vorbis_setup *s){
+  vorbis_info vi;
+  memset(&vi,0,sizeof(vi));
+  vi.codec_setup=s->ci;
+  vorbis_info_clear(&vi);
+  _ogg_free(s->packet);
+  _ogg_free(s);
+}
+
+int _vorbis_setup_find(vorbis_info *vi,ogg_packet *op){
+  codec_setup_info *ci=vi->codec_setup;
+  ogg_uint32_t hash=setup_hash(op->packet,op->bytes);
+  vorbis_setup *s,**prev;
+  int halfrate;
+
+  cache_lock();
+  for(prev=&cache;(s=*prev);prev=&s->next)
+    if(s->hash==hash && s->bytes==op->bytes &&
+       s->channels==vi->channels &&
+       s->blocksizes[0]==ci->blocksizes[0] &&
+       s->blocksizes[1]==ci->blocksizes[1] &&
+       !memcmp(s->packet,op->packet,op->bytes))
+      break;
+  if(s){
+    s->refs++;
+    *prev=s->next;
+    s->next=cache;
+    cache=s;
+  }
+  cache_unlock();
+  if(!s)return 0;
+
+  halfrate=ci->halfrate_flag;
+  memcpy(ci,s->ci,sizeof(*ci));
+  ci->halfrate_flag=halfrate;
+  ci->setup=s;
+  return 1;
+}
+
+void _vorbis_setup_share(vorbis_info *vi,ogg_packet *op){
+  codec_setup_info *ci=vi->codec_setup;
+  vorbis_setup *s;
+  codebook *books;
+  int i;
+
+  /* what _vds_shared_init would do on the first vorbis_synthesis_init,
+     done here so the cached copy never changes afterwards */
+  books=_ogg_calloc(ci->books,sizeof(*books));
+  for(i=0;i<ci->books;i++)
+    if(vorbis_book_init_decode(books+i,ci->book_param[i])){
+      while(i--)vorbis_book_clear(books+i);
+      _ogg_free(books);
+      return;
+    }
+  for(i=0;i<ci->books;i++){
+    vorbis_staticbook_destroy(ci->book_param[i]);
+    ci->book_param[i]=NULL;
+  }
+  ci->fullbooks=books;
+
+  s=_ogg_calloc(1,sizeof(*s));
+  s->refs=1;
+  s->hash=setup_hash(op->packet,op->bytes);
+  s->bytes=op->bytes;
+  s->packet=_ogg_malloc(op->bytes);
+  memcpy(s->packet,op->packet,op->bytes);
+  s->channels=vi->channels;
+  s->blocksizes[0]=ci->blocksizes[0];
+  s->blocksizes[1]=ci->blocksizes[1];
+  s->ci=_ogg_malloc(sizeof(*s->ci));
+  memcpy(s->ci,ci,sizeof(*ci));
+  s->ci->halfrate_flag=0;
+  ci->setup=s;
+
+  cache_lock();
+  s->next=cache;
+  cache=s;
+  cache_unlock();
+}
+
+void _vorbis_setup_release(vorbis_setup *s){
+  vorbis_setup *drop=NULL,**prev;
+  int idle=0;
+
+  cache_lock();
+  if(--s->refs==0){
+    /* unlink idle setups past the newest few */
+    prev=&cache;
+    while((s=*prev)){
+      if(s->refs==0 && ++idle>SETUP_IDLE){
+        *prev=s->next;
+        s->next=drop;
+        drop=s;
+      }else
+        prev=&s->next;
+    }
+  }
+  cache_unlock();
+
+  while((s=drop)){
+    drop=s->next;
+    setup_free(s);
+  }
+}
+
+/* frees every cached setup no stream holds, for when the memory they
+   came from is about to go away */
+void vorbis_setup_cache_clear(void){
+  vorbis_setup *drop=NULL,*s,**prev;
+
+  cache_lock();
+  prev=&cache;
+  while((s=*prev)){
+    if(s->refs==0){
+      *prev=s->next;
+      s->next=drop;
+      drop=s;
+    }else
+      prev=&s->next;
+  }
+  cache_unlock();
+
+  while((s=drop)){
+    drop=s->next;
+    setup_free(s);
+  }
+}
+
+#else
+
+/* no locking here; every stream unpacks its own setup */
+
+int _vorbis_setup_find(vorbis_info *vi,ogg_packet *op){
+  return 0;
+}
+
+void _vorbis_setup_share(vorbis_info *vi,ogg_packet *op){}
+
+void _vorbis_setup_release(vorbis_setup *s){}
+
+void vorbis_setup_cache_clear(void){}
+
+#endif
@@ -0,0 +1,40 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: process-wide cache of decoded setup headers
+
+ ********************************************************************/
+
+#ifndef _V_SETUPCACHE_H_
+#define _V_SETUPCACHE_H_
+
+#include "vorbis/codec.h"
+
+typedef struct vorbis_setup vorbis_setup;
+
+/* looks the setup packet op up for vi, which has its id header. On a
+   hit vi's codec_setup takes a reference to the cached modes,
+   mappings, floors, residues and decode codebooks and 1 is returned;
+   otherwise 0 and the packet has to be unpacked. */
+extern int  _vorbis_setup_find(vorbis_info *vi,ogg_packet *op);
+
+/* after op has been unpacked into vi, finishes the decode codebooks
+   and hands the result to the cache, vi keeping a reference. Does
+   nothing when a book won't build or there is no locking, leaving vi
+   as it was. */
+extern void _vorbis_setup_share(vorbis_info *vi,ogg_packet *op);
+
+/* drops a reference taken by either of the above; the last few
+   unreferenced setups stay cached for the next open */
+extern void _vorbis_setup_release(vorbis_setup *s);
+
+#endif
@@ -267,6 +267,10 @@ void vorbis_staticbook_destroy(static_codebook *b){
 void vorbis_book_clear(codebook *b){
   /* static book is not cleared; we're likely called on the lookup and
      the static codebook belongs to the info struct */
+  if(b->dec_stock){
+    memset(b,0,sizeof(*b));
+    return;
+  }
   if(b->valuelist)_ogg_free(b->valuelist);
   if(b->codelist)_ogg_free(b->codelist);
 
@@ -306,9 +310,68 @@ static int sort32a(const void *a,const void *b){
     ( **(ogg_uint32_t **)a<**(ogg_uint32_t **)b);
 }
 
-/* decode codebook arrangement is more heavily optimized than encode */
-int vorbis_book_init_decode(codebook *c,const static_codebook *s){
-  int i,j,n=0,tabn;
+/* Decode tables. The first level is indexed by the next
+   dec_firsttablen bits of the packet, lsb first as oggpack_look returns
+   them. A slot either holds entry+1 for the codeword those bits start
+   with, or, when longer codewords share them, DEC_SUBTABLE plus the
+   width and offset of a subtable indexed by the bits that follow, and
+   so on down; every codeword resolves without a search. 0 marks bits
+   no codeword starts with.
+
+   Subtables are only as wide as the longest codeword below them needs,
+   up to step bits. Each one is appended at next; returns the end of
+   the table, so a NULL t just sizes it.
+
+   Lookups aren't capped at two. Codewords may run to 32 bits, so one
+   subtable under the first level could need millions of slots, and a
+   cap would bring back a search for the longest codewords. Only long,
+   rare codewords sit deeper: over the stock books a codeword takes
+   1.03 lookups on average and never more than four. */
+
+static long _make_decode_table(codebook *c,ogg_uint32_t *t,long at,long next,
+                               int skip,int bits,long lo,long hi,int step){
+  long i=lo;
+
+  while(i<hi){
+    int len=c->dec_codelengths[i];
+    ogg_uint32_t orig=bitreverse(c->codelist[i])>>skip;
+
+    if(len<=skip+bits){
+      /* a leaf; it owns every slot its codeword is a prefix of */
+      if(t){
+        long j;
+        for(j=0;j<(1L<<(skip+bits-len));j++)
+          t[at+(orig|(j<<(len-skip)))]=i+1;
+      }
+      i++;
+    }else{
+      /* the codewords that share this slot are contiguous in codelist */
+      ogg_uint32_t prefix=c->codelist[i]>>(32-skip-bits);
+      long end=i+1;
+      int sub=len;
+
+      while(end<hi && c->codelist[end]>>(32-skip-bits)==prefix){
+        if(c->dec_codelengths[end]>sub)sub=c->dec_codelengths[end];
+        end++;
+      }
+      sub-=skip+bits;
+      if(sub>step)sub=step;
+
+      if(t)
+        t[at+(orig&((1UL<<bits)-1))]=DEC_SUBTABLE|((ogg_uint32_t)sub<<26)|next;
+      next=_make_decode_table(c,t,next,next+(1L<<sub),skip+bits,sub,
+                              i,end,step);
+      i=end;
+    }
+  }
+  return next;
+}
+
+/* decode codebook arrangement is more heavily optimized than encode;
+   this always builds the tables, vorbis_book_init_decode below first
+   looks for them in stockbooks.h */
+int vorbis_book_build_decode(codebook *c,const static_codebook *s){
+  int i,n=0,tabn;
   int *sortindex;
 
   memset(c,0,sizeof(*c));
@@ -321,6 +384,7 @@ int vorbis_book_init_decode(codebook *c,const static_codebook *s){
   c->entries=s->entries;
   c->used_entries=n;
   c->dim=s->dim;
+  vorbis_book_init_decodev(c);
 
   if(n>0){
     /* two different remappings go on here.
@@ -383,48 +447,27 @@ int vorbis_book_init_decode(codebook *c,const static_codebook *s){
       c->dec_firsttable[0]=c->dec_firsttable[1]=1;
 
     }else{
-      c->dec_firsttablen=ov_ilog(c->used_entries)-4; /* this is magic */
-      if(c->dec_firsttablen<5)c->dec_firsttablen=5;
-      if(c->dec_firsttablen>8)c->dec_firsttablen=8;
+      long size;
+      int step;
 
+      c->dec_firsttablen=ov_ilog(c->used_entries)-4; /* this is magic */
+      if(c->dec_firsttablen<9)c->dec_firsttablen=9;
+      if(c->dec_firsttablen>10)c->dec_firsttablen=10;
+      if(c->dec_firsttablen>c->dec_maxlength)
+        c->dec_firsttablen=c->dec_maxlength;
+
+      /* narrow the subtables until the whole thing fits the budget;
+         at a step of one they are a plain binary tree, which is as
+         small as it gets */
       tabn=1<<c->dec_firsttablen;
-      c->dec_firsttable=_ogg_calloc(tabn,sizeof(*c->dec_firsttable));
-
-      for(i=0;i<n;i++){
-        if(c->dec_codelengths[i]<=c->dec_firsttablen){
-          ogg_uint32_t orig=bitreverse(c->codelist[i]);
-          for(j=0;j<(1<<(c->dec_firsttablen-c->dec_codelengths[i]));j++)
-            c->dec_firsttable[orig|(j<<c->dec_codelengths[i])]=i+1;
-        }
-      }
-
-      /* now fill in 'unused' entries in the firsttable with hi/lo search
-         hints for the non-direct-hits */
-      {
-        ogg_uint32_t mask=0xfffffffeUL<<(31-c->dec_firsttablen);
-        long lo=0,hi=0;
-
-        for(i=0;i<tabn;i++){
-          ogg_uint32_t word=i<<(32-c->dec_firsttablen);
-          if(c->dec_firsttable[bitreverse(word)]==0){
-            while((lo+1)<n && c->codelist[lo+1]<=word)lo++;
-            while(    hi<n && word>=(c->codelist[hi]&mask))hi++;
-
-            /* we only actually have 15 bits per hint to play with here.
-               In order to overflow gracefully (nothing breaks, efficiency
-               just drops), encode as the difference from the extremes. */
-            {
-              unsigned long loval=lo;
-              unsigned long hival=n-hi;
-
-              if(loval>0x7fff)loval=0x7fff;
-              if(hival>0x7fff)hival=0x7fff;
-              c->dec_firsttable[bitreverse(word)]=
-                0x80000000UL | (loval<<15) | hival;
-            }
-          }
-        }
-      }
+      for(step=DEC_SUBTABLE_BITS;step>1;step--)
+        if(_make_decode_table(c,NULL,0,tabn,0,c->dec_firsttablen,
+                              0,n,step)<=tabn+DEC_TABLE_BUDGET)break;
+
+      size=_make_decode_table(c,NULL,0,tabn,0,c->dec_firsttablen,0,n,step);
+      c->dec_firsttable=_ogg_calloc(size,sizeof(*c->dec_firsttable));
+      _make_decode_table(c,c->dec_firsttable,0,tabn,0,c->dec_firsttablen,
+                         0,n,step);
     }
   }
 
@@ -434,6 +477,114 @@ int vorbis_book_init_decode(codebook *c,const static_codebook *s){
   return(-1);
 }
 
+/* slots in dec_firsttable; the first level plus every subtable
+   hanging off it */
+long _vorbis_book_table_size(const codebook *c){
+  long size=1L<<c->dec_firsttablen,i;
+  for(i=0;i<size;i++)
+    if(c->dec_firsttable[i]&DEC_SUBTABLE){
+      ogg_uint32_t e=c->dec_firsttable[i];
+      long end=(e&0x3ffffff)+(1L<<((e>>26)&0x1f));
+      if(end>size)size=end;
+    }
+  return size;
+}
+
+/* Decode tables of the books the stock encoder setups write, made at
+   build time by mkstockbooks and sorted by _vorbis_book_hash. A match
+   is checked against everything the tables are made from; the used
+   entries' lengths are checked through dec_index and
+   dec_codelengths. */
+
+typedef struct stock_book {
+  ogg_uint32_t        hash;
+  long                dim;
+  long                entries;
+  int                 maptype;
+  ogg_uint32_t        q_min;   /* packed, as read */
+  ogg_uint32_t        q_delta;
+  int                 q_quant;
+  int                 q_sequencep;
+  long                quantvals;
+  const long         *quantlist;
+
+  long                used_entries;
+  const ogg_uint32_t *codelist;
+  const float        *valuelist;
+  const int          *dec_index;
+  const char         *dec_codelengths;
+  const ogg_uint32_t *dec_firsttable;
+  int                 dec_firsttablen;
+  int                 dec_maxlength;
+} stock_book;
+
+#include "stockbooks.h"
+
+/* FNV-1a of the codeword lengths */
+ogg_uint32_t _vorbis_book_hash(const static_codebook *s){
+  ogg_uint32_t h=2166136261U;
+  long i;
+  for(i=0;i<s->entries;i++)
+    h=(h^(unsigned char)s->lengthlist[i])*16777619U;
+  return h;
+}
+
+static int _stock_match(const stock_book *b,const static_codebook *s){
+  long i,n=0;
+
+  if(b->dim!=s->dim || b->entries!=s->entries || b->maptype!=s->maptype)
+    return 0;
+  if(s->maptype){
+    if(b->q_min!=((ogg_uint32_t)s->q_min&0xffffffffUL) ||
+       b->q_delta!=((ogg_uint32_t)s->q_delta&0xffffffffUL) ||
+       b->q_quant!=s->q_quant || b->q_sequencep!=s->q_sequencep)
+      return 0;
+    for(i=0;i<b->quantvals;i++)
+      if(b->quantlist[i]!=s->quantlist[i])return 0;
+  }
+
+  for(i=0;i<s->entries;i++)
+    if(s->lengthlist[i]>0)n++;
+  if(n!=b->used_entries)return 0;
+  for(i=0;i<n;i++)
+    if(s->lengthlist[b->dec_index[i]]!=b->dec_codelengths[i])return 0;
+  return 1;
+}
+
+int vorbis_book_init_decode(codebook *c,const static_codebook *s){
+  ogg_uint32_t hash=_vorbis_book_hash(s);
+  long lo=0,hi=STOCK_BOOKS;
+
+  while(lo<hi){
+    long mid=(lo+hi)>>1;
+    if(stock_books[mid].hash<hash)lo=mid+1;
+    else hi=mid;
+  }
+
+  for(;lo<STOCK_BOOKS && stock_books[lo].hash==hash;lo++){
+    const stock_book *b=stock_books+lo;
+    if(!_stock_match(b,s))continue;
+
+    /* nothing in decode writes these */
+    memset(c,0,sizeof(*c));
+    c->entries=s->entries;
+    c->used_entries=b->used_entries;
+    c->dim=s->dim;
+    c->codelist=(ogg_uint32_t *)b->codelist;
+    c->valuelist=(float *)b->valuelist;
+    c->dec_index=(int *)b->dec_index;
+    c->dec_codelengths=(char *)b->dec_codelengths;
+    c->dec_firsttable=(ogg_uint32_t *)b->dec_firsttable;
+    c->dec_firsttablen=b->dec_firsttablen;
+    c->dec_maxlength=b->dec_maxlength;
+    c->dec_stock=1;
+    vorbis_book_init_decodev(c);
+    return(0);
+  }
+
+  return vorbis_book_build_decode(c,s);
+}
+
 long vorbis_book_codeword(codebook *book,int entry){
   if(book->c) /* only use with encode; decode optimizations are
                  allowed to break this */
@@ -566,6 +717,63 @@ void run_test(static_codebook *b,float *comp){
   }
 }
 
+/* rebuilds each stock book from what its tables hold, then checks
+   vorbis_book_init_decode picks the tables and they are the ones the
+   runtime build makes, and that a one-length change misses them */
+static void stock_test(void){
+  int k;
+  for(k=0;k<STOCK_BOOKS;k++){
+    const stock_book *b=stock_books+k;
+    static_codebook s;
+    codebook st,built;
+    long i,n=b->used_entries;
+
+    memset(&s,0,sizeof(s));
+    s.dim=b->dim;
+    s.entries=b->entries;
+    s.lengthlist=calloc(b->entries,1);
+    for(i=0;i<n;i++)s.lengthlist[b->dec_index[i]]=b->dec_codelengths[i];
+    s.maptype=b->maptype;
+    s.q_min=(ogg_int32_t)b->q_min;
+    s.q_delta=(ogg_int32_t)b->q_delta;
+    s.q_quant=b->q_quant;
+    s.q_sequencep=b->q_sequencep;
+    s.quantlist=(long *)b->quantlist;
+
+    if(vorbis_book_init_decode(&st,&s) || !st.dec_stock){
+      fprintf(stderr,"stock book %d not found\n",k);
+      exit(1);
+    }
+    vorbis_book_build_decode(&built,&s);
+    if(built.used_entries!=n ||
+       built.dec_firsttablen!=st.dec_firsttablen ||
+       built.dec_maxlength!=st.dec_maxlength ||
+       _vorbis_book_table_size(&built)!=_vorbis_book_table_size(&st) ||
+       memcmp(built.codelist,st.codelist,n*sizeof(*st.codelist)) ||
+       memcmp(built.dec_index,st.dec_index,n*sizeof(*st.dec_index)) ||
+       memcmp(built.dec_codelengths,st.dec_codelengths,n) ||
+       memcmp(built.dec_firsttable,st.dec_firsttable,
+              _vorbis_book_table_size(&st)*sizeof(*st.dec_firsttable)) ||
+       (!built.valuelist)!=(!st.valuelist) ||
+       (st.valuelist && memcmp(built.valuelist,st.valuelist,
+                               n*b->dim*sizeof(*st.valuelist)))){
+      fprintf(stderr,"stock book %d differs from its runtime build\n",k);
+      exit(1);
+    }
+    vorbis_book_clear(&built);
+    vorbis_book_clear(&st);
+
+    s.lengthlist[b->dec_index[n-1]]++;
+    vorbis_book_init_decode(&st,&s);
+    if(st.dec_stock){
+      fprintf(stderr,"stock book %d matched a changed book\n",k);
+      exit(1);
+    }
+    vorbis_book_clear(&st);
+    free(s.lengthlist);
+  }
+}
+
 int main(){
   /* run the nine dequant tests, and compare to the hand-rolled results */
   fprintf(stderr,"Dequant test 1... ");
@@ -578,6 +786,8 @@ int main(){
   run_test(&test4,test4_result);
   fprintf(stderr,"OK\nDequant test 5... ");
   run_test(&test5,test5_result);
+  fprintf(stderr,"OK\nStock book tables... ");
+  stock_test();
   fprintf(stderr,"OK\n\n");
 
   return(0);
@@ -0,0 +1,190 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: per packet synthesis latency benchmark; encodes a few
+           seconds of 5.1 noise and tones at 48kHz, then times
+           vorbis_synthesis on every packet serially and with 2 to 6
+           channel threads, checking the PCM matches the serial run
+
+ ********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ogg/ogg.h>
+#include "vorbis/codec.h"
+#include "vorbis/vorbisenc.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define CHANNELS 6
+#define RATE     48000
+#define SECONDS  10
+
+typedef struct {
+  unsigned char *data;
+  long           bytes;
+} packet;
+
+/* wall clock seconds; clock() would add up the workers' time too */
+static double now(void){
+#ifdef _WIN32
+  LARGE_INTEGER t,f;
+  QueryPerformanceCounter(&t);
+  QueryPerformanceFrequency(&f);
+  return (double)t.QuadPart/f.QuadPart;
+#else
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC,&t);
+  return t.tv_sec+t.tv_nsec*1e-9;
+#endif
+}
+
+static packet *packets;
+static long    count;
+static ogg_packet head[3];
+
+static void keep(ogg_packet *op){
+  packets=realloc(packets,sizeof(*packets)*(count+1));
+  packets[count].data=malloc(op->bytes);
+  packets[count].bytes=op->bytes;
+  memcpy(packets[count].data,op->packet,op->bytes);
+  count++;
+}
+
+static void encode(void){
+  vorbis_info vi;
+  vorbis_comment vc;
+  vorbis_dsp_state vd;
+  vorbis_block vb;
+  ogg_packet op;
+  long i,frames=0;
+  int c;
+
+  vorbis_info_init(&vi);
+  vorbis_encode_init_vbr(&vi,CHANNELS,RATE,.4f);
+  vorbis_comment_init(&vc);
+  vorbis_analysis_init(&vd,&vi);
+  vorbis_block_init(&vd,&vb);
+  vorbis_analysis_headerout(&vd,&vc,head,head+1,head+2);
+  for(c=0;c<3;c++){
+    unsigned char *d=malloc(head[c].bytes);
+    memcpy(d,head[c].packet,head[c].bytes);
+    head[c].packet=d;
+  }
+
+  srand(0);
+  while(1){
+    long n=frames<RATE*SECONDS?1024:0;
+    float **buf=vorbis_analysis_buffer(&vd,1024);
+    for(c=0;c<CHANNELS;c++)
+      for(i=0;i<n;i++){
+        double t=(double)(frames+i)/RATE;
+        buf[c][i]=.2f*sin(t*2*M_PI*(110*(c+1)+40*sin(t)))+
+          .05f*((float)rand()/RAND_MAX-.5f)*(i%4096<2048);
+      }
+    vorbis_analysis_wrote(&vd,n);
+    frames+=n;
+
+    while(vorbis_analysis_blockout(&vd,&vb)==1){
+      vorbis_analysis(&vb,NULL);
+      vorbis_bitrate_addblock(&vb);
+      while(vorbis_bitrate_flushpacket(&vd,&op))keep(&op);
+    }
+    if(!n)break;
+  }
+
+  vorbis_block_clear(&vb);
+  vorbis_dsp_clear(&vd);
+  vorbis_comment_clear(&vc);
+  vorbis_info_clear(&vi);
+}
+
+/* average ns per long and short block packet; sums every sample into
+   *check so runs can be compared */
+static void run(int threads,double *ns,long *blocks,double *check){
+  vorbis_info vi;
+  vorbis_comment vc;
+  vorbis_dsp_state vd;
+  vorbis_block vb;
+  long i;
+  int c,j;
+
+  vorbis_info_init(&vi);
+  vorbis_comment_init(&vc);
+  for(c=0;c<3;c++)vorbis_synthesis_headerin(&vi,&vc,head+c);
+  vorbis_synthesis_init(&vd,&vi);
+  vorbis_block_init(&vd,&vb);
+  vorbis_synthesis_threads(&vd,threads,0,0);
+
+  ns[0]=ns[1]=0;
+  blocks[0]=blocks[1]=0;
+  *check=0;
+  for(i=0;i<count;i++){
+    ogg_packet op;
+    double start;
+
+    memset(&op,0,sizeof(op));
+    op.packet=packets[i].data;
+    op.bytes=packets[i].bytes;
+    op.packetno=i+3;
+
+    start=now();
+    if(vorbis_synthesis(&vb,&op))continue;
+    ns[vb.W]+=(now()-start)*1e9;
+    blocks[vb.W]++;
+
+    for(c=0;c<CHANNELS;c++)
+      for(j=0;j<vb.pcmend;j++)*check+=vb.pcm[c][j]*(j+1);
+  }
+
+  vorbis_block_clear(&vb);
+  vorbis_dsp_clear(&vd);
+  vorbis_comment_clear(&vc);
+  vorbis_info_clear(&vi);
+}
+
+int main(int argc,char **argv){
+  int rounds=argc>1?atoi(argv[1]):5;
+  double ref=0;
+  int threads,failed=0;
+
+  encode();
+  printf("%ld packets, %d channels\n",count,CHANNELS);
+  printf("%8s %12s %12s   (us per packet, best of %d)\n","threads","long",
+         "short",rounds);
+
+  for(threads=1;threads<=CHANNELS;threads++){
+    double best[2]={1e30,1e30};
+    int r;
+
+    for(r=0;r<rounds;r++){
+      double ns[2],check;
+      long blocks[2];
+      int w;
+
+      run(threads,ns,blocks,&check);
+      if(threads==1 && r==0)ref=check;
+      if(check!=ref)failed=1;
+      for(w=0;w<2;w++)
+        if(blocks[w] && ns[w]/blocks[w]<best[w])best[w]=ns[w]/blocks[w];
+    }
+    printf("%8d %12.1f %12.1f%s\n",threads,best[1]/1000,best[0]/1000,
+           failed?"   MISMATCH":"");
+  }
+  return failed;
+}
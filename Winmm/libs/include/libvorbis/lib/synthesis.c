@@ -178,3 +178,25 @@ int vorbis_synthesis_halfrate_p(vorbis_info *vi){
   codec_setup_info     *ci=vi->codec_setup;
   return ci->halfrate_flag;
 }
+
+/* splits the per channel floor and inverse MDCT work of each packet
+   over threads threads (the caller's included) when the stream has at
+   least channels channels and the block is at least blocksize samples.
+   0 picks the defaults, 6 channels and 2048 samples; stereo never
+   qualifies. threads < 2 goes back to serial. */
+int vorbis_synthesis_threads(vorbis_dsp_state *v,int threads,int channels,
+                             long blocksize){
+  private_state *b=v->backend_state;
+
+  if(!b)return OV_EINVAL;
+  chanpool_destroy(b->chpool);
+  b->chpool=NULL;
+  if(threads<2)return 0;
+
+  b->chpool=chanpool_create(threads);
+  if(!b->chpool)return OV_EIMPL;
+  b->chpool_channels=channels>0?channels:6;
+  if(b->chpool_channels<3)b->chpool_channels=3;
+  b->chpool_blocksize=blocksize>0?blocksize:2048;
+  return 0;
+}
@@ -0,0 +1,325 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: worker threads running vorbis_synthesis ahead of the
+           consumer for vorbisfile's threaded decode mode
+
+ ********************************************************************/
+
+/* Packets only depend on each other through the overlap-add in
+   vorbis_synthesis_blockin; floor, residue, coupling and the inverse
+   MDCT read nothing but the packet and the decode setup. So workers
+   may run vorbis_synthesis on later packets, each into a block of its
+   own, while the consumer blocks in the earlier ones in order.
+
+   The queue is a ring of slots, oldest at head. A slot goes
+   FREE -> QUEUED -> BUSY (a worker has it) -> DONE, and back to FREE
+   once the consumer has blocked it in. Workers take the oldest QUEUED
+   slot so the one the consumer waits on is always started first.
+
+   floor0 builds its bark map on first use without any locking; a
+   setup with a floor0 in it decodes on the consumer (INLINE) instead,
+   still through the ring so the order doesn't change. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "vorbis/codec.h"
+#include "codec_internal.h"
+#include "synthpipe.h"
+#include "os.h"
+#include "threads.h"
+
+#ifdef VORBIS_THREADS
+
+#define SLOT_FREE   0
+#define SLOT_QUEUED 1
+#define SLOT_BUSY   2
+#define SLOT_DONE   3
+#define SLOT_INLINE 4
+
+typedef struct {
+  int            state;
+  int            hole;
+  int            ret;
+  ogg_packet     op;
+  unsigned char *data;
+  long           storage;
+  vorbis_block   vb;
+} synthslot;
+
+struct synthpipe {
+  vorbis_dsp_state *vd;
+  synthslot        *slots;
+  int               size;
+  int               head;
+  int               count;
+  int               quit;
+
+  int               threads;
+  v_thread         *thread;
+  v_mutex           mutex;
+  v_cond            work; /* a slot was queued */
+  v_cond            done; /* a slot completed */
+
+  int               stashed;
+  ogg_page          stash;
+  unsigned char    *stashdata;
+  long              stashstorage;
+};
+
+#define pipe_lock(p)   v_lock(&(p)->mutex)
+#define pipe_unlock(p) v_unlock(&(p)->mutex)
+
+/* called locked, returns locked */
+static void pipe_wait_done(synthpipe *p){
+  v_wait(&p->done,&p->mutex);
+}
+
+static void pipe_post_work(synthpipe *p,int n){
+  if(n==1)
+    v_signal(&p->work);
+  else
+    v_broadcast(&p->work);
+}
+
+/* the oldest queued slot, or NULL; called locked */
+static synthslot *pipe_take(synthpipe *p){
+  int i;
+  for(i=0;i<p->count;i++){
+    synthslot *s=p->slots+(p->head+i)%p->size;
+    if(s->state==SLOT_QUEUED){
+      s->state=SLOT_BUSY;
+      return s;
+    }
+  }
+  return NULL;
+}
+
+static void pipe_worker(synthpipe *p){
+  pipe_lock(p);
+  while(!p->quit){
+    synthslot *s=pipe_take(p);
+    if(!s){
+      v_wait(&p->work,&p->mutex);
+      continue;
+    }
+    pipe_unlock(p);
+
+    s->ret=vorbis_synthesis(&s->vb,&s->op);
+
+    pipe_lock(p);
+    s->state=SLOT_DONE;
+    v_broadcast(&p->done);
+  }
+  pipe_unlock(p);
+}
+
+static v_thread_ret V_THREAD_CALL pipe_thread(void *arg){
+  pipe_worker(arg);
+  return V_THREAD_RET;
+}
+
+synthpipe *synthpipe_create(vorbis_dsp_state *vd,int threads){
+  synthpipe *p;
+  int i;
+
+  if(threads<1)return NULL;
+  p=_ogg_calloc(1,sizeof(*p));
+  p->vd=vd;
+  p->size=threads*2;
+  p->slots=_ogg_calloc(p->size,sizeof(*p->slots));
+  p->thread=_ogg_calloc(threads,sizeof(*p->thread));
+  for(i=0;i<p->size;i++)
+    vorbis_block_init(vd,&p->slots[i].vb);
+
+  v_mutex_init(&p->mutex);
+  v_cond_init(&p->work);
+  v_cond_init(&p->done);
+  for(i=0;i<threads;i++)
+    if(v_thread_create(p->thread+i,pipe_thread,p))break;
+  p->threads=i;
+
+  if(p->threads==0){
+    synthpipe_destroy(p);
+    return NULL;
+  }
+  return p;
+}
+
+void synthpipe_destroy(synthpipe *p){
+  int i;
+  if(!p)return;
+
+  pipe_lock(p);
+  p->quit=1;
+  pipe_unlock(p);
+  pipe_post_work(p,p->threads);
+
+  for(i=0;i<p->threads;i++)
+    v_thread_join(p->thread[i]);
+  v_cond_clear(&p->work);
+  v_cond_clear(&p->done);
+  v_mutex_clear(&p->mutex);
+
+  for(i=0;i<p->size;i++){
+    vorbis_block_clear(&p->slots[i].vb);
+    if(p->slots[i].data)_ogg_free(p->slots[i].data);
+  }
+  if(p->stashdata)_ogg_free(p->stashdata);
+  _ogg_free(p->thread);
+  _ogg_free(p->slots);
+  _ogg_free(p);
+}
+
+/* count and head only ever change on the consumer's thread, which is
+   the one calling in here */
+int synthpipe_full(synthpipe *p){
+  return p->count==p->size;
+}
+
+/* nonzero if the current setup has to decode on the consumer */
+static int pipe_inline(synthpipe *p){
+  vorbis_info *vi=p->vd->vi;
+  codec_setup_info *ci=vi?vi->codec_setup:NULL;
+  int i;
+
+  if(!ci)return 1;
+  for(i=0;i<ci->floors;i++)
+    if(ci->floor_type[i]==0)return 1;
+  return 0;
+}
+
+void synthpipe_submit(synthpipe *p,ogg_packet *op){
+  synthslot *s=p->slots+(p->head+p->count)%p->size;
+  int state=SLOT_DONE;
+
+  s->hole=(op==NULL);
+  if(op){
+    if(s->storage<op->bytes){
+      s->storage=op->bytes;
+      s->data=_ogg_realloc(s->data,s->storage);
+    }
+    if(op->bytes)memcpy(s->data,op->packet,op->bytes);
+    s->op=*op;
+    s->op.packet=s->data;
+    state=pipe_inline(p)?SLOT_INLINE:SLOT_QUEUED;
+  }
+
+  pipe_lock(p);
+  s->state=state;
+  p->count++;
+  pipe_unlock(p);
+  if(state==SLOT_QUEUED)pipe_post_work(p,1);
+}
+
+int synthpipe_next(synthpipe *p,vorbis_block **vb,ogg_packet **op,int *ret){
+  synthslot *s;
+
+  if(p->count==0)return 0;
+  s=p->slots+p->head;
+
+  if(s->hole){
+    synthpipe_release(p);
+    return -1;
+  }
+
+  pipe_lock(p);
+  /* a queued slot is still waiting behind busy workers; do it here
+     rather than wait for one to free up */
+  if(s->state==SLOT_QUEUED || s->state==SLOT_INLINE){
+    s->state=SLOT_BUSY;
+    pipe_unlock(p);
+    s->ret=vorbis_synthesis(&s->vb,&s->op);
+    pipe_lock(p);
+    s->state=SLOT_DONE;
+  }
+  while(s->state!=SLOT_DONE)
+    pipe_wait_done(p);
+  pipe_unlock(p);
+
+  *vb=&s->vb;
+  *op=&s->op;
+  *ret=s->ret;
+  return 1;
+}
+
+void synthpipe_release(synthpipe *p){
+  pipe_lock(p);
+  p->slots[p->head].state=SLOT_FREE;
+  p->head=(p->head+1)%p->size;
+  p->count--;
+  pipe_unlock(p);
+}
+
+void synthpipe_reset(synthpipe *p){
+  int i;
+
+  pipe_lock(p);
+  for(i=0;i<p->count;i++){
+    synthslot *s=p->slots+(p->head+i)%p->size;
+    while(s->state==SLOT_BUSY)
+      pipe_wait_done(p);
+    s->state=SLOT_FREE;
+  }
+  p->head=0;
+  p->count=0;
+  pipe_unlock(p);
+  p->stashed=0;
+}
+
+void synthpipe_stash(synthpipe *p,ogg_page *og){
+  long bytes=og->header_len+og->body_len;
+  if(p->stashstorage<bytes){
+    p->stashstorage=bytes;
+    p->stashdata=_ogg_realloc(p->stashdata,bytes);
+  }
+  memcpy(p->stashdata,og->header,og->header_len);
+  memcpy(p->stashdata+og->header_len,og->body,og->body_len);
+  p->stash.header=p->stashdata;
+  p->stash.header_len=og->header_len;
+  p->stash.body=p->stashdata+og->header_len;
+  p->stash.body_len=og->body_len;
+  p->stashed=1;
+}
+
+int synthpipe_stashed(synthpipe *p){
+  return p->stashed;
+}
+
+int synthpipe_unstash(synthpipe *p,ogg_page *og){
+  if(!p->stashed)return 0;
+  *og=p->stash;
+  p->stashed=0;
+  return 1;
+}
+
+#else
+
+/* no threads here; vorbisfile keeps decoding serially */
+
+synthpipe *synthpipe_create(vorbis_dsp_state *vd,int threads){
+  return NULL;
+}
+
+void synthpipe_destroy(synthpipe *p){}
+int synthpipe_full(synthpipe *p){return 1;}
+void synthpipe_submit(synthpipe *p,ogg_packet *op){}
+int synthpipe_next(synthpipe *p,vorbis_block **vb,ogg_packet **op,int *ret){
+  return 0;
+}
+void synthpipe_release(synthpipe *p){}
+void synthpipe_reset(synthpipe *p){}
+void synthpipe_stash(synthpipe *p,ogg_page *og){}
+int synthpipe_stashed(synthpipe *p){return 0;}
+int synthpipe_unstash(synthpipe *p,ogg_page *og){return 0;}
+
+#endif
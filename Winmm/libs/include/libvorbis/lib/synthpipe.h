@@ -0,0 +1,56 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: worker threads running vorbis_synthesis ahead of the
+           consumer for vorbisfile's threaded decode mode
+
+ ********************************************************************/
+
+#ifndef _V_SYNTHPIPE_H_
+#define _V_SYNTHPIPE_H_
+
+#include "vorbis/codec.h"
+
+typedef struct synthpipe synthpipe;
+
+/* threads workers decoding up to twice as many packets ahead, each
+   into its own vorbis_block on vd. Returns NULL when threads < 1 or
+   the platform has no thread support. */
+extern synthpipe *synthpipe_create(vorbis_dsp_state *vd,int threads);
+extern void       synthpipe_destroy(synthpipe *p);
+
+/* nonzero when no more packets can be queued */
+extern int        synthpipe_full(synthpipe *p);
+
+/* queues a copy of op for synthesis; op==NULL queues a hole, which
+   synthpipe_next reports in order like any packet */
+extern void       synthpipe_submit(synthpipe *p,ogg_packet *op);
+
+/* the oldest queued packet, once it is decoded: 1 with its block, the
+   packet and the vorbis_synthesis return in vb, op and ret, -1 for a
+   hole, 0 if nothing is queued. The block and packet stay valid until
+   synthpipe_release. */
+extern int        synthpipe_next(synthpipe *p,vorbis_block **vb,
+                                 ogg_packet **op,int *ret);
+extern void       synthpipe_release(synthpipe *p);
+
+/* drops everything queued or stashed; returns once no worker is using
+   vd, so the caller may clear or reinit it */
+extern void       synthpipe_reset(synthpipe *p);
+
+/* a page read ahead that belongs to whatever comes after the queued
+   packets; the stash keeps its own copy */
+extern void       synthpipe_stash(synthpipe *p,ogg_page *og);
+extern int        synthpipe_stashed(synthpipe *p);
+extern int        synthpipe_unstash(synthpipe *p,ogg_page *og);
+
+#endif
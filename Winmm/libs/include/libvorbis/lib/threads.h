@@ -0,0 +1,101 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: locks, condition variables and threads for the decode
+           threads, channel pool, readahead and setup cache
+
+ ********************************************************************/
+
+#ifndef _V_THREADS_H_
+#define _V_THREADS_H_
+
+/* VORBIS_THREADS is defined where there are threads; without it the
+   users fall back to serial code. Both sides are a mutex with
+   condition variables, so waits go in a loop on their predicate.
+   Windows needs Vista for SRW locks and condition variables; a build
+   for anything older stays serial. */
+
+#if defined(_WIN32)
+#  include <windows.h>
+#  if defined(_WIN32_WINNT) && _WIN32_WINNT>=0x0600
+#    define VORBIS_THREADS_WIN32
+#  endif
+#elif defined(__unix__) || defined(__APPLE__)
+#  include <unistd.h>
+#  if defined(_POSIX_THREADS) && _POSIX_THREADS>0
+#    define VORBIS_THREADS_PTHREAD
+#    include <pthread.h>
+#  endif
+#endif
+
+#if defined(VORBIS_THREADS_WIN32)
+#define VORBIS_THREADS
+
+typedef SRWLOCK            v_mutex;
+typedef CONDITION_VARIABLE v_cond;
+typedef HANDLE             v_thread;
+
+/* a thread entry is  static v_thread_ret V_THREAD_CALL f(void *arg)
+   and returns V_THREAD_RET */
+typedef DWORD              v_thread_ret;
+#define V_THREAD_CALL      WINAPI
+#define V_THREAD_RET       0
+
+#define V_MUTEX_INIT       SRWLOCK_INIT
+
+#define v_mutex_init(m)    InitializeSRWLock(m)
+#define v_mutex_clear(m)   ((void)(m))
+#define v_lock(m)          AcquireSRWLockExclusive(m)
+#define v_unlock(m)        ReleaseSRWLockExclusive(m)
+
+#define v_cond_init(c)     InitializeConditionVariable(c)
+#define v_cond_clear(c)    ((void)(c))
+#define v_wait(c,m)        SleepConditionVariableSRW(c,m,INFINITE,0)
+#define v_signal(c)        WakeConditionVariable(c)
+#define v_broadcast(c)     WakeAllConditionVariable(c)
+
+/* nonzero if the thread didn't start */
+#define v_thread_create(t,fn,arg) \
+  ((*(t)=CreateThread(NULL,0,fn,arg,0,NULL))==NULL)
+#define v_thread_join(t) \
+  (WaitForSingleObject(t,INFINITE),CloseHandle(t))
+
+#elif defined(VORBIS_THREADS_PTHREAD)
+#define VORBIS_THREADS
+
+typedef pthread_mutex_t    v_mutex;
+typedef pthread_cond_t     v_cond;
+typedef pthread_t          v_thread;
+
+typedef void              *v_thread_ret;
+#define V_THREAD_CALL
+#define V_THREAD_RET       NULL
+
+#define V_MUTEX_INIT       PTHREAD_MUTEX_INITIALIZER
+
+#define v_mutex_init(m)    pthread_mutex_init(m,NULL)
+#define v_mutex_clear(m)   pthread_mutex_destroy(m)
+#define v_lock(m)          pthread_mutex_lock(m)
+#define v_unlock(m)        pthread_mutex_unlock(m)
+
+#define v_cond_init(c)     pthread_cond_init(c,NULL)
+#define v_cond_clear(c)    pthread_cond_destroy(c)
+#define v_wait(c,m)        pthread_cond_wait(c,m)
+#define v_signal(c)        pthread_cond_signal(c)
+#define v_broadcast(c)     pthread_cond_broadcast(c)
+
+#define v_thread_create(t,fn,arg) (pthread_create(t,NULL,fn,arg)!=0)
+#define v_thread_join(t)   pthread_join(t,NULL)
+
+#endif
+
+#endif
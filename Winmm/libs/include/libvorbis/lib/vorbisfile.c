@@ -20,6 +20,19 @@
 #include <errno.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
+
+#ifdef _WIN32
+#  include <windows.h>
+#  define OV_MMAP
+#elif defined(__unix__) || defined(__APPLE__)
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  define OV_MMAP
+#endif
 
 #include "vorbis/codec.h"
 
@@ -28,6 +41,9 @@
 #include "vorbis/vorbisfile.h"
 
 #include "os.h"
+#include "pcmpack.h"
+#include "synthpipe.h"
+#include "readahead.h"
 #include "misc.h"
 
 /* A 'chained bitstream' is a Vorbis bitstream that contains more than
@@ -64,7 +80,42 @@
 #define CHUNKSIZE 65536 /* greater-than-page-size granularity seeking */
 #define READSIZE 2048 /* a smaller read size is needed for low-rate streaming. */
 
+/* a file opened with ov_fopen_mmap; the sync buffer is the mapping
+   itself, so all of the file is always 'read' and seeking just moves
+   the framer's cursor */
+struct ov_mapping {
+  unsigned char *data;
+  long           bytes;
+  long           pos;
+};
+
+static void _map_sync(OggVorbis_File *vf){
+  vf->oy.data=vf->map->data;
+  vf->oy.storage=vf->oy.fill=vf->map->bytes;
+  vf->oy.returned=(int)vf->offset;
+  vf->oy.unsynced=0;
+  vf->oy.headerbytes=0;
+  vf->oy.bodybytes=0;
+}
+
+static void _index_free(struct ov_seekindex *ix);
+static int _open_lazy(OggVorbis_File *vf);
+
+static int arenas; /* see ov_arenas */
+
+/* until _arena_out, what this thread allocates comes from the
+   stream's arena if it has one.  The arena is passed rather than vf,
+   whose arena ov_clear may have taken away in between */
+static const ogg_allocator *_arena_in(ogg_pool *arena){
+  return arena?ogg_use_allocator(ogg_pool_allocator(arena)):NULL;
+}
+
+static void _arena_out(ogg_pool *arena,const ogg_allocator *prev){
+  if(arena)ogg_use_allocator(prev);
+}
+
 static long _get_data(OggVorbis_File *vf){
+  if(vf->map)return(0); /* nothing past the end of the mapping */
   errno=0;
   if(!(vf->callbacks.read_func))return(-1);
   if(vf->datasource){
@@ -79,6 +130,16 @@ static long _get_data(OggVorbis_File *vf){
 
 /* save a tiny smidge of verbosity to make the code more readable */
 static int _seek_helper(OggVorbis_File *vf,ogg_int64_t offset){
+  /* whatever the decode threads read ahead came from the old place */
+  if(vf->pipe)synthpipe_reset(vf->pipe);
+
+  if(vf->map){
+    if(offset<0 || offset>vf->map->bytes)return OV_EREAD;
+    vf->offset=offset;
+    _map_sync(vf);
+    return 0;
+  }
+
   if(vf->datasource){
     /* only seek if the file position isn't already there */
     if(vf->offset != offset){
@@ -596,16 +657,19 @@ static int _bisect_forward_serialno(OggVorbis_File *vf,
 }
 
 static int _make_decode_ready(OggVorbis_File *vf){
+  const ogg_allocator *prev;
   if(vf->ready_state>STREAMSET)return 0;
   if(vf->ready_state<STREAMSET)return OV_EFAULT;
-  if(vf->seekable){
-    if(vorbis_synthesis_init(&vf->vd,vf->vi+vf->current_link))
-      return OV_EBADLINK;
-  }else{
-    if(vorbis_synthesis_init(&vf->vd,vf->vi))
-      return OV_EBADLINK;
+  prev=_arena_in(vf->arena);
+  if(vorbis_synthesis_init(&vf->vd,vf->vi+(vf->seekable?vf->current_link:0))){
+    _arena_out(vf->arena,prev);
+    return OV_EBADLINK;
   }
   vorbis_block_init(&vf->vd,&vf->vb);
+  if(vf->chthreads)
+    vorbis_synthesis_threads(&vf->vd,vf->chthreads,vf->chchannels,
+                             vf->chblocksize);
+  _arena_out(vf->arena,prev);
   vf->ready_state=INITSET;
   vf->bittrack=0.f;
   vf->samptrack=0.f;
@@ -656,11 +720,130 @@ static int _open_seekable2(OggVorbis_File *vf){
 
 /* clear out the current logical bitstream decoder */
 static void _decode_clear(OggVorbis_File *vf){
+  if(vf->pipe)synthpipe_reset(vf->pipe);
   vorbis_dsp_clear(&vf->vd);
   vorbis_block_clear(&vf->vb);
   vf->ready_state=OPENED;
 }
 
+/* blocks a synthesized packet into the decode state, tracks bitrate
+   and updates the pcm offset.  return: 1) success, <0) error */
+static int _process_block(OggVorbis_File *vf,vorbis_block *vb,
+                          ogg_packet *op,int hs){
+  ogg_int64_t granulepos=op->granulepos;
+
+  /* suck in the synthesis data and track bitrate */
+  {
+    int oldsamples=vorbis_synthesis_pcmout(&vf->vd,NULL);
+    /* for proper use of libvorbis within libvorbisfile,
+       oldsamples will always be zero. */
+    if(oldsamples)return(OV_EFAULT);
+
+    vorbis_synthesis_blockin(&vf->vd,vb);
+    vf->samptrack+=(vorbis_synthesis_pcmout(&vf->vd,NULL)<<hs);
+    vf->bittrack+=op->bytes*8;
+  }
+
+  /* update the pcm offset. */
+  if(granulepos!=-1 && !op->e_o_s){
+    int link=(vf->seekable?vf->current_link:0);
+    int i,samples;
+
+    /* this packet has a pcm_offset on it (the last packet
+       completed on a page carries the offset) After processing
+       (above), we know the pcm position of the *last* sample
+       ready to be returned. Find the offset of the *first*
+
+       As an aside, this trick is inaccurate if we begin
+       reading anew right at the last page; the end-of-stream
+       granulepos declares the last frame in the stream, and the
+       last packet of the last page may be a partial frame.
+       So, we need a previous granulepos from an in-sequence page
+       to have a reference point.  Thus the !op->e_o_s clause
+       above */
+
+    if(vf->seekable && link>0)
+      granulepos-=vf->pcmlengths[link*2];
+    if(granulepos<0)granulepos=0; /* actually, this
+                                     shouldn't be possible
+                                     here unless the stream
+                                     is very broken */
+
+    samples=(vorbis_synthesis_pcmout(&vf->vd,NULL)<<hs);
+
+    granulepos-=samples;
+    for(i=0;i<link;i++)
+      granulepos+=vf->pcmlengths[i*2+1];
+    vf->pcm_offset=granulepos;
+  }
+  return(1);
+}
+
+/* keep the decode threads busy: queue packets from the stream state,
+   reading pages of the current link as needed.  A page starting the
+   next link is stashed for the page loop in
+   _fetch_and_process_packet to find once the queue has drained */
+static void _pipe_fill(OggVorbis_File *vf,int readp){
+  ogg_page og;
+
+  while(!synthpipe_full(vf->pipe)){
+    ogg_packet op;
+    int result=ogg_stream_packetout(&vf->os,&op);
+
+    if(result>0){
+      synthpipe_submit(vf->pipe,&op);
+      continue;
+    }
+    if(result<0){
+      synthpipe_submit(vf->pipe,NULL); /* hole in the data */
+      continue;
+    }
+
+    if(!readp || synthpipe_stashed(vf->pipe))return;
+    if(_get_next_page(vf,&og,-1)<0)return;
+
+    if(vf->current_serialno!=ogg_page_serialno(&og)){
+      if(ogg_page_bos(&og)){
+        synthpipe_stash(vf->pipe,&og);
+        return;
+      }
+      vf->bittrack+=og.header_len*8; /* another multiplexed stream */
+      continue;
+    }
+
+    vf->bittrack+=og.header_len*8;
+    ogg_stream_pagein(&vf->os,&og);
+  }
+}
+
+/* the threaded counterpart of pulling one packet out of the stream
+   state and synthesizing it.  return: 1) got a packet, 0) need more
+   data, OV_HOLE) lost packet, <0) error */
+static int _fetch_threaded(OggVorbis_File *vf,int readp,int hs){
+  while(1){
+    vorbis_block *vb;
+    ogg_packet *op;
+    int ret;
+
+    _pipe_fill(vf,readp);
+    switch(synthpipe_next(vf->pipe,&vb,&op,&ret)){
+    case 0:
+      return(0);
+    case -1:
+      return(OV_HOLE);
+    }
+
+    /* header packets are rejected by vorbis_synthesis; skip them as
+       below */
+    if(!ret){
+      ret=_process_block(vf,vb,op,hs);
+      synthpipe_release(vf->pipe);
+      return(ret);
+    }
+    synthpipe_release(vf->pipe);
+  }
+}
+
 /* fetch and process a packet.  Handles the case where we're at a
    bitstream boundary and dumps the decoding machine.  If the decoding
    machine is unloaded, it loads it.  It also keeps pcm_offset up to
@@ -672,10 +855,10 @@ static void _decode_clear(OggVorbis_File *vf){
             1) got a packet
 */
 
-static int _fetch_and_process_packet(OggVorbis_File *vf,
-                                     ogg_packet *op_in,
-                                     int readp,
-                                     int spanp){
+static int _fetch_and_process(OggVorbis_File *vf,
+                              ogg_packet *op_in,
+                              int readp,
+                              int spanp){
   ogg_page og;
 
   /* handle one packet.  Try to fetch it from current stream state */
@@ -692,74 +875,32 @@ static int _fetch_and_process_packet(OggVorbis_File *vf,
     if(vf->ready_state==INITSET){
       int hs=vorbis_synthesis_halfrate_p(vf->vi);
 
-      while(1) {
-              ogg_packet op;
-              ogg_packet *op_ptr=(op_in?op_in:&op);
-        int result=ogg_stream_packetout(&vf->os,op_ptr);
-        ogg_int64_t granulepos;
-
-        op_in=NULL;
-        if(result==-1)return(OV_HOLE); /* hole in the data. */
-        if(result>0){
-          /* got a packet.  process it */
-          granulepos=op_ptr->granulepos;
-          if(!vorbis_synthesis(&vf->vb,op_ptr)){ /* lazy check for lazy
-                                                    header handling.  The
-                                                    header packets aren't
-                                                    audio, so if/when we
-                                                    submit them,
-                                                    vorbis_synthesis will
-                                                    reject them */
-
-            /* suck in the synthesis data and track bitrate */
-            {
-              int oldsamples=vorbis_synthesis_pcmout(&vf->vd,NULL);
-              /* for proper use of libvorbis within libvorbisfile,
-                 oldsamples will always be zero. */
-              if(oldsamples)return(OV_EFAULT);
-
-              vorbis_synthesis_blockin(&vf->vd,&vf->vb);
-              vf->samptrack+=(vorbis_synthesis_pcmout(&vf->vd,NULL)<<hs);
-              vf->bittrack+=op_ptr->bytes*8;
-            }
-
-            /* update the pcm offset. */
-            if(granulepos!=-1 && !op_ptr->e_o_s){
-              int link=(vf->seekable?vf->current_link:0);
-              int i,samples;
-
-              /* this packet has a pcm_offset on it (the last packet
-                 completed on a page carries the offset) After processing
-                 (above), we know the pcm position of the *last* sample
-                 ready to be returned. Find the offset of the *first*
-
-                 As an aside, this trick is inaccurate if we begin
-                 reading anew right at the last page; the end-of-stream
-                 granulepos declares the last frame in the stream, and the
-                 last packet of the last page may be a partial frame.
-                 So, we need a previous granulepos from an in-sequence page
-                 to have a reference point.  Thus the !op_ptr->e_o_s clause
-                 above */
-
-              if(vf->seekable && link>0)
-                granulepos-=vf->pcmlengths[link*2];
-              if(granulepos<0)granulepos=0; /* actually, this
-                                               shouldn't be possible
-                                               here unless the stream
-                                               is very broken */
-
-              samples=(vorbis_synthesis_pcmout(&vf->vd,NULL)<<hs);
-
-              granulepos-=samples;
-              for(i=0;i<link;i++)
-                granulepos+=vf->pcmlengths[i*2+1];
-              vf->pcm_offset=granulepos;
+      if(vf->pipe && !op_in){
+        int ret=_fetch_threaded(vf,readp,hs);
+        if(ret)return(ret);
+      }else{
+        while(1){
+          ogg_packet op;
+          ogg_packet *op_ptr=(op_in?op_in:&op);
+          int result=ogg_stream_packetout(&vf->os,op_ptr);
+
+          op_in=NULL;
+          if(result==-1)return(OV_HOLE); /* hole in the data. */
+          if(result>0){
+            /* got a packet.  process it */
+            if(!vorbis_synthesis(&vf->vb,op_ptr)){ /* lazy check for lazy
+                                                      header handling.  The
+                                                      header packets aren't
+                                                      audio, so if/when we
+                                                      submit them,
+                                                      vorbis_synthesis will
+                                                      reject them */
+              return(_process_block(vf,&vf->vb,op_ptr,hs));
             }
-            return(1);
           }
+          else
+            break;
         }
-        else
-          break;
       }
     }
 
@@ -774,7 +915,8 @@ static int _fetch_and_process_packet(OggVorbis_File *vf,
            we get one with the correct serialno */
 
         if(!readp)return(0);
-        if((ret=_get_next_page(vf,&og,-1))<0){
+        if(!(vf->pipe && synthpipe_unstash(vf->pipe,&og)) &&
+           (ret=_get_next_page(vf,&og,-1))<0){
           return(OV_EOF); /* eof. leave unitialized */
         }
 
@@ -796,7 +938,7 @@ static int _fetch_and_process_packet(OggVorbis_File *vf,
 
               _decode_clear(vf);
 
-              if(!vf->seekable){
+              if(!vf->seekable && !vf->lazy){
                 vorbis_info_clear(vf->vi);
                 vorbis_comment_clear(vf->vc);
               }
@@ -827,6 +969,12 @@ static int _fetch_and_process_packet(OggVorbis_File *vf,
       int link;
 
       if(vf->ready_state<STREAMSET){
+        /* a fast open's first link is over; find the rest */
+        if(vf->lazy && _open_lazy(vf)){
+          vorbis_info_clear(vf->vi);
+          vorbis_comment_clear(vf->vc);
+        }
+
         if(vf->seekable){
           long serialno = ogg_page_serialno(&og);
 
@@ -867,6 +1015,17 @@ static int _fetch_and_process_packet(OggVorbis_File *vf,
   }
 }
 
+static int _fetch_and_process_packet(OggVorbis_File *vf,
+                                     ogg_packet *op_in,
+                                     int readp,
+                                     int spanp){
+  ogg_pool *arena=vf->arena;
+  const ogg_allocator *prev=_arena_in(arena);
+  int ret=_fetch_and_process(vf,op_in,readp,spanp);
+  _arena_out(arena,prev);
+  return ret;
+}
+
 /* if, eg, 64 bit stdio is configured by default, this will build with
    fseek64 */
 static int _fseek64_wrap(FILE *f,ogg_int64_t off,int whence){
@@ -874,8 +1033,91 @@ static int _fseek64_wrap(FILE *f,ogg_int64_t off,int whence){
   return fseek(f,off,whence);
 }
 
+#ifdef OV_MMAP
+/* the callbacks only serve the seekability test, the length probe and
+   closing; vorbisfile reads the mapping directly */
+static size_t _map_read(void *ptr,size_t size,size_t nmemb,void *datasource){
+  struct ov_mapping *m=datasource;
+  size_t bytes=size*nmemb;
+  if(!size)return 0;
+  if(bytes>(size_t)(m->bytes-m->pos))bytes=m->bytes-m->pos;
+  memcpy(ptr,m->data+m->pos,bytes);
+  m->pos+=bytes;
+  return bytes/size;
+}
+
+static int _map_seek(void *datasource,ogg_int64_t offset,int whence){
+  struct ov_mapping *m=datasource;
+  if(whence==SEEK_CUR)offset+=m->pos;
+  if(whence==SEEK_END)offset+=m->bytes;
+  if(offset<0 || offset>m->bytes)return -1;
+  m->pos=(long)offset;
+  return 0;
+}
+
+static long _map_tell(void *datasource){
+  return ((struct ov_mapping *)datasource)->pos;
+}
+
+static int _map_close(void *datasource){
+  struct ov_mapping *m=datasource;
+#ifdef _WIN32
+  UnmapViewOfFile(m->data);
+#else
+  munmap(m->data,m->bytes);
+#endif
+  _ogg_free(m);
+  return 0;
+}
+
+/* maps path read only; NULL if it can't be, or is too large for the
+   framer's int offsets */
+static struct ov_mapping *_map_open(const char *path){
+  struct ov_mapping *m;
+  void *data=NULL;
+  long bytes=0;
+#ifdef _WIN32
+  LARGE_INTEGER size;
+  HANDLE map;
+  HANDLE f=CreateFileA(path,GENERIC_READ,FILE_SHARE_READ,NULL,
+                       OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+  if(f==INVALID_HANDLE_VALUE)return NULL;
+  if(GetFileSizeEx(f,&size) && size.QuadPart>0 && size.QuadPart<INT_MAX){
+    bytes=(long)size.QuadPart;
+    map=CreateFileMapping(f,NULL,PAGE_READONLY,0,0,NULL);
+    if(map){
+      data=MapViewOfFile(map,FILE_MAP_READ,0,0,0);
+      CloseHandle(map);
+    }
+  }
+  CloseHandle(f);
+#else
+  struct stat st;
+  int fd=open(path,O_RDONLY);
+  if(fd<0)return NULL;
+  if(!fstat(fd,&st) && st.st_size>0 && st.st_size<INT_MAX){
+    bytes=(long)st.st_size;
+    data=mmap(NULL,bytes,PROT_READ,MAP_PRIVATE,fd,0);
+    if(data==MAP_FAILED)data=NULL;
+#ifdef MADV_SEQUENTIAL
+    if(data)madvise(data,bytes,MADV_SEQUENTIAL);
+#endif
+  }
+  close(fd);
+#endif
+  if(!data)return NULL;
+
+  m=_ogg_calloc(1,sizeof(*m));
+  m->data=data;
+  m->bytes=bytes;
+  return m;
+}
+#endif
+
+/* arena, if not NULL, is vf's from now on and the caller has it in
+   use */
 static int _ov_open1(void *f,OggVorbis_File *vf,const char *initial,
-                     long ibytes, ov_callbacks callbacks){
+                     long ibytes, ov_callbacks callbacks,ogg_pool *arena){
   int offsettest=((f && callbacks.seek_func)?callbacks.seek_func(f,0,SEEK_CUR):-1);
   long *serialno_list=NULL;
   int serialno_list_size=0;
@@ -884,9 +1126,16 @@ static int _ov_open1(void *f,OggVorbis_File *vf,const char *initial,
   memset(vf,0,sizeof(*vf));
   vf->datasource=f;
   vf->callbacks = callbacks;
+  vf->arena=arena;
 
   /* init the framing state */
   ogg_sync_init(&vf->oy);
+#ifdef OV_MMAP
+  if(callbacks.read_func==_map_read){
+    vf->map=f;
+    _map_sync(vf);
+  }
+#endif
 
   /* perhaps some data was previously read into a buffer for testing
      against other stream types.  Allow initialization from this
@@ -949,10 +1198,117 @@ static int _ov_open2(OggVorbis_File *vf){
   return 0;
 }
 
+/* does the scan ov_test_open_fast put off.  It reopens vf's own
+   datasource into a scratch OggVorbis_File from the start, puts the
+   read position back, and moves the link table it builds into vf
+   underneath the decoder, which carries on as if the file had been
+   opened seekable.  Streaming reaches no further than the end of the
+   first link before this is called.  If the scan fails vf stays a
+   stream.  The scan has no arena of its own; what it builds goes to
+   vf's. */
+static int _scan_lazy(OggVorbis_File *vf){
+  OggVorbis_File scan;
+  vorbis_info vi;
+  vorbis_comment vc;
+  long pos;
+  int i,ret;
+
+  vf->lazy=0;
+
+  pos=(vf->callbacks.tell_func)(vf->datasource);
+  ret=(vf->callbacks.seek_func)(vf->datasource,0,SEEK_SET);
+  if(!ret)ret=_ov_open1(vf->datasource,&scan,NULL,0,vf->callbacks,NULL);
+  if(!ret)ret=_ov_open2(&scan);
+  (vf->callbacks.seek_func)(vf->datasource,pos,SEEK_SET);
+  if(ret)return ret;
+
+  if(vf->current_serialno!=scan.serialnos[0]){
+    scan.datasource=NULL;
+    ov_clear(&scan);
+    return OV_EBADLINK;
+  }
+
+  if(vorbis_synthesis_halfrate_p(vf->vi))
+    for(i=0;i<scan.links;i++)
+      vorbis_synthesis_halfrate(scan.vi+i,1);
+
+  /* keep the decoder's first link headers where they are, for vd and
+     for whoever kept ov_info(vf,-1); between links nothing is using
+     them and the scan's go in their place */
+  if(vf->ready_state<STREAMSET){
+    vi=scan.vi[0];
+    vc=scan.vc[0];
+    scan.vi[0]=vf->vi[0];
+    scan.vc[0]=vf->vc[0];
+    vf->vi[0]=vi;
+    vf->vc[0]=vc;
+  }
+  vorbis_info_clear(scan.vi);
+  vorbis_comment_clear(scan.vc);
+
+  if(scan.links>1){
+    /* the links go in arrays of their own; the first link's old
+       vorbis_info and vorbis_comment stay where they are, sharing
+       what they point to with the new first entries, so vd and
+       whoever kept ov_info(vf,-1) or ov_comment(vf,-1) can go on
+       using them.  ov_clear frees them without clearing. */
+    vorbis_info *links_vi=_ogg_malloc(scan.links*sizeof(*links_vi));
+    vorbis_comment *links_vc=_ogg_malloc(scan.links*sizeof(*links_vc));
+    links_vi[0]=vf->vi[0];
+    links_vc[0]=vf->vc[0];
+    for(i=1;i<scan.links;i++){
+      links_vi[i]=scan.vi[i];
+      links_vc[i]=scan.vc[i];
+    }
+    vf->first_vi=vf->vi;
+    vf->first_vc=vf->vc;
+    vf->vi=links_vi;
+    vf->vc=links_vc;
+  }
+
+  _ogg_free(vf->offsets);
+  _ogg_free(vf->dataoffsets);
+  _ogg_free(vf->serialnos);
+  vf->links=scan.links;
+  vf->offsets=scan.offsets;
+  vf->dataoffsets=scan.dataoffsets;
+  vf->serialnos=scan.serialnos;
+  vf->pcmlengths=scan.pcmlengths;
+  vf->end=scan.end;
+  vf->seekable=1;
+
+  _ogg_free(scan.vi);
+  _ogg_free(scan.vc);
+  scan.links=0;
+  scan.vi=NULL;
+  scan.vc=NULL;
+  scan.offsets=NULL;
+  scan.dataoffsets=NULL;
+  scan.serialnos=NULL;
+  scan.pcmlengths=NULL;
+  scan.datasource=NULL;
+  ov_clear(&scan);
+  return 0;
+}
+
+static int _open_lazy(OggVorbis_File *vf){
+  ogg_pool *arena=vf->arena;
+  const ogg_allocator *prev;
+  int ret;
+
+  if(!vf->lazy)return 0;
+  prev=_arena_in(arena);
+  ret=_scan_lazy(vf);
+  _arena_out(arena,prev);
+  return ret;
+}
+
 
 /* clear out the OggVorbis_File struct */
 int ov_clear(OggVorbis_File *vf){
   if(vf){
+    ogg_pool *arena=vf->arena;
+    synthpipe_destroy(vf->pipe);
     vorbis_block_clear(&vf->vb);
     vorbis_dsp_clear(&vf->vd);
     ogg_stream_clear(&vf->os);
@@ -966,14 +1322,21 @@ int ov_clear(OggVorbis_File *vf){
       _ogg_free(vf->vi);
       _ogg_free(vf->vc);
     }
+    if(vf->first_vi)_ogg_free(vf->first_vi);
+    if(vf->first_vc)_ogg_free(vf->first_vc);
     if(vf->dataoffsets)_ogg_free(vf->dataoffsets);
     if(vf->pcmlengths)_ogg_free(vf->pcmlengths);
     if(vf->serialnos)_ogg_free(vf->serialnos);
     if(vf->offsets)_ogg_free(vf->offsets);
+    _index_free(vf->index);
+    if(vf->map)vf->oy.data=NULL; /* not ours to free */
     ogg_sync_clear(&vf->oy);
     if(vf->datasource && vf->callbacks.close_func)
       (vf->callbacks.close_func)(vf->datasource);
     memset(vf,0,sizeof(*vf));
+
+    /* anything of the stream's still out goes with it */
+    ogg_pool_destroy(arena);
   }
 #ifdef DEBUG_LEAKS
   _VDBG_dump();
@@ -991,9 +1354,12 @@ int ov_clear(OggVorbis_File *vf){
 
 int ov_open_callbacks(void *f,OggVorbis_File *vf,
     const char *initial,long ibytes,ov_callbacks callbacks){
-  int ret=_ov_open1(f,vf,initial,ibytes,callbacks);
-  if(ret)return ret;
-  return _ov_open2(vf);
+  ogg_pool *arena=arenas?ogg_pool_create(NULL):NULL;
+  const ogg_allocator *prev=_arena_in(arena);
+  int ret=_ov_open1(f,vf,initial,ibytes,callbacks,arena);
+  if(!ret)ret=_ov_open2(vf);
+  _arena_out(arena,prev);
+  return ret;
 }
 
 int ov_open(FILE *f,OggVorbis_File *vf,const char *initial,long ibytes){
@@ -1017,6 +1383,53 @@ int ov_fopen(const char *path,OggVorbis_File *vf){
   return ret;
 }
 
+/* as ov_fopen, but maps the file and frames pages straight out of the
+   mapping: no read calls and no copying into the sync buffer.  Falls
+   back to ov_fopen where the file can't be mapped. */
+int ov_fopen_mmap(const char *path,OggVorbis_File *vf){
+#ifdef OV_MMAP
+  ov_callbacks callbacks = {_map_read,_map_seek,_map_close,_map_tell};
+  struct ov_mapping *m=_map_open(path);
+  int ret;
+
+  if(m){
+    ret=ov_open_callbacks(m,vf,NULL,0,callbacks);
+    if(ret)_map_close(m);
+    return ret;
+  }
+#endif
+  return ov_fopen(path,vf);
+}
+
+/* as ov_fopen_mmap, but opened with ov_test_open_fast: for starting
+   playback as soon as the headers are in */
+int ov_fopen_fast(const char *path,OggVorbis_File *vf){
+  ov_callbacks callbacks = {
+    (size_t (*)(void *, size_t, size_t, void *))  fread,
+    (int (*)(void *, ogg_int64_t, int))              _fseek64_wrap,
+    (int (*)(void *))                             fclose,
+    (long (*)(void *))                            ftell
+  };
+  void *f=NULL;
+  int ret;
+
+#ifdef OV_MMAP
+  if((f=_map_open(path))){
+    callbacks.read_func=_map_read;
+    callbacks.seek_func=_map_seek;
+    callbacks.close_func=_map_close;
+    callbacks.tell_func=_map_tell;
+  }
+#endif
+  if(!f)f=fopen(path,"rb");
+  if(!f)return -1;
+
+  ret=ov_test_callbacks(f,vf,NULL,0,callbacks);
+  if(!ret)ret=ov_test_open_fast(vf);
+  if(ret)(callbacks.close_func)(f);
+  return ret;
+}
+
 
 /* cheap hack for game usage where downsampling is desirable; there's
    no need for SRC as we can just do it cheaply in libvorbis. */
@@ -1027,6 +1440,7 @@ int ov_halfrate(OggVorbis_File *vf,int flag){
   if(vf->ready_state>STREAMSET){
     /* clear out stream state; dumping the decode machine is needed to
        reinit the MDCT lookups. */
+    if(vf->pipe)synthpipe_reset(vf->pipe);
     vorbis_dsp_clear(&vf->vd);
     vorbis_block_clear(&vf->vb);
     vf->ready_state=STREAMSET;
@@ -1051,6 +1465,131 @@ int ov_halfrate_p(OggVorbis_File *vf){
   return vorbis_synthesis_halfrate_p(vf->vi);
 }
 
+/* for decoding faster than realtime on a multicore machine; packets
+   are synthesized ahead on threads workers while blocking in and
+   overlap-add stay in order on the caller's thread, so the output is
+   the same as without.  0 or 1 goes back to decoding serially; on an
+   unseekable stream that loses whatever was read ahead.  The raw
+   offset runs ahead of the audio by the packets read ahead. */
+
+int ov_threads(OggVorbis_File *vf,int threads){
+  const ogg_allocator *prev;
+  if(vf->ready_state<OPENED)return OV_EINVAL;
+
+  if(vf->pipe){
+    /* hand anything read ahead back by repositioning */
+    ogg_int64_t pos;
+    _open_lazy(vf);
+    pos=vf->pcm_offset;
+    synthpipe_destroy(vf->pipe);
+    vf->pipe=NULL;
+    if(vf->seekable && pos>=0)
+      ov_pcm_seek(vf,pos);
+  }
+  if(threads<2)return 0;
+
+  prev=_arena_in(vf->arena);
+  vf->pipe=synthpipe_create(&vf->vd,threads);
+  _arena_out(vf->arena,prev);
+  if(!vf->pipe)return OV_EIMPL;
+  return 0;
+}
+
+/* splits each packet's per channel work over threads threads instead;
+   for lower latency on many channel streams rather than throughput.
+   See vorbis_synthesis_threads for the other arguments.  Kept across
+   links. */
+
+int ov_channel_threads(OggVorbis_File *vf,int threads,int channels,
+                       long blocksize){
+  int ret=0;
+  if(vf->ready_state<OPENED)return OV_EINVAL;
+
+  vf->chthreads=threads<2?0:threads;
+  vf->chchannels=channels;
+  vf->chblocksize=blocksize;
+  if(vf->pipe)_open_lazy(vf);
+  if(vf->ready_state==INITSET){
+    const ogg_allocator *prev;
+    ogg_int64_t pos=-1;
+
+    /* decode threads may be inside the channel pool being replaced;
+       wait them out, dropping what they read ahead, and reposition
+       to read it again as ov_threads does */
+    if(vf->pipe){
+      pos=vf->pcm_offset;
+      synthpipe_reset(vf->pipe);
+    }
+
+    prev=_arena_in(vf->arena);
+    ret=vorbis_synthesis_threads(&vf->vd,threads,channels,blocksize);
+    _arena_out(vf->arena,prev);
+
+    if(vf->pipe && vf->seekable && pos>=0)
+      ov_pcm_seek(vf,pos);
+  }
+  if(ret)vf->chthreads=0;
+  return ret;
+}
+
+/* moves reading onto a thread keeping bytes of the file read ahead,
+   so the decoder isn't held up by a slow disk; bytes<=0 sizes it to
+   about four seconds at the first link's bitrate.  Call once open.
+   Mapped files never wait on a read, so there's nothing to gain for
+   them. OV_EIMPL where there are no threads. */
+
+#define READAHEAD_SECONDS 4
+#define READAHEAD_MIN     (64*1024)
+#define READAHEAD_MAX     (1024*1024)
+
+int ov_readahead(OggVorbis_File *vf,long bytes){
+  ov_callbacks callbacks = {readahead_read,readahead_seek,
+                            readahead_close,readahead_tell};
+  const ogg_allocator *prev;
+  readahead *r;
+
+  if(vf->ready_state<OPENED || !vf->datasource)return OV_EINVAL;
+  if(vf->map)return OV_EIMPL;
+  if(vf->callbacks.read_func==readahead_read)return 0;
+
+  if(bytes<=0){
+    vorbis_info *vi=vf->vi;
+    long rate=vi->bitrate_nominal;
+    if(rate<=0)rate=vi->bitrate_upper;
+    if(rate<=0)rate=vi->bitrate_lower;
+    bytes=rate>0?rate/8*READAHEAD_SECONDS:READAHEAD_MIN*4;
+    if(bytes<READAHEAD_MIN)bytes=READAHEAD_MIN;
+    if(bytes>READAHEAD_MAX)bytes=READAHEAD_MAX;
+  }
+
+  prev=_arena_in(vf->arena);
+  r=readahead_create(vf->datasource,vf->callbacks,bytes);
+  _arena_out(vf->arena,prev);
+  if(!r)return OV_EIMPL;
+  if(!vf->callbacks.seek_func)callbacks.seek_func=NULL;
+  if(!vf->callbacks.tell_func)callbacks.tell_func=NULL;
+  vf->datasource=r;
+  vf->callbacks=callbacks;
+  return 0;
+}
+
+/* reads since ov_readahead that were already read ahead, and ones
+   that had to wait for the disk */
+int ov_readahead_stats(OggVorbis_File *vf,long *hits,long *misses){
+  if(vf->callbacks.read_func!=readahead_read)return OV_EINVAL;
+  readahead_stats(vf->datasource,hits,misses);
+  return 0;
+}
+
+/* with on, each file opened from now on gets an arena of its own: what
+   opening and decoding it allocates comes from an ogg_pool that
+   ov_clear frees in one go, instead of from wherever ogg_set_allocator
+   points.  The setup cache stays outside. Set it before opening
+   anything; files already open keep what they have. */
+void ov_arenas(int on){
+  arenas=on;
+}
+
 /* Only partially open the vorbis file; test for Vorbisness, and load
    the headers for the first chain.  Do not seek (although test for
    seekability).  Use ov_test_open to finish opening the file, else
@@ -1063,7 +1602,11 @@ int ov_halfrate_p(OggVorbis_File *vf){
 int ov_test_callbacks(void *f,OggVorbis_File *vf,
     const char *initial,long ibytes,ov_callbacks callbacks)
 {
-  return _ov_open1(f,vf,initial,ibytes,callbacks);
+  ogg_pool *arena=arenas?ogg_pool_create(NULL):NULL;
+  const ogg_allocator *prev=_arena_in(arena);
+  int ret=_ov_open1(f,vf,initial,ibytes,callbacks,arena);
+  _arena_out(arena,prev);
+  return ret;
 }
 
 int ov_test(FILE *f,OggVorbis_File *vf,const char *initial,long ibytes){
@@ -1078,18 +1621,39 @@ int ov_test(FILE *f,OggVorbis_File *vf,const char *initial,long ibytes){
 }
 
 int ov_test_open(OggVorbis_File *vf){
+  ogg_pool *arena=vf->arena;
+  const ogg_allocator *prev;
+  int ret;
+  if(vf->ready_state!=PARTOPEN)return(OV_EINVAL);
+  prev=_arena_in(arena);
+  ret=_ov_open2(vf);
+  _arena_out(arena,prev);
+  return ret;
+}
+
+/* As ov_test_open, but a seekable file is not scanned for its links
+   and their lengths yet; it decodes as a stream would, straight from
+   the headers.  The scan happens the first time anything needs it (a
+   seek, a total, a given link's info) and decoding carries on where
+   it was.  ov_seekable still says yes. */
+
+int ov_test_open_fast(OggVorbis_File *vf){
   if(vf->ready_state!=PARTOPEN)return(OV_EINVAL);
-  return _ov_open2(vf);
+  vf->lazy=vf->seekable;
+  vf->seekable=0;
+  vf->ready_state=STREAMSET;
+  return 0;
 }
 
 /* How many logical bitstreams in this physical bitstream? */
 long ov_streams(OggVorbis_File *vf){
+  _open_lazy(vf);
   return vf->links;
 }
 
 /* Is the FILE * associated with vf seekable? */
 long ov_seekable(OggVorbis_File *vf){
-  return vf->seekable;
+  return vf->seekable || vf->lazy;
 }
 
 /* returns the bitrate for a given logical bitstream or the entire
@@ -1102,6 +1666,7 @@ long ov_seekable(OggVorbis_File *vf){
    vorbis_info structs */
 
 long ov_bitrate(OggVorbis_File *vf,int i){
+  _open_lazy(vf);
   if(vf->ready_state<OPENED)return(OV_EINVAL);
   if(i>=vf->links)return(OV_EINVAL);
   if(!vf->seekable && i!=0)return(ov_bitrate(vf,0));
@@ -1156,6 +1721,7 @@ long ov_bitrate_instant(OggVorbis_File *vf){
 
 /* Guess */
 long ov_serialnumber(OggVorbis_File *vf,int i){
+  if(i>=0)_open_lazy(vf);
   if(i>=vf->links)return(ov_serialnumber(vf,vf->links-1));
   if(!vf->seekable && i>=0)return(ov_serialnumber(vf,-1));
   if(i<0){
@@ -1171,6 +1737,7 @@ long ov_serialnumber(OggVorbis_File *vf,int i){
             or if stream is only partially open
 */
 ogg_int64_t ov_raw_total(OggVorbis_File *vf,int i){
+  _open_lazy(vf);
   if(vf->ready_state<OPENED)return(OV_EINVAL);
   if(!vf->seekable || i>=vf->links)return(OV_EINVAL);
   if(i<0){
@@ -1190,6 +1757,7 @@ ogg_int64_t ov_raw_total(OggVorbis_File *vf,int i){
             length) or only partially open
 */
 ogg_int64_t ov_pcm_total(OggVorbis_File *vf,int i){
+  _open_lazy(vf);
   if(vf->ready_state<OPENED)return(OV_EINVAL);
   if(!vf->seekable || i>=vf->links)return(OV_EINVAL);
   if(i<0){
@@ -1209,6 +1777,7 @@ ogg_int64_t ov_pcm_total(OggVorbis_File *vf,int i){
             length) or only partially open
 */
 double ov_time_total(OggVorbis_File *vf,int i){
+  _open_lazy(vf);
   if(vf->ready_state<OPENED)return(OV_EINVAL);
   if(!vf->seekable || i>=vf->links)return(OV_EINVAL);
   if(i<0){
@@ -1233,6 +1802,7 @@ int ov_raw_seek(OggVorbis_File *vf,ogg_int64_t pos){
   ogg_stream_state work_os;
   int ret;
 
+  _open_lazy(vf);
   if(vf->ready_state<OPENED)return(OV_EINVAL);
   if(!vf->seekable)
     return(OV_ENOSEEK); /* don't dump machine if we can't seek */
@@ -1250,6 +1820,7 @@ int ov_raw_seek(OggVorbis_File *vf,ogg_int64_t pos){
      let _fetch_and_process_packet deal with a potential bitstream
      boundary */
   vf->pcm_offset=-1;
+  if(vf->pipe)synthpipe_reset(vf->pipe);
   ogg_stream_reset_serialno(&vf->os,
                             vf->current_serialno); /* must set serialno */
   vorbis_synthesis_restart(&vf->vd);
@@ -1398,6 +1969,252 @@ int ov_raw_seek(OggVorbis_File *vf,ogg_int64_t pos){
   return OV_EBADLINK;
 }
 
+/* An optional seek index: the granulepos and raw offset of every
+   granule marked page of each link's Vorbis stream, in file order.
+   With it, ov_pcm_seek_page finds the page bisection would have
+   settled on with a binary search and reads just that page. */
+
+struct ov_seekindex {
+  long        *first; /* links+1 entries; link i is first[i]..first[i+1] */
+  ogg_int64_t *granule;
+  ogg_int64_t *offset;
+  long         entries;
+  long         storage;
+};
+
+static void _index_free(struct ov_seekindex *ix){
+  if(ix){
+    if(ix->first)_ogg_free(ix->first);
+    if(ix->granule)_ogg_free(ix->granule);
+    if(ix->offset)_ogg_free(ix->offset);
+    _ogg_free(ix);
+  }
+}
+
+static void _index_add(struct ov_seekindex *ix,ogg_int64_t granule,
+                       ogg_int64_t offset){
+  if(ix->entries==ix->storage){
+    ix->storage=ix->storage?ix->storage*2:256;
+    ix->granule=_ogg_realloc(ix->granule,ix->storage*sizeof(*ix->granule));
+    ix->offset=_ogg_realloc(ix->offset,ix->storage*sizeof(*ix->offset));
+  }
+  ix->granule[ix->entries]=granule;
+  ix->offset[ix->entries]=offset;
+  ix->entries++;
+}
+
+/* raw offset of the last indexed page in link with a granulepos
+   before target, -1 if there's none */
+static ogg_int64_t _index_find(struct ov_seekindex *ix,int link,
+                               ogg_int64_t target){
+  long lo=ix->first[link],hi=ix->first[link+1];
+  while(lo<hi){
+    long mid=lo+(hi-lo)/2;
+    if(ix->granule[mid]<target)
+      lo=mid+1;
+    else
+      hi=mid;
+  }
+  return lo>ix->first[link]?ix->offset[lo-1]:-1;
+}
+
+/* reads every page of the file once through a sync state of its own;
+   the decode position, and the datasource's, are left as they were */
+static int _index_scan(OggVorbis_File *vf,struct ov_seekindex *ix){
+  ogg_sync_state oy;
+  long pos=0;
+  int link,ret=0;
+
+  ogg_sync_init(&oy);
+  if(!vf->map)pos=(vf->callbacks.tell_func)(vf->datasource);
+
+  for(link=0;link<vf->links && !ret;link++){
+    ogg_int64_t offset=vf->dataoffsets[link];
+    ogg_int64_t end=vf->offsets[link+1];
+
+    ix->first[link]=ix->entries;
+    if(vf->map){
+      oy.data=vf->map->data;
+      oy.storage=oy.fill=vf->map->bytes;
+      oy.returned=(int)offset;
+      oy.unsynced=oy.headerbytes=oy.bodybytes=0;
+    }else{
+      ogg_sync_reset(&oy);
+      if((vf->callbacks.seek_func)(vf->datasource,offset,SEEK_SET)){
+        ret=OV_EREAD;
+        break;
+      }
+    }
+
+    while(offset<end){
+      ogg_page og;
+      long more=ogg_sync_pageseek(&oy,&og);
+
+      if(more<0){
+        offset-=more;
+      }else if(more==0){
+        char *buffer;
+        long bytes;
+
+        if(vf->map)break;
+        buffer=ogg_sync_buffer(&oy,CHUNKSIZE);
+        bytes=(vf->callbacks.read_func)(buffer,1,CHUNKSIZE,vf->datasource);
+        if(bytes<=0)break;
+        ogg_sync_wrote(&oy,bytes);
+      }else{
+        if(ogg_page_serialno(&og)==vf->serialnos[link] &&
+           ogg_page_granulepos(&og)!=-1)
+          _index_add(ix,ogg_page_granulepos(&og),offset);
+        offset+=more;
+      }
+    }
+  }
+  ix->first[vf->links]=ix->entries;
+
+  if(vf->map)
+    oy.data=NULL; /* not ours to free */
+  else if((vf->callbacks.seek_func)(vf->datasource,pos,SEEK_SET))
+    ret=OV_EREAD;
+  ogg_sync_clear(&oy);
+  return ret;
+}
+
+/* builds the seek index with a scan over the whole file, replacing any
+   index already loaded */
+int ov_seek_index(OggVorbis_File *vf){
+  struct ov_seekindex *ix;
+  int ret;
+
+  _open_lazy(vf);
+  if(vf->ready_state<OPENED)return(OV_EINVAL);
+  if(!vf->seekable)return(OV_ENOSEEK);
+
+  ix=_ogg_calloc(1,sizeof(*ix));
+  ix->first=_ogg_calloc(vf->links+1,sizeof(*ix->first));
+  ret=_index_scan(vf,ix);
+  if(ret){
+    _index_free(ix);
+    return ret;
+  }
+  _index_free(vf->index);
+  vf->index=ix;
+  return 0;
+}
+
+/* On disk, after "OVSI", everything is an LEB128 varint: a version,
+   the file length and link count, then per link its serialno, pcm
+   length and entry count, then its entries as granulepos and offset
+   deltas from the previous entry.  The granulepos delta carries its
+   sign in the low bit; a broken stream may go backwards.  The header
+   fields let a stale index, one for a file since rewritten, be told
+   apart and refused. */
+
+#define INDEX_VERSION 1
+
+/* v>=0; not every platform has ogg_uint64_t */
+static void _index_put(FILE *f,ogg_int64_t v){
+  while(v>=0x80){
+    putc((int)(v&0x7f)|0x80,f);
+    v>>=7;
+  }
+  putc((int)v,f);
+}
+
+static int _index_get(FILE *f,ogg_int64_t *v){
+  ogg_int64_t u=0;
+  int shift=0,c;
+  do{
+    if(shift>56 || (c=getc(f))==EOF)return -1;
+    u|=(ogg_int64_t)(c&0x7f)<<shift;
+    shift+=7;
+  }while(c&0x80);
+  *v=u;
+  return 0;
+}
+
+int ov_seek_index_save(OggVorbis_File *vf,const char *path){
+  struct ov_seekindex *ix=vf->index;
+  FILE *f;
+  int link,ret;
+
+  if(vf->ready_state<OPENED || !ix)return(OV_EINVAL);
+  if(!(f=fopen(path,"wb")))return(OV_EFAULT);
+
+  fwrite("OVSI",1,4,f);
+  _index_put(f,INDEX_VERSION);
+  _index_put(f,vf->end);
+  _index_put(f,vf->links);
+  for(link=0;link<vf->links;link++){
+    ogg_int64_t granule=0,offset=0;
+    long i;
+
+    _index_put(f,(ogg_int64_t)(vf->serialnos[link]&0xffffffffUL));
+    _index_put(f,vf->pcmlengths[link*2+1]);
+    _index_put(f,ix->first[link+1]-ix->first[link]);
+    for(i=ix->first[link];i<ix->first[link+1];i++){
+      ogg_int64_t d=ix->granule[i]-granule;
+      _index_put(f,d<0?(-d<<1)|1:d<<1);
+      _index_put(f,ix->offset[i]-offset);
+      granule=ix->granule[i];
+      offset=ix->offset[i];
+    }
+  }
+
+  ret=ferror(f);
+  if(fclose(f) || ret)return(OV_EFAULT);
+  return 0;
+}
+
+int ov_seek_index_load(OggVorbis_File *vf,const char *path){
+  struct ov_seekindex *ix;
+  ogg_int64_t v;
+  char magic[4];
+  FILE *f;
+  int link,ret=OV_EBADHEADER;
+
+  _open_lazy(vf);
+  if(vf->ready_state<OPENED)return(OV_EINVAL);
+  if(!vf->seekable)return(OV_ENOSEEK);
+  if(!(f=fopen(path,"rb")))return(OV_EREAD);
+
+  ix=_ogg_calloc(1,sizeof(*ix));
+  ix->first=_ogg_calloc(vf->links+1,sizeof(*ix->first));
+
+  if(fread(magic,1,4,f)!=4 || memcmp(magic,"OVSI",4))goto bail;
+  if(_index_get(f,&v) || v!=INDEX_VERSION)goto bail;
+  if(_index_get(f,&v) || v!=vf->end)goto bail;
+  if(_index_get(f,&v) || v!=vf->links)goto bail;
+
+  for(link=0;link<vf->links;link++){
+    ogg_int64_t granule=0,offset=0,count;
+
+    if(_index_get(f,&v) || v!=(ogg_int64_t)(vf->serialnos[link]&0xffffffffUL))goto bail;
+    if(_index_get(f,&v) || v!=vf->pcmlengths[link*2+1])goto bail;
+    if(_index_get(f,&count) || count>vf->end)goto bail;
+
+    ix->first[link]=ix->entries;
+    while(count--){
+      if(_index_get(f,&v))goto bail;
+      granule+=(v&1)?-(v>>1):v>>1;
+      if(_index_get(f,&v))goto bail;
+      offset+=v;
+      if(offset>=vf->end)goto bail;
+      _index_add(ix,granule,offset);
+    }
+  }
+  ix->first[vf->links]=ix->entries;
+
+  fclose(f);
+  _index_free(vf->index);
+  vf->index=ix;
+  return 0;
+
+ bail:
+  fclose(f);
+  _index_free(ix);
+  return ret;
+}
+
 /* Page granularity seek (faster than sample granularity because we
    don't do the last bit of decode to find a specific sample).
 
@@ -1407,8 +2224,10 @@ int ov_raw_seek(OggVorbis_File *vf,ogg_int64_t pos){
 int ov_pcm_seek_page(OggVorbis_File *vf,ogg_int64_t pos){
   int link=-1;
   ogg_int64_t result=0;
-  ogg_int64_t total=ov_pcm_total(vf,-1);
+  ogg_int64_t total;
 
+  _open_lazy(vf);
+  total=ov_pcm_total(vf,-1);
   if(vf->ready_state<OPENED)return(OV_EINVAL);
   if(!vf->seekable)return(OV_ENOSEEK);
 
@@ -1443,8 +2262,14 @@ int ov_pcm_seek_page(OggVorbis_File *vf,ogg_int64_t pos){
 
     ogg_page og;
 
+    /* the index already knows the answer bisection would find */
+    if(vf->index){
+      best=_index_find(vf->index,link,target);
+      if(best!=-1)begin=end;
+    }
+
     /* if we have only one page, there will be no bisection.  Grab the page here */
-    if(begin==end){
+    if(begin==end && best==-1){
       result=_seek_helper(vf,begin);
       if(result) goto seek_error;
 
@@ -1782,6 +2607,7 @@ int ov_time_seek(OggVorbis_File *vf,double seconds){
   ogg_int64_t pcm_total=0;
   double time_total=0.;
 
+  _open_lazy(vf);
   if(vf->ready_state<OPENED)return(OV_EINVAL);
   if(!vf->seekable)return(OV_ENOSEEK);
   if(seconds<0)return(OV_EINVAL);
@@ -1812,6 +2638,7 @@ int ov_time_seek_page(OggVorbis_File *vf,double seconds){
   ogg_int64_t pcm_total=0;
   double time_total=0.;
 
+  _open_lazy(vf);
   if(vf->ready_state<OPENED)return(OV_EINVAL);
   if(!vf->seekable)return(OV_ENOSEEK);
   if(seconds<0)return(OV_EINVAL);
@@ -1877,6 +2704,7 @@ double ov_time_tell(OggVorbis_File *vf){
     initialized */
 
 vorbis_info *ov_info(OggVorbis_File *vf,int link){
+  if(link>=0)_open_lazy(vf);
   if(vf->seekable){
     if(link<0)
       if(vf->ready_state>=STREAMSET)
@@ -1895,6 +2723,7 @@ vorbis_info *ov_info(OggVorbis_File *vf,int link){
 
 /* grr, strong typing, grr, no templates/inheritence, grr */
 vorbis_comment *ov_comment(OggVorbis_File *vf,int link){
+  if(link>=0)_open_lazy(vf);
   if(vf->seekable){
     if(link<0)
       if(vf->ready_state>=STREAMSET)
@@ -1911,13 +2740,6 @@ vorbis_comment *ov_comment(OggVorbis_File *vf,int link){
   }
 }
 
-static int host_is_big_endian() {
-  ogg_int32_t pattern = 0xfeedface; /* deadbeef */
-  unsigned char *bytewise = (unsigned char *)&pattern;
-  if (bytewise[0] == 0xfe) return 1;
-  return 0;
-}
-
 /* up to this point, everything could more or less hide the multiple
    logical bitstream nature of chaining from the toplevel application
    if the toplevel application didn't particularly care.  However, at
@@ -1957,8 +2779,6 @@ static int host_is_big_endian() {
 long ov_read_filter(OggVorbis_File *vf,char *buffer,int length,
                     int bigendianp,int word,int sgned,int *bitstream,
                     void (*filter)(float **pcm,long channels,long samples,void *filter_param),void *filter_param){
-  int i,j;
-  int host_endian = host_is_big_endian();
   int hs;
 
   float **pcm;
@@ -1989,7 +2809,6 @@ long ov_read_filter(OggVorbis_File *vf,char *buffer,int length,
 
     long channels=ov_info(vf,-1)->channels;
     long bytespersample=word * channels;
-    vorbis_fpu_control fpu;
     if(samples>length/bytespersample)samples=length/bytespersample;
 
     if(samples <= 0)
@@ -1999,88 +2818,8 @@ long ov_read_filter(OggVorbis_File *vf,char *buffer,int length,
     if(filter)
       filter(pcm,channels,samples,filter_param);
 
-    /* a tight loop to pack each size */
-    {
-      int val;
-      if(word==1){
-        int off=(sgned?0:128);
-        vorbis_fpu_setround(&fpu);
-        for(j=0;j<samples;j++)
-          for(i=0;i<channels;i++){
-            val=vorbis_ftoi(pcm[i][j]*128.f);
-            if(val>127)val=127;
-            else if(val<-128)val=-128;
-            *buffer++=val+off;
-          }
-        vorbis_fpu_restore(fpu);
-      }else{
-        int off=(sgned?0:32768);
-
-        if(host_endian==bigendianp){
-          if(sgned){
-
-            vorbis_fpu_setround(&fpu);
-            for(i=0;i<channels;i++) { /* It's faster in this order */
-              float *src=pcm[i];
-              short *dest=((short *)buffer)+i;
-              for(j=0;j<samples;j++) {
-                val=vorbis_ftoi(src[j]*32768.f);
-                if(val>32767)val=32767;
-                else if(val<-32768)val=-32768;
-                *dest=val;
-                dest+=channels;
-              }
-            }
-            vorbis_fpu_restore(fpu);
-
-          }else{
-
-            vorbis_fpu_setround(&fpu);
-            for(i=0;i<channels;i++) {
-              float *src=pcm[i];
-              short *dest=((short *)buffer)+i;
-              for(j=0;j<samples;j++) {
-                val=vorbis_ftoi(src[j]*32768.f);
-                if(val>32767)val=32767;
-                else if(val<-32768)val=-32768;
-                *dest=val+off;
-                dest+=channels;
-              }
-            }
-            vorbis_fpu_restore(fpu);
-
-          }
-        }else if(bigendianp){
-
-          vorbis_fpu_setround(&fpu);
-          for(j=0;j<samples;j++)
-            for(i=0;i<channels;i++){
-              val=vorbis_ftoi(pcm[i][j]*32768.f);
-              if(val>32767)val=32767;
-              else if(val<-32768)val=-32768;
-              val+=off;
-              *buffer++=(val>>8);
-              *buffer++=(val&0xff);
-            }
-          vorbis_fpu_restore(fpu);
-
-        }else{
-          int val;
-          vorbis_fpu_setround(&fpu);
-          for(j=0;j<samples;j++)
-            for(i=0;i<channels;i++){
-              val=vorbis_ftoi(pcm[i][j]*32768.f);
-              if(val>32767)val=32767;
-              else if(val<-32768)val=-32768;
-              val+=off;
-              *buffer++=(val&0xff);
-              *buffer++=(val>>8);
-                  }
-          vorbis_fpu_restore(fpu);
-
-        }
-      }
-    }
+    /* pack to the requested size, interleaved */
+    pcm_pack(buffer,pcm,channels,samples,bigendianp,word,sgned);
 
     vorbis_synthesis_read(&vf->vd,samples);
     hs=vorbis_synthesis_halfrate_p(vf->vi);
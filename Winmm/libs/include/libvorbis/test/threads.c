@@ -0,0 +1,204 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2015             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: ov_threads decode must match serial decode bit for bit
+
+ ********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define OV_EXCLUDE_STATIC_CALLBACKS
+#include <vorbis/vorbisfile.h>
+
+#include "util.h"
+#include "write_read.h"
+
+#define DATA_LEN        (44100*4)
+
+typedef struct {
+  unsigned char *data;
+  long           bytes;
+  long           storage;
+} output;
+
+static void out_add(output *o,const void *p,long bytes){
+  if(o->bytes+bytes>o->storage){
+    o->storage=(o->bytes+bytes)*2;
+    o->data=realloc(o->data,o->storage);
+    if(!o->data){
+      printf("\n\nError : out of memory\n");
+      exit(1);
+    }
+  }
+  memcpy(o->data+o->bytes,p,bytes);
+  o->bytes+=bytes;
+}
+
+/* reads a few buffers wherever the stream is now */
+static void read_some(OggVorbis_File *vf,output *o){
+  char buf[4096];
+  ogg_int64_t pos=ov_pcm_tell(vf);
+  int i,sec;
+
+  out_add(o,&pos,sizeof(pos));
+  for(i=0;i<3;i++){
+    long n=ov_read(vf,buf,sizeof(buf),0,2,1,&sec);
+    if(n<=0)break;
+    out_add(o,buf,n);
+  }
+}
+
+/* everything a decode produces: the whole stream as floats, then
+   what a series of seeks lands on. threads is switched on halfway
+   through the first pass when late is set. */
+static int decode(const char *filename,int threads,int late,output *o){
+  OggVorbis_File vf;
+  ogg_int64_t total,pos[7];
+  float **pcm;
+  long n,done=0;
+  int i,c,sec,ret=0;
+
+  if(ov_fopen(filename,&vf)){
+    printf("\n\nError : ov_fopen failed on %s\n",filename);
+    exit(1);
+  }
+  if(!late && threads>1)ret=ov_threads(&vf,threads);
+  if(ret)goto out;
+
+  total=ov_pcm_total(&vf,-1);
+  while((n=ov_read_float(&vf,&pcm,1024,&sec))>0){
+    for(c=0;c<ov_info(&vf,sec)->channels;c++)
+      out_add(o,pcm[c],n*sizeof(**pcm));
+    done+=n;
+    if(late && threads>1 && done>=total/2 && done-n<total/2){
+      ret=ov_threads(&vf,threads);
+      if(ret)goto out;
+    }
+  }
+
+  pos[0]=0;
+  pos[1]=total/3;
+  pos[2]=total/2;
+  pos[3]=total-5000;
+  pos[4]=12345;
+  pos[5]=total/7;
+  pos[6]=total-1;
+  for(i=0;i<7;i++){
+    if(ov_pcm_seek(&vf,pos[i])){
+      printf("\n\nError : ov_pcm_seek to %ld failed\n",(long)pos[i]);
+      exit(1);
+    }
+    read_some(&vf,o);
+  }
+
+  for(i=0;i<5;i++){
+    ov_time_seek(&vf,ov_time_total(&vf,-1)*i/5);
+    read_some(&vf,o);
+  }
+
+  ov_pcm_seek_page(&vf,total/2);
+  read_some(&vf,o);
+  ov_raw_seek(&vf,ov_raw_total(&vf,-1)/3);
+  read_some(&vf,o);
+
+ out:
+  ov_clear(&vf);
+  return ret;
+}
+
+static void gen_test_signal(float *data,int len){
+  unsigned long seed=1;
+  int i;
+
+  /* a sweep with some noise under it, so blocks switch sizes */
+  for(i=0;i<len;i++){
+    float t=(float)i/len;
+    seed=seed*1103515245UL+12345UL;
+    data[i]=.6f*sin(2*M_PI*(200.+2000.*t)*i/44100.)+
+      .2f*((float)((seed>>16)&0x7fff)/0x4000-1.f);
+    if((i/11025)%3==2)data[i]*=.05f;
+  }
+}
+
+int
+main(void){
+  static float data_out [DATA_LEN] ;
+  struct { int ch; int rate; float q; } files [] = {
+    { 2, 44100, .3 },
+    { 6, 22050, -.1 },
+    { 1, 8000, .9 },
+  } ;
+  int thread_counts [] = { 2, 3, 4 } ;
+  unsigned k, t ;
+  int errors = 0 ;
+
+  gen_test_signal (data_out, ARRAY_LEN (data_out));
+
+  printf("\nTesting ov_threads against serial decode\n\n");
+
+  for (k = 0 ; k < ARRAY_LEN (files) ; k++) {
+    char filename [64] ;
+    output serial = { NULL, 0, 0 } ;
+    int bad = 0 ;
+
+    snprintf (filename, sizeof (filename), "threads_%dch_%d.ogg",
+              files [k].ch, files [k].rate);
+    printf ("    %-22s : ", filename);
+    fflush (stdout);
+
+    write_vorbis_data_or_die (filename, files [k].rate, files [k].q,
+                              data_out, ARRAY_LEN (data_out), files [k].ch);
+    decode (filename, 1, 0, &serial);
+
+    for (t = 0 ; t < ARRAY_LEN (thread_counts) && !bad ; t++) {
+      int late ;
+      for (late = 0 ; late < 2 && !bad ; late++) {
+        output threaded = { NULL, 0, 0 } ;
+        int ret = decode (filename, thread_counts [t], late, &threaded);
+
+        if (ret == OV_EIMPL) {
+          free (threaded.data);
+          free (serial.data);
+          remove (filename);
+          puts ("no threads here, skipped");
+          return 0;
+        }
+        if (ret) {
+          printf ("Error : ov_threads(%d) returned %d\n", thread_counts [t], ret);
+          bad = 1;
+        } else if (threaded.bytes != serial.bytes ||
+                   memcmp (threaded.data, serial.data, serial.bytes)) {
+          printf ("Error : %d threads%s differ from serial decode\n",
+                  thread_counts [t], late ? " switched on midstream" : "");
+          bad = 1;
+        }
+        free (threaded.data);
+      }
+    }
+    free (serial.data);
+
+    if (bad)
+      errors ++ ;
+    else {
+      puts ("ok");
+      remove (filename);
+    }
+  }
+
+  if (errors)
+    exit (1);
+
+  return 0;
+}
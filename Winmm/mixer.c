@@ -0,0 +1,771 @@
+#include "stdafx.h"
+#include "mixer.h"
+#include "mixer_math.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MIX_STREAMS     16
+#define MIX_BUFFERS     4
+#define MIX_PERIOD_MS   20
+#define MIX_ONE         0x10000     // resampler phase, 16.16 fixed point
+#define MIX_BATCH       64
+
+HINSTANCE loadRealDLL();
+
+struct mix_stream
+{
+    int             used;
+    WAVEFORMATEX    fmt;
+    DWORD_PTR       callback;
+    DWORD_PTR       instance;
+    DWORD           type;                   // CALLBACK_* from waveOutOpen
+    int             paused;
+    DWORD           volume;
+    float           gain[2];
+
+    WAVEHDR         *head;                  // oldest header not yet returned
+    WAVEHDR         *tail;
+    WAVEHDR         *cur;                   // header being read
+    DWORD           cur_off;
+
+    // running byte offsets since open or reset, every header remembers
+    // where it ends in ->reserved
+    DWORD           queued;
+    DWORD           consumed;
+    DWORD           played;
+    DWORD           mark[MIX_BUFFERS];      // consumed when each output buffer was filled
+
+    uint32_t        step;
+    uint32_t        phase;
+    float           prev[2];
+    float           next[2];
+};
+
+// a returned header, notified once the lock is dropped
+struct mix_done
+{
+    HWAVEOUT        hwo;
+    DWORD           type;
+    DWORD_PTR       callback;
+    DWORD_PTR       instance;
+    WAVEHDR         *hdr;
+};
+
+static struct
+{
+    MMRESULT(WINAPI *open)(LPHWAVEOUT, UINT, LPCWAVEFORMATEX, DWORD_PTR, DWORD_PTR, DWORD);
+    MMRESULT(WINAPI *prepare)(HWAVEOUT, LPWAVEHDR, UINT);
+    MMRESULT(WINAPI *write)(HWAVEOUT, LPWAVEHDR, UINT);
+    MMRESULT(WINAPI *position)(HWAVEOUT, LPMMTIME, UINT);
+    MMRESULT(WINAPI *getid)(HWAVEOUT, LPUINT);
+    MMRESULT(WINAPI *reset)(HWAVEOUT);
+    MMRESULT(WINAPI *unprepare)(HWAVEOUT, LPWAVEHDR, UINT);
+    MMRESULT(WINAPI *close)(HWAVEOUT);
+} real;
+
+static int                  mix_on          = 0;
+static int                  mix_running     = 0;
+static volatile LONG        mix_quit        = 0;
+static int                  mix_sse2        = 0;
+static DWORD                mix_rate        = 44100;
+static DWORD                mix_frames      = 0;    // per output buffer
+static HWAVEOUT             mix_hwo         = NULL;
+static HANDLE               mix_ev          = NULL;
+static HANDLE               mix_thread      = NULL;
+static WAVEHDR              mix_out[MIX_BUFFERS];
+static int                  mix_next        = 0;    // oldest buffer still with the device
+static DWORD                mix_done_frames = 0;
+static float                *mix_acc        = NULL;
+static float                *mix_tmp        = NULL;
+static struct mix_stream    mix_streams[MIX_STREAMS];
+static CRITICAL_SECTION     mix_cs;
+
+void mix_init(int enabled, int rate)
+{
+    InitializeCriticalSection(&mix_cs);
+
+    if (rate < 8000 || rate > 192000)
+        rate = 44100;
+
+    mix_on = enabled;
+    mix_rate = rate;
+
+#if defined(_M_X64)
+    mix_sse2 = 1;
+#elif defined(MIX_SIMD)
+    mix_sse2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+#endif
+}
+
+int mix_owns(HWAVEOUT hwo)
+{
+    struct mix_stream *s = (struct mix_stream *)hwo;
+    return s >= mix_streams && s < mix_streams + MIX_STREAMS;
+}
+
+// The open stream behind a handle, NULL for anything the game made up or
+// already closed. Caller holds mix_cs
+static struct mix_stream *mix_lookup(HWAVEOUT hwo)
+{
+    struct mix_stream *s = (struct mix_stream *)hwo;
+
+    if (!mix_owns(hwo) || ((BYTE *)s - (BYTE *)mix_streams) % sizeof *s)
+        return NULL;
+
+    return s->used ? s : NULL;
+}
+
+static int mix_supports(LPCWAVEFORMATEX fmt)
+{
+    if (!fmt || fmt->wFormatTag != WAVE_FORMAT_PCM)
+        return 0;
+
+    if (fmt->nChannels < 1 || fmt->nChannels > 2)
+        return 0;
+
+    if (fmt->wBitsPerSample != 8 && fmt->wBitsPerSample != 16)
+        return 0;
+
+    if (fmt->nBlockAlign != fmt->nChannels * fmt->wBitsPerSample / 8)
+        return 0;
+
+    return fmt->nSamplesPerSec >= 1000 && fmt->nSamplesPerSec <= 192000;
+}
+
+static void mix_notify(HWAVEOUT hwo, DWORD type, DWORD_PTR callback, DWORD_PTR instance, UINT msg, DWORD_PTR param)
+{
+    if (type == CALLBACK_FUNCTION && callback)
+        ((LPWAVECALLBACK)callback)((HDRVR)hwo, msg, instance, param, 0);
+
+    if (type == CALLBACK_WINDOW && callback)
+        PostMessage((HWND)callback, msg, (WPARAM)hwo, (LPARAM)param);
+
+    if (type == CALLBACK_THREAD && callback)
+        PostThreadMessage((DWORD)callback, msg, (WPARAM)hwo, (LPARAM)param);
+
+    if (type == CALLBACK_EVENT && callback)
+        SetEvent((HANDLE)callback);
+}
+
+static void mix_notify_done(struct mix_done *done, int count)
+{
+    int i;
+    for (i = 0; i < count; i++)
+        mix_notify(done[i].hwo, done[i].type, done[i].callback, done[i].instance, WOM_DONE, (DWORD_PTR)done[i].hdr);
+}
+
+// Pops headers off the front of the queue, either the ones fully played
+// or everything on reset. Returns how many landed in done.
+static int mix_collect(struct mix_stream *s, int all, struct mix_done *done, int room)
+{
+    int count = 0;
+
+    while (s->head && count < room)
+    {
+        WAVEHDR *hdr = s->head;
+
+        if (!all && (LONG)(s->played - (DWORD)hdr->reserved) < 0)
+            break;
+
+        s->head = hdr->lpNext;
+        if (!s->head)
+            s->tail = NULL;
+
+        hdr->dwFlags = (hdr->dwFlags & ~WHDR_INQUEUE) | WHDR_DONE;
+
+        done[count].hwo = (HWAVEOUT)s;
+        done[count].type = s->type;
+        done[count].callback = s->callback;
+        done[count].instance = s->instance;
+        done[count].hdr = hdr;
+        count++;
+    }
+
+    return count;
+}
+
+// Steps over headers that have no whole frame left to read
+static void mix_skip(struct mix_stream *s)
+{
+    while (s->cur && s->cur_off + s->fmt.nBlockAlign > s->cur->dwBufferLength)
+    {
+        s->consumed += s->cur->dwBufferLength - s->cur_off;
+        s->cur = s->cur->lpNext;
+        s->cur_off = 0;
+    }
+}
+
+static int mix_fetch(struct mix_stream *s, float *frame)
+{
+    mix_skip(s);
+
+    if (!s->cur)
+        return 0;
+
+    const BYTE *p = (const BYTE *)s->cur->lpData + s->cur_off;
+
+    if (s->fmt.wBitsPerSample == 16)
+    {
+        frame[0] = ((const short *)p)[0];
+        frame[1] = s->fmt.nChannels == 2 ? ((const short *)p)[1] : frame[0];
+    }
+    else
+    {
+        frame[0] = (p[0] - 128) * 256.0f;
+        frame[1] = s->fmt.nChannels == 2 ? (p[1] - 128) * 256.0f : frame[0];
+    }
+
+    s->cur_off += s->fmt.nBlockAlign;
+    s->consumed += s->fmt.nBlockAlign;
+    mix_skip(s);
+
+    return 1;
+}
+
+// Linear interpolation to the output rate, stereo float out. Stops early
+// when the game runs dry; the rest of the period stays silent for it.
+static int mix_render(struct mix_stream *s, float *out, int frames)
+{
+    int i;
+
+    for (i = 0; i < frames; i++)
+    {
+        while (s->phase >= MIX_ONE)
+        {
+            float f[2];
+
+            if (!mix_fetch(s, f))
+                return i;
+
+            s->prev[0] = s->next[0];
+            s->prev[1] = s->next[1];
+            s->next[0] = f[0];
+            s->next[1] = f[1];
+            s->phase -= MIX_ONE;
+        }
+
+        float t = s->phase * (1.0f / MIX_ONE);
+        out[i * 2]     = s->prev[0] + (s->next[0] - s->prev[0]) * t;
+        out[i * 2 + 1] = s->prev[1] + (s->next[1] - s->prev[1]) * t;
+
+        s->phase += s->step;
+    }
+
+    return frames;
+}
+
+// Caller holds mix_cs
+static void mix_fill(int k)
+{
+    int i;
+
+    memset(mix_acc, 0, mix_frames * 2 * sizeof(float));
+
+    for (i = 0; i < MIX_STREAMS; i++)
+    {
+        struct mix_stream *s = &mix_streams[i];
+
+        if (!s->used)
+            continue;
+
+        if (!s->paused)
+        {
+            int n = mix_render(s, mix_tmp, mix_frames);
+            mix_accumulate(mix_acc, mix_tmp, s->gain, n);
+        }
+
+        s->mark[k] = s->consumed;
+    }
+
+    mix_pack((short *)mix_out[k].lpData, mix_acc, mix_frames * 2, mix_sse2);
+}
+
+// Output buffer k finished playing: everything mixed into it is now
+// audible, so the headers it drained can go back to their owners.
+static void mix_complete(int k)
+{
+    struct mix_done done[MIX_BATCH];
+    int i, count;
+
+    EnterCriticalSection(&mix_cs);
+    mix_done_frames += mix_frames;
+    mix_next = (k + 1) % MIX_BUFFERS;
+    for (i = 0; i < MIX_STREAMS; i++)
+    {
+        if (mix_streams[i].used)
+            mix_streams[i].played = mix_streams[i].mark[k];
+    }
+    LeaveCriticalSection(&mix_cs);
+
+    do
+    {
+        count = 0;
+
+        EnterCriticalSection(&mix_cs);
+        for (i = 0; i < MIX_STREAMS && count < MIX_BATCH; i++)
+        {
+            if (mix_streams[i].used)
+                count += mix_collect(&mix_streams[i], 0, done + count, MIX_BATCH - count);
+        }
+        LeaveCriticalSection(&mix_cs);
+
+        mix_notify_done(done, count);
+    } while (count == MIX_BATCH);
+}
+
+static int mix_main()
+{
+    while (!mix_quit)
+    {
+        WaitForSingleObject(mix_ev, INFINITE);
+
+        while (!mix_quit && (mix_out[mix_next].dwFlags & WHDR_DONE))
+        {
+            int k = mix_next;
+
+            mix_complete(k);
+
+            EnterCriticalSection(&mix_cs);
+            mix_fill(k);
+            LeaveCriticalSection(&mix_cs);
+
+            real.write(mix_hwo, &mix_out[k], sizeof(WAVEHDR));
+        }
+    }
+
+    return 0;
+}
+
+// Caller holds mix_cs
+static int mix_start()
+{
+    HINSTANCE dll = loadRealDLL();
+    WAVEFORMATEX fmt;
+    int i;
+
+    real.open       = (void*)GetProcAddress(dll, "waveOutOpen");
+    real.prepare    = (void*)GetProcAddress(dll, "waveOutPrepareHeader");
+    real.write      = (void*)GetProcAddress(dll, "waveOutWrite");
+    real.position   = (void*)GetProcAddress(dll, "waveOutGetPosition");
+    real.getid      = (void*)GetProcAddress(dll, "waveOutGetID");
+    real.reset      = (void*)GetProcAddress(dll, "waveOutReset");
+    real.unprepare  = (void*)GetProcAddress(dll, "waveOutUnprepareHeader");
+    real.close      = (void*)GetProcAddress(dll, "waveOutClose");
+
+    if (!real.open || !real.prepare || !real.write || !real.position || !real.getid ||
+        !real.reset || !real.unprepare || !real.close)
+        return 0;
+
+    fmt.wFormatTag      = WAVE_FORMAT_PCM;
+    fmt.nChannels       = 2;
+    fmt.nSamplesPerSec  = mix_rate;
+    fmt.wBitsPerSample  = 16;
+    fmt.nBlockAlign     = 4;
+    fmt.nAvgBytesPerSec = fmt.nBlockAlign * fmt.nSamplesPerSec;
+    fmt.cbSize          = 0;
+
+    mix_frames = mix_rate * MIX_PERIOD_MS / 1000;
+    mix_acc = malloc(mix_frames * 2 * sizeof(float));
+    mix_tmp = malloc(mix_frames * 2 * sizeof(float));
+    mix_ev = CreateEvent(NULL, 0, 0, NULL);
+
+    if (!mix_acc || !mix_tmp || !mix_ev)
+        return 0;
+
+    if (real.open(&mix_hwo, WAVE_MAPPER, &fmt, (DWORD_PTR)mix_ev, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR)
+        return 0;
+
+    for (i = 0; i < MIX_BUFFERS; i++)
+    {
+        memset(&mix_out[i], 0, sizeof(WAVEHDR));
+        mix_out[i].dwBufferLength = mix_frames * 4;
+        mix_out[i].lpData = calloc(mix_frames, 4);
+        real.prepare(mix_hwo, &mix_out[i], sizeof(WAVEHDR));
+        real.write(mix_hwo, &mix_out[i], sizeof(WAVEHDR));
+    }
+
+    mix_thread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)mix_main, NULL, 0, NULL);
+    SetThreadPriority(mix_thread, THREAD_PRIORITY_HIGHEST);
+
+    mix_running = 1;
+    return 1;
+}
+
+int mix_claims(LPCWAVEFORMATEX fmt, DWORD flags)
+{
+    if (!mix_on || !mix_supports(fmt))
+        return 0;
+
+    // a query only asks whether the format would be taken, the device
+    // is opened by the first real open
+    if (flags & WAVE_FORMAT_QUERY)
+        return 1;
+
+    EnterCriticalSection(&mix_cs);
+    // if the device can't be had, give up and let everything through
+    if (!mix_running && !mix_start())
+        mix_on = 0;
+    LeaveCriticalSection(&mix_cs);
+
+    return mix_on;
+}
+
+// Stops the mixer thread and gives the real device back. Whatever the game
+// still has queued is returned and its streams are closed, any later call
+// on them fails with MMSYSERR_INVALHANDLE. Our own tracks must already be
+// closed.
+void mix_shutdown(void)
+{
+    struct mix_done done[MIX_BATCH];
+    int i, count;
+
+    EnterCriticalSection(&mix_cs);
+    if (!mix_running)
+    {
+        LeaveCriticalSection(&mix_cs);
+        return;
+    }
+    LeaveCriticalSection(&mix_cs);
+
+    InterlockedExchange(&mix_quit, 1);
+    SetEvent(mix_ev);
+    WaitForSingleObject(mix_thread, INFINITE);
+    CloseHandle(mix_thread);
+    mix_thread = NULL;
+
+    real.reset(mix_hwo);
+    for (i = 0; i < MIX_BUFFERS; i++)
+    {
+        real.unprepare(mix_hwo, &mix_out[i], sizeof(WAVEHDR));
+        free(mix_out[i].lpData);
+        mix_out[i].lpData = NULL;
+    }
+    real.close(mix_hwo);
+    mix_hwo = NULL;
+
+    do
+    {
+        count = 0;
+
+        EnterCriticalSection(&mix_cs);
+        for (i = 0; i < MIX_STREAMS && count < MIX_BATCH; i++)
+        {
+            if (mix_streams[i].used)
+                count += mix_collect(&mix_streams[i], 1, done + count, MIX_BATCH - count);
+        }
+        LeaveCriticalSection(&mix_cs);
+
+        mix_notify_done(done, count);
+    } while (count == MIX_BATCH);
+
+    for (i = 0; i < MIX_STREAMS; i++)
+        mix_waveOutClose((HWAVEOUT)&mix_streams[i]);
+
+    EnterCriticalSection(&mix_cs);
+    free(mix_acc);
+    free(mix_tmp);
+    mix_acc = mix_tmp = NULL;
+    CloseHandle(mix_ev);
+    mix_ev = NULL;
+    mix_next = 0;
+    mix_done_frames = 0;
+    mix_running = 0;
+    InterlockedExchange(&mix_quit, 0);
+    LeaveCriticalSection(&mix_cs);
+}
+
+static void mix_rewind(struct mix_stream *s)
+{
+    s->cur = NULL;
+    s->cur_off = 0;
+    s->queued = 0;
+    s->consumed = 0;
+    s->played = 0;
+    memset(s->mark, 0, sizeof s->mark);
+
+    // prime two frames before the first output sample
+    s->phase = 2 * MIX_ONE;
+    s->prev[0] = s->prev[1] = 0;
+    s->next[0] = s->next[1] = 0;
+}
+
+MMRESULT WINAPI mix_waveOutOpen(LPHWAVEOUT phwo, UINT id, LPCWAVEFORMATEX fmt, DWORD_PTR callback, DWORD_PTR instance, DWORD flags)
+{
+    struct mix_stream *s = NULL;
+    int i;
+
+    if (!mix_supports(fmt))
+        return WAVERR_BADFORMAT;
+
+    if (flags & WAVE_FORMAT_QUERY)
+        return MMSYSERR_NOERROR;
+
+    EnterCriticalSection(&mix_cs);
+    for (i = 0; i < MIX_STREAMS; i++)
+    {
+        if (!mix_streams[i].used)
+        {
+            s = &mix_streams[i];
+            break;
+        }
+    }
+
+    if (s)
+    {
+        memset(s, 0, sizeof *s);
+        s->used = 1;
+        s->fmt = *fmt;
+        s->fmt.cbSize = 0;
+        s->callback = callback;
+        s->instance = instance;
+        s->type = flags & CALLBACK_TYPEMASK;
+        s->volume = 0xFFFFFFFF;
+        s->gain[0] = s->gain[1] = 1.0f;
+        s->step = (uint32_t)(((uint64_t)fmt->nSamplesPerSec << 16) / mix_rate);
+        mix_rewind(s);
+    }
+    LeaveCriticalSection(&mix_cs);
+
+    if (!s)
+        return MMSYSERR_ALLOCATED;
+
+    *phwo = (HWAVEOUT)s;
+    mix_notify((HWAVEOUT)s, s->type, callback, instance, WOM_OPEN, 0);
+
+    return MMSYSERR_NOERROR;
+}
+
+MMRESULT WINAPI mix_waveOutClose(HWAVEOUT hwo)
+{
+    struct mix_stream *s;
+    DWORD type;
+    DWORD_PTR callback, instance;
+
+    EnterCriticalSection(&mix_cs);
+    if (!(s = mix_lookup(hwo)))
+    {
+        LeaveCriticalSection(&mix_cs);
+        return MMSYSERR_INVALHANDLE;
+    }
+    if (s->head)
+    {
+        LeaveCriticalSection(&mix_cs);
+        return WAVERR_STILLPLAYING;
+    }
+    type = s->type;
+    callback = s->callback;
+    instance = s->instance;
+    s->used = 0;
+    LeaveCriticalSection(&mix_cs);
+
+    mix_notify(hwo, type, callback, instance, WOM_CLOSE, 0);
+
+    return MMSYSERR_NOERROR;
+}
+
+MMRESULT WINAPI mix_waveOutPrepareHeader(HWAVEOUT hwo, LPWAVEHDR hdr, UINT size)
+{
+    if (!hdr || size < sizeof(WAVEHDR))
+        return MMSYSERR_INVALPARAM;
+
+    hdr->dwFlags |= WHDR_PREPARED;
+    return MMSYSERR_NOERROR;
+}
+
+MMRESULT WINAPI mix_waveOutUnprepareHeader(HWAVEOUT hwo, LPWAVEHDR hdr, UINT size)
+{
+    if (!hdr || size < sizeof(WAVEHDR))
+        return MMSYSERR_INVALPARAM;
+
+    if (hdr->dwFlags & WHDR_INQUEUE)
+        return WAVERR_STILLPLAYING;
+
+    hdr->dwFlags &= ~WHDR_PREPARED;
+    return MMSYSERR_NOERROR;
+}
+
+MMRESULT WINAPI mix_waveOutWrite(HWAVEOUT hwo, LPWAVEHDR hdr, UINT size)
+{
+    struct mix_stream *s;
+
+    if (!hdr || size < sizeof(WAVEHDR))
+        return MMSYSERR_INVALPARAM;
+
+    if (!(hdr->dwFlags & WHDR_PREPARED))
+        return WAVERR_UNPREPARED;
+
+    if (hdr->dwFlags & WHDR_INQUEUE)
+        return WAVERR_STILLPLAYING;
+
+    EnterCriticalSection(&mix_cs);
+    if (!(s = mix_lookup(hwo)))
+    {
+        LeaveCriticalSection(&mix_cs);
+        return MMSYSERR_INVALHANDLE;
+    }
+    hdr->dwFlags = (hdr->dwFlags & ~WHDR_DONE) | WHDR_INQUEUE;
+    hdr->lpNext = NULL;
+    s->queued += hdr->dwBufferLength;
+    hdr->reserved = s->queued;
+
+    if (s->tail)
+        s->tail->lpNext = hdr;
+    else
+        s->head = hdr;
+    s->tail = hdr;
+
+    if (!s->cur)
+    {
+        s->cur = hdr;
+        s->cur_off = 0;
+        mix_skip(s);
+    }
+    LeaveCriticalSection(&mix_cs);
+
+    return MMSYSERR_NOERROR;
+}
+
+static MMRESULT mix_set_paused(HWAVEOUT hwo, int paused)
+{
+    struct mix_stream *s;
+
+    EnterCriticalSection(&mix_cs);
+    if ((s = mix_lookup(hwo)))
+        s->paused = paused;
+    LeaveCriticalSection(&mix_cs);
+
+    return s ? MMSYSERR_NOERROR : MMSYSERR_INVALHANDLE;
+}
+
+MMRESULT WINAPI mix_waveOutPause(HWAVEOUT hwo)
+{
+    return mix_set_paused(hwo, 1);
+}
+
+MMRESULT WINAPI mix_waveOutRestart(HWAVEOUT hwo)
+{
+    return mix_set_paused(hwo, 0);
+}
+
+MMRESULT WINAPI mix_waveOutReset(HWAVEOUT hwo)
+{
+    struct mix_stream *s;
+    struct mix_done done[MIX_BATCH];
+    int count;
+
+    do
+    {
+        EnterCriticalSection(&mix_cs);
+        if (!(s = mix_lookup(hwo)))
+        {
+            LeaveCriticalSection(&mix_cs);
+            return MMSYSERR_INVALHANDLE;
+        }
+        count = mix_collect(s, 1, done, MIX_BATCH);
+        if (!s->head)
+            mix_rewind(s);
+        LeaveCriticalSection(&mix_cs);
+
+        mix_notify_done(done, count);
+    } while (count == MIX_BATCH);
+
+    return MMSYSERR_NOERROR;
+}
+
+MMRESULT WINAPI mix_waveOutBreakLoop(HWAVEOUT hwo)
+{
+    return MMSYSERR_NOERROR;
+}
+
+// Bytes audible so far, interpolated across the buffer the device is
+// playing right now so games polling for sync don't see 20ms steps.
+static DWORD mix_position(struct mix_stream *s)
+{
+    DWORD pos = s->played;
+    MMTIME t;
+
+    t.wType = TIME_SAMPLES;
+    if (real.position(mix_hwo, &t, sizeof t) == MMSYSERR_NOERROR && t.wType == TIME_SAMPLES)
+    {
+        LONG elapsed = (LONG)(t.u.sample - mix_done_frames);
+
+        if (elapsed > (LONG)mix_frames)
+            elapsed = mix_frames;
+
+        if (elapsed > 0)
+            pos += (DWORD)((uint64_t)(s->mark[mix_next] - s->played) * elapsed / mix_frames);
+    }
+
+    return pos - pos % s->fmt.nBlockAlign;
+}
+
+MMRESULT WINAPI mix_waveOutGetPosition(HWAVEOUT hwo, LPMMTIME mmt, UINT size)
+{
+    struct mix_stream *s;
+    DWORD bytes;
+
+    if (!mmt || size < sizeof(MMTIME))
+        return MMSYSERR_INVALPARAM;
+
+    EnterCriticalSection(&mix_cs);
+    if (!(s = mix_lookup(hwo)))
+    {
+        LeaveCriticalSection(&mix_cs);
+        return MMSYSERR_INVALHANDLE;
+    }
+    bytes = mix_position(s);
+
+    if (mmt->wType == TIME_SAMPLES)
+    {
+        mmt->u.sample = bytes / s->fmt.nBlockAlign;
+    }
+    else if (mmt->wType == TIME_MS)
+    {
+        mmt->u.ms = (DWORD)((uint64_t)bytes * 1000 / s->fmt.nAvgBytesPerSec);
+    }
+    else
+    {
+        // like the drivers, fall back to bytes for anything else
+        mmt->wType = TIME_BYTES;
+        mmt->u.cb = bytes;
+    }
+    LeaveCriticalSection(&mix_cs);
+
+    return MMSYSERR_NOERROR;
+}
+
+MMRESULT WINAPI mix_waveOutGetVolume(HWAVEOUT hwo, LPDWORD volume)
+{
+    struct mix_stream *s;
+
+    if (!volume)
+        return MMSYSERR_INVALPARAM;
+
+    EnterCriticalSection(&mix_cs);
+    if ((s = mix_lookup(hwo)))
+        *volume = s->volume;
+    LeaveCriticalSection(&mix_cs);
+
+    return s ? MMSYSERR_NOERROR : MMSYSERR_INVALHANDLE;
+}
+
+MMRESULT WINAPI mix_waveOutSetVolume(HWAVEOUT hwo, DWORD volume)
+{
+    struct mix_stream *s;
+
+    EnterCriticalSection(&mix_cs);
+    if ((s = mix_lookup(hwo)))
+    {
+        s->volume = volume;
+        s->gain[0] = LOWORD(volume) / 65535.0f;
+        s->gain[1] = HIWORD(volume) / 65535.0f;
+    }
+    LeaveCriticalSection(&mix_cs);
+
+    return s ? MMSYSERR_NOERROR : MMSYSERR_INVALHANDLE;
+}
+
+MMRESULT WINAPI mix_waveOutGetID(HWAVEOUT hwo, LPUINT id)
+{
+    return real.getid(mix_hwo, id);
+}
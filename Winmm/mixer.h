@@ -0,0 +1,26 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+// Optional in-process mixer: every waveOut stream it claims, the game's and
+// our own music, is resampled and summed into a single real device.
+
+void mix_init(int enabled, int rate);
+int mix_claims(LPCWAVEFORMATEX fmt, DWORD flags);
+int mix_owns(HWAVEOUT hwo);
+void mix_shutdown(void);
+
+MMRESULT WINAPI mix_waveOutOpen(LPHWAVEOUT phwo, UINT id, LPCWAVEFORMATEX fmt, DWORD_PTR callback, DWORD_PTR instance, DWORD flags);
+MMRESULT WINAPI mix_waveOutClose(HWAVEOUT hwo);
+MMRESULT WINAPI mix_waveOutPrepareHeader(HWAVEOUT hwo, LPWAVEHDR hdr, UINT size);
+MMRESULT WINAPI mix_waveOutUnprepareHeader(HWAVEOUT hwo, LPWAVEHDR hdr, UINT size);
+MMRESULT WINAPI mix_waveOutWrite(HWAVEOUT hwo, LPWAVEHDR hdr, UINT size);
+MMRESULT WINAPI mix_waveOutPause(HWAVEOUT hwo);
+MMRESULT WINAPI mix_waveOutRestart(HWAVEOUT hwo);
+MMRESULT WINAPI mix_waveOutReset(HWAVEOUT hwo);
+MMRESULT WINAPI mix_waveOutBreakLoop(HWAVEOUT hwo);
+MMRESULT WINAPI mix_waveOutGetPosition(HWAVEOUT hwo, LPMMTIME mmt, UINT size);
+MMRESULT WINAPI mix_waveOutGetVolume(HWAVEOUT hwo, LPDWORD volume);
+MMRESULT WINAPI mix_waveOutSetVolume(HWAVEOUT hwo, DWORD volume);
+MMRESULT WINAPI mix_waveOutGetID(HWAVEOUT hwo, LPUINT id);
+
+#endif
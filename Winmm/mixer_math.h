@@ -0,0 +1,59 @@
+#ifndef MIXER_MATH_H
+#define MIXER_MATH_H
+
+// Sample arithmetic behind the software mixer: summing streams into the
+// float accumulator and packing the mix down to 16 bits.
+
+#include <math.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIX_SIMD
+#endif
+
+static __inline void mix_accumulate(float *acc, const float *src, const float *gain, int frames)
+{
+    int i = 0, n = frames * 2;
+
+#ifdef MIX_SIMD
+    __m128 g = _mm_setr_ps(gain[0], gain[1], gain[0], gain[1]);
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+#endif
+
+    for (; i < n; i++)
+        acc[i] += src[i] * gain[i & 1];
+}
+
+// Both paths round to nearest, ties to even, and saturate to 16 bits, so a
+// mix comes out the same whichever one the CPU takes. lrintf follows the
+// default rounding mode exactly like cvtps2dq does.
+static __inline void mix_pack(short *out, const float *acc, int n, int sse2)
+{
+    int i = 0;
+
+#ifdef MIX_SIMD
+    // cvtps2dq + packssdw round and saturate eight samples at a time
+    if (sse2)
+    {
+        for (; i + 8 <= n; i += 8)
+        {
+            __m128i a = _mm_cvtps_epi32(_mm_loadu_ps(acc + i));
+            __m128i b = _mm_cvtps_epi32(_mm_loadu_ps(acc + i + 4));
+            _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(a, b));
+        }
+    }
+#else
+    (void)sse2;
+#endif
+
+    for (; i < n; i++)
+    {
+        float v = acc[i];
+        if (v > 32767.0f) v = 32767.0f;
+        if (v < -32768.0f) v = -32768.0f;
+        out[i] = (short)lrintf(v);
+    }
+}
+
+#endif
@@ -1,60 +1,150 @@
 #include "stdafx.h"
 #include "libs\include\libvorbis\include\vorbis\vorbisfile.h"
+#include "player.h"
+#include "mixer.h"
+#include "stats.h"
 
-WAVEFORMATEX    plr_fmt;
-HWAVEOUT        plr_hwo         = NULL;
-OggVorbis_File  plr_vf;
-HANDLE          plr_ev          = NULL;
-int             plr_cnt         = 0;
-int             plr_vol         = 100;
-WAVEHDR         *plr_buffers[3] = { NULL, NULL, NULL };
+// the music is just another stream when the software mixer is running
+#define PLR_WAVEOUT(s, fn) (mix_owns((s)->hwo) ? mix_##fn : fn)
 
-void plr_stop()
+#define PLR_BUFFERS 3
+#define PLR_RAMP_MS 10  // volume changes glide over this much audio
+
+struct plr_stream
+{
+    WAVEFORMATEX    fmt;
+    HWAVEOUT        hwo;
+    OggVorbis_File  vf;
+    int             eof;
+    int             written;
+    float           gain;           // what the last buffer ended at
+    WAVEHDR         *buffers[PLR_BUFFERS];
+    struct st_device *st;
+    long            ra_hits;        // readahead counters already published
+    long            ra_misses;
+};
+
+// Volume is published with a single interlocked store and read once per
+// buffer. It normally lives here but can be moved into shared memory.
+static volatile LONG    plr_vol_local   = 100;
+static volatile LONG    *plr_vol        = &plr_vol_local;
+
+static int              plr_ra          = 0;
+static ogg_pool         *plr_pool       = NULL;
+
+static float plr_gain()
 {
-    plr_cnt = 0;
+    LONG vol = *plr_vol;
 
-    if (plr_vf.datasource)
-        ov_clear(&plr_vf);
+    // anyone can write a shared channel, don't trust it
+    if (vol < 0) vol = 0;
+    if (vol > 100) vol = 100;
 
-    if (plr_ev)
-    {
-        CloseHandle(plr_ev);
-        plr_ev = NULL;
-    }
+    return vol / 100.0f;
+}
 
-    if (plr_hwo)
-    {
-        waveOutReset(plr_hwo);
+static void plr_reclaim(struct plr_stream *s, int i)
+{
+    PLR_WAVEOUT(s, waveOutUnprepareHeader)(s->hwo, s->buffers[i], sizeof(WAVEHDR));
+    free(s->buffers[i]->lpData);
+    free(s->buffers[i]);
+    s->buffers[i] = NULL;
+}
 
-        int i;
-        for (i = 0; i < 3; i++)
-        {
-            if (plr_buffers[i] && plr_buffers[i]->dwFlags & WHDR_DONE)
-            {
-                waveOutUnprepareHeader(plr_hwo, plr_buffers[i], sizeof(WAVEHDR));
-                free(plr_buffers[i]->lpData);
-                free(plr_buffers[i]);
-                plr_buffers[i] = NULL;
-            }
-        }
+void plr_close(struct plr_stream *s)
+{
+    if (!s)
+        return;
+
+    PLR_WAVEOUT(s, waveOutReset)(s->hwo);
 
-        waveOutClose(plr_hwo);
-        plr_hwo = NULL;
+    int i;
+    for (i = 0; i < PLR_BUFFERS; i++)
+    {
+        if (s->buffers[i] && s->buffers[i]->dwFlags & WHDR_DONE)
+            plr_reclaim(s, i);
     }
+
+    PLR_WAVEOUT(s, waveOutClose)(s->hwo);
+    ov_clear(&s->vf);
+    ST_SET(&s->st->buffers, 0);
+    free(s);
 }
 
 void plr_volume(int vol)
 {
     if (vol < 0) vol = 0;
     if (vol > 100) vol = 100;
+    InterlockedExchange(plr_vol, vol);
+}
+
+void plr_volume_share(volatile LONG *vol)
+{
     plr_vol = vol;
 }
 
+void plr_readahead(int on)
+{
+    plr_ra = on;
+}
+
+// Decoder allocations come from a process pool of 64 KB slabs, and each
+// open track gets an arena of its own that ov_clear hands back whole, so
+// switching tracks doesn't leave the game's heap full of holes. Turning it
+// off puts the C heap back and frees the pool with whatever is still in it,
+// after emptying the setup cache, so no track may be open then; that is
+// ogg_winmm_shutdown's job, never DllMain's.
+void plr_allocator(int on)
+{
+    if (!on)
+    {
+        ov_arenas(0);
+        vorbis_setup_cache_clear();
+        ogg_set_allocator(NULL);
+        ogg_pool_destroy(plr_pool);
+        plr_pool = NULL;
+        return;
+    }
+
+    if (plr_pool)
+        return;
+
+    plr_pool = ogg_pool_create(NULL);
+    if (plr_pool)
+        ogg_set_allocator(ogg_pool_allocator(plr_pool));
+
+    ov_arenas(1);
+}
+
+// A mapped file faults its pages in on whichever thread decodes it, with
+// readahead the file is read through stdio on a thread of its own instead
+static int plr_fopen(const char *path, OggVorbis_File *vf)
+{
+    FILE *f;
+
+    if (!plr_ra)
+        return ov_fopen_fast(path, vf);
+
+    if (fopen_s(&f, path, "rb") != 0)
+        return -1;
+
+    if (ov_test(f, vf, NULL, 0) != 0)
+    {
+        fclose(f);
+        return -1;
+    }
+
+    ov_test_open_fast(vf);
+    ov_readahead(vf, 0); // reads stay on the pump if no thread can be had
+
+    return 0;
+}
+
 int plr_length(const char *path)
 {
     OggVorbis_File  vf;
 
-    if (ov_fopen(path, &vf) != 0)
+    if (ov_fopen_mmap(path, &vf) != 0)
         return 0;
 
     int ret = (int)ov_time_total(&vf, -1);
@@ -64,147 +154,159 @@ int plr_length(const char *path)
     return ret;
 }
 
-int plr_play(const char *path)
+struct plr_stream *plr_open(const char *path, HANDLE ev, struct st_device *st)
 {
-    plr_stop();
+    struct plr_stream *s = calloc(1, sizeof(struct plr_stream));
 
-    if (ov_fopen(path, &plr_vf) != 0)
-        return 0;
+    if (!s)
+        return NULL;
 
-    vorbis_info *vi = ov_info(&plr_vf, -1);
+    s->st = st;
+    s->gain = plr_gain();
 
-    if (!vi)
+    // playback only needs the headers; the length scan can wait
+    if (plr_fopen(path, &s->vf) != 0)
     {
-        ov_clear(&plr_vf);
-        return 0;
+        free(s);
+        return NULL;
     }
 
-    plr_fmt.wFormatTag      = WAVE_FORMAT_PCM;
-    plr_fmt.nChannels       = vi->channels;
-    plr_fmt.nSamplesPerSec  = vi->rate;
-    plr_fmt.wBitsPerSample  = 16;
-    plr_fmt.nBlockAlign     = plr_fmt.nChannels * (plr_fmt.wBitsPerSample / 8);
-    plr_fmt.nAvgBytesPerSec = plr_fmt.nBlockAlign * plr_fmt.nSamplesPerSec;
-    plr_fmt.cbSize          = 0;
+    vorbis_info *vi = ov_info(&s->vf, -1);
 
-    plr_ev = CreateEvent(NULL, 0, 1, NULL);
+    if (!vi)
+    {
+        ov_clear(&s->vf);
+        free(s);
+        return NULL;
+    }
+
+    s->fmt.wFormatTag      = WAVE_FORMAT_PCM;
+    s->fmt.nChannels       = vi->channels;
+    s->fmt.nSamplesPerSec  = vi->rate;
+    s->fmt.wBitsPerSample  = 16;
+    s->fmt.nBlockAlign     = s->fmt.nChannels * (s->fmt.wBitsPerSample / 8);
+    s->fmt.nAvgBytesPerSec = s->fmt.nBlockAlign * s->fmt.nSamplesPerSec;
+    s->fmt.cbSize          = 0;
 
-    if (waveOutOpen(&plr_hwo, WAVE_MAPPER, &plr_fmt, (DWORD_PTR)plr_ev, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR)
+    if ((mix_claims(&s->fmt, CALLBACK_EVENT) ? mix_waveOutOpen : waveOutOpen)(&s->hwo, WAVE_MAPPER, &s->fmt, (DWORD_PTR)ev, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR)
     {
-        return 0;
+        ov_clear(&s->vf);
+        free(s);
+        return NULL;
     }
 
-    return 1;
+    return s;
 }
 
-int plr_pump()
+static int plr_fill(struct plr_stream *s)
 {
-    if (!plr_vf.datasource)
-        return 0;
+    int i, slot = -1, in_queue = 0;
+
+    for (i = 0; i < PLR_BUFFERS; i++)
+    {
+        if (s->buffers[i] && s->buffers[i]->dwFlags & WHDR_DONE)
+            plr_reclaim(s, i);
+
+        if (s->buffers[i])
+            in_queue++;
+        else if (slot == -1)
+            slot = i;
+    }
+
+    // the device ran dry before we got back to it
+    if (in_queue == 0 && s->written && !s->eof)
+        ST_ADD(&s->st->underruns, 1);
+
+    MMTIME mmt;
+    mmt.wType = TIME_BYTES;
+    if (PLR_WAVEOUT(s, waveOutGetPosition)(s->hwo, &mmt, sizeof(MMTIME)) == MMSYSERR_NOERROR && mmt.wType == TIME_BYTES)
+        ST_SET(&s->st->position_ms, (uint32_t)((uint64_t)mmt.u.cb * 1000 / s->fmt.nAvgBytesPerSec));
+
+    ST_SET(&s->st->buffers, in_queue);
+
+    if (slot == -1)
+        return PLR_WAIT;
+
+    if (s->eof)
+        return in_queue ? PLR_WAIT : PLR_DONE;
 
     int pos = 0;
-    int bufsize = plr_fmt.nAvgBytesPerSec / 4; // 250ms (avg at 500ms) should be enough for everyone
+    int bufsize = s->fmt.nAvgBytesPerSec / 4; // 250ms (avg at 500ms) should be enough for everyone
     char *buf = malloc(bufsize);
+    uint32_t start = st_now_us();
 
     while (pos < bufsize)
     {
-        long bytes = ov_read(&plr_vf, buf + pos, bufsize - pos, 0, 2, 1, NULL);
+        long bytes = ov_read(&s->vf, buf + pos, bufsize - pos, 0, 2, 1, NULL);
 
         if (bytes == OV_HOLE)
-        {
-            free(buf);
             continue;
-        }
 
-        if (bytes == OV_EBADLINK)
+        if (bytes == OV_EBADLINK || bytes == OV_EINVAL || bytes == 0)
         {
-            free(buf);
-            return 0;
+            s->eof = 1;
+            break;
         }
 
-        if (bytes == OV_EINVAL)
-        {
-            free(buf);
-            free(buf);
-            return 0;
-        }
+        pos += bytes;
+    }
 
-        if (bytes == 0)
-        {
-            free(buf);
-
-            int i, in_queue = 0;
-            for (i = 0; i < 3; i++)
-            {
-                if (plr_buffers[i] && plr_buffers[i]->dwFlags & WHDR_DONE)
-                {
-                    waveOutUnprepareHeader(plr_hwo, plr_buffers[i], sizeof(WAVEHDR));
-                    free(plr_buffers[i]->lpData);
-                    free(plr_buffers[i]);
-                    plr_buffers[i] = NULL;
-                }
-
-                if (plr_buffers[i])
-                    in_queue++;
-            }
-
-            Sleep(100);
-
-            return !(in_queue == 0);
-        }
+    st_decode(st_shared, st_now_us() - start, (uint32_t)((uint64_t)pos * 1000 / s->fmt.nAvgBytesPerSec));
 
-        pos += bytes;
+    long hits, misses;
+    if (ov_readahead_stats(&s->vf, &hits, &misses) == 0)
+    {
+        ST_ADD(&s->st->readahead_hits, hits - s->ra_hits);
+        ST_ADD(&s->st->readahead_misses, misses - s->ra_misses);
+        s->ra_hits = hits;
+        s->ra_misses = misses;
     }
 
-    // volume control, kinda nasty
-    int x, end = pos / 2;
+    if (pos == 0)
+    {
+        free(buf);
+        return in_queue ? PLR_WAIT : PLR_DONE;
+    }
+
+    // volume control, ramped from the previous gain so changes don't click
+    float gain = plr_gain();
+    int x, c, channels = s->fmt.nChannels, frames = pos / s->fmt.nBlockAlign;
+    int ramp = gain == s->gain ? 0 : min(frames, (int)s->fmt.nSamplesPerSec * PLR_RAMP_MS / 1000);
     short *sbuf = (short *)buf;
-    for (x = 0; x < end; x++)
-        sbuf[x] = sbuf[x] * (plr_vol / 100.0f);
-        
+    for (x = 0; x < frames; x++)
+    {
+        float g = x < ramp ? s->gain + (gain - s->gain) * x / ramp : gain;
+
+        for (c = 0; c < channels; c++, sbuf++)
+            *sbuf = *sbuf * g;
+    }
+    s->gain = gain;
 
     WAVEHDR *header = malloc(sizeof(WAVEHDR));
     header->dwBufferLength   = pos;
     header->lpData           = buf;
     header->dwUser           = 0;
-    header->dwFlags          = plr_cnt == 0 ? WHDR_BEGINLOOP : 0;
+    header->dwFlags          = 0;
     header->dwLoops          = 0;
     header->lpNext           = NULL;
     header->reserved         = 0;
 
-    waveOutPrepareHeader(plr_hwo, header, sizeof(WAVEHDR));
+    PLR_WAVEOUT(s, waveOutPrepareHeader)(s->hwo, header, sizeof(WAVEHDR));
+    PLR_WAVEOUT(s, waveOutWrite)(s->hwo, header, sizeof(WAVEHDR));
+    s->buffers[slot] = header;
+    s->written = 1;
 
-    if (plr_cnt > 1)
-    {
-        WaitForSingleObject(plr_ev, INFINITE);
-    }
-
-    int i, queued = 0;
-    for (i = 0; i < 3; i++)
-    {
-        if (plr_buffers[i] && plr_buffers[i]->dwFlags & WHDR_DONE)
-        {
-            waveOutUnprepareHeader(plr_hwo, plr_buffers[i], sizeof(WAVEHDR));
-            free(plr_buffers[i]->lpData);
-            free(plr_buffers[i]);
-            plr_buffers[i] = NULL;
-        }
+    ST_SET(&s->st->buffers, in_queue + 1);
 
-        if (!queued && plr_buffers[i] == NULL)
-        {
-            waveOutWrite(plr_hwo, header, sizeof(WAVEHDR));
-            plr_buffers[i] = header;
-            queued = 1;
-        }
-    }
+    return PLR_QUEUED;
+}
 
-    if (!queued)
-    {
-        free(header);
-        free(buf);
-    }
+int plr_pump(struct plr_stream *s)
+{
+    uint32_t start = st_now_us();
+    int ret = plr_fill(s);
 
-    plr_cnt++;
+    st_pump(st_shared, st_now_us() - start);
 
-    return 1;
+    return ret;
 }
@@ -1,10 +1,21 @@
 #ifndef PLAYER_H
 #define PLAYER_H
 
-void plr_stop();
+// plr_pump results
+#define PLR_DONE    0   // track finished and every buffer has played
+#define PLR_QUEUED  1   // queued another buffer, call again
+#define PLR_WAIT    2   // device is full, wait for its event
+
+struct plr_stream;
+struct st_device;
+
+struct plr_stream *plr_open(const char *path, HANDLE ev, struct st_device *st);
+void plr_close(struct plr_stream *s);
 void plr_volume(int vol);
-int plr_pump();
+void plr_volume_share(volatile LONG *vol);
+void plr_readahead(int on);
+void plr_allocator(int on);
+int plr_pump(struct plr_stream *s);
 int plr_length(const char *path);
-int plr_play(const char *path);
 
 #endif
@@ -0,0 +1,54 @@
+#include "stdafx.h"
+#include "stats.h"
+
+static struct st_block  st_local;
+static uint64_t         st_freq     = 0;
+struct st_block         *st_shared  = &st_local;
+
+void st_init(int enabled)
+{
+    LARGE_INTEGER li;
+
+    if (QueryPerformanceFrequency(&li) && li.QuadPart > 0)
+        st_freq = li.QuadPart;
+
+    if (enabled)
+    {
+        // The default DACL lets any process of the same user map this
+        // writable too, winmmstat only asks for FILE_MAP_READ. Nothing read
+        // back from the block steers playback, a writer can only skew the
+        // numbers.
+        HANDLE map = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(struct st_block), ST_NAME);
+
+        // another instance already publishes under this name, leave it be
+        if (map && GetLastError() == ERROR_ALREADY_EXISTS)
+        {
+            CloseHandle(map);
+            map = NULL;
+        }
+
+        if (map)
+        {
+            // the mapping lives as long as the process, no need to track it
+            struct st_block *b = MapViewOfFile(map, FILE_MAP_WRITE, 0, 0, sizeof(struct st_block));
+
+            if (b)
+                st_shared = b;
+            else
+                CloseHandle(map);
+        }
+    }
+
+    st_header(st_shared, GetCurrentProcessId());
+}
+
+uint32_t st_now_us(void)
+{
+    LARGE_INTEGER li;
+
+    if (!st_freq)
+        return GetTickCount() * 1000;
+
+    QueryPerformanceCounter(&li);
+    return st_ticks_to_us(li.QuadPart, st_freq);
+}
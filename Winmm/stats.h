@@ -0,0 +1,121 @@
+#ifndef STATS_H
+#define STATS_H
+
+// Layout of the shared statistics block and the helpers that update it.
+//
+// Every field is a 32-bit counter updated with a single atomic instruction
+// so the audio path never waits on anything. Totals wrap, readers are
+// expected to work with the difference between two samples.
+
+#include <stdint.h>
+
+#define ST_MAGIC    0x54534D57  // "WMST"
+#define ST_VERSION  2
+#define ST_DEVICES  8
+
+#ifdef _WIN32
+#define ST_NAME     "Local\\ogg-winmm-stats"
+#else
+#define ST_NAME     "/ogg-winmm-stats"
+#endif
+
+// MCI commands counted separately, everything else lands in ST_MCI_OTHER
+#define ST_MCI_OPEN     0
+#define ST_MCI_CLOSE    1
+#define ST_MCI_PLAY     2
+#define ST_MCI_STOP     3
+#define ST_MCI_SET      4
+#define ST_MCI_STATUS   5
+#define ST_MCI_OTHER    6
+#define ST_MCI_STRING   7   // mciSendString calls, on top of what they turn into
+#define ST_MCI_COUNT    8
+
+struct st_device
+{
+    uint32_t active;        // 1 while a stream is open
+    uint32_t track;
+    uint32_t position_ms;   // inside the current track
+    uint32_t buffers;       // waveOut buffers queued
+    uint32_t underruns;     // pump found every buffer already played
+    uint32_t readahead_hits;    // file reads already read ahead, Readahead=1
+    uint32_t readahead_misses;  // and ones that waited for the disk
+};
+
+struct st_block
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t pid;
+
+    uint32_t scan_us;       // TOC scan at startup
+
+    uint32_t decode_us;     // time spent in ov_read
+    uint32_t decoded_ms;    // audio it produced
+
+    uint32_t pump_calls;
+    uint32_t pump_us;
+    uint32_t pump_max_us;
+
+    uint32_t mci_calls[ST_MCI_COUNT];
+
+    struct st_device devices[ST_DEVICES];
+};
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define ST_ADD(p, v)    _InterlockedExchangeAdd((volatile long *)(p), (long)(v))
+#define ST_SET(p, v)    _InterlockedExchange((volatile long *)(p), (long)(v))
+#define ST_GET(p)       (*(volatile uint32_t *)(p))
+#else
+#define ST_ADD(p, v)    __atomic_fetch_add((p), (uint32_t)(v), __ATOMIC_RELAXED)
+#define ST_SET(p, v)    __atomic_store_n((p), (uint32_t)(v), __ATOMIC_RELAXED)
+#define ST_GET(p)       __atomic_load_n((p), __ATOMIC_RELAXED)
+#endif
+
+static __inline void st_header(struct st_block *b, uint32_t pid)
+{
+    b->version = ST_VERSION;
+    b->size = sizeof(struct st_block);
+    b->pid = pid;
+    ST_SET(&b->magic, ST_MAGIC); // last, readers check it before anything else
+}
+
+static __inline void st_mci(struct st_block *b, unsigned int cmd)
+{
+    ST_ADD(&b->mci_calls[cmd < ST_MCI_COUNT ? cmd : ST_MCI_OTHER], 1);
+}
+
+static __inline void st_decode(struct st_block *b, uint32_t us, uint32_t ms)
+{
+    ST_ADD(&b->decode_us, us);
+    ST_ADD(&b->decoded_ms, ms);
+}
+
+// The maximum is a plain compare and store instead of a CAS loop. Two pumps
+// finishing at the same moment can lose the smaller of two new maxima,
+// which is fine for a statistic and keeps this wait-free.
+static __inline void st_pump(struct st_block *b, uint32_t us)
+{
+    ST_ADD(&b->pump_calls, 1);
+    ST_ADD(&b->pump_us, us);
+
+    if (us > ST_GET(&b->pump_max_us))
+        ST_SET(&b->pump_max_us, us);
+}
+
+// Whole microseconds in a counter reading, wrapped to 32 bits like every
+// other total. Split at the frequency so the multiply can't overflow.
+static __inline uint32_t st_ticks_to_us(uint64_t ticks, uint64_t freq)
+{
+    return (uint32_t)((ticks / freq) * 1000000 + ((ticks % freq) * 1000000) / freq);
+}
+
+// Always points at a valid block, a private one when publishing is off or
+// the mapping could not be created, so updates never have to check.
+extern struct st_block *st_shared;
+
+void st_init(int enabled);
+uint32_t st_now_us(void);
+
+#endif
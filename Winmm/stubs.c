@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "player.h"
+#include "mixer.h"
 static HINSTANCE realWinmmDLL = 0;
 
 HINSTANCE getWinmmHandle()
@@ -161,6 +162,8 @@ MMRESULT WINAPI fake_waveOutGetDevCapsW(UINT a0, LPWAVEOUTCAPSW a1, UINT a2)
 MMRESULT WINAPI fake_waveOutGetVolume(HWAVEOUT a0, PDWORD a1)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0, PDWORD a1) = NULL;
+    if (mix_owns(a0))
+        return mix_waveOutGetVolume(a0, a1);
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutGetVolume");
     return (*funcp)(a0, a1);
@@ -169,6 +172,8 @@ MMRESULT WINAPI fake_waveOutGetVolume(HWAVEOUT a0, PDWORD a1)
 MMRESULT WINAPI fake_waveOutSetVolume(HWAVEOUT a0, DWORD a1)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0, DWORD a1) = NULL;
+    if (mix_owns(a0))
+        return mix_waveOutSetVolume(a0, a1);
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutSetVolume");
     return (*funcp)(a0, a1);
@@ -193,6 +198,8 @@ MMRESULT WINAPI fake_waveOutGetErrorTextW(MMRESULT a0, LPWSTR a1, UINT a2)
 MMRESULT WINAPI fake_waveOutOpen(LPHWAVEOUT a0, UINT a1, LPCWAVEFORMATEX a2, DWORD a3, DWORD a4, DWORD a5)
 {
     static MMRESULT(WINAPI *funcp)(LPHWAVEOUT a0, UINT a1, LPCWAVEFORMATEX a2, DWORD a3, DWORD a4, DWORD a5) = NULL;
+    if (mix_claims(a2, a5))
+        return mix_waveOutOpen(a0, a1, a2, a3, a4, a5);
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutOpen");
     return (*funcp)(a0, a1, a2, a3, a4, a5);
@@ -201,6 +208,8 @@ MMRESULT WINAPI fake_waveOutOpen(LPHWAVEOUT a0, UINT a1, LPCWAVEFORMATEX a2, DWO
 MMRESULT WINAPI fake_waveOutClose(HWAVEOUT a0)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0) = NULL;
+    if (mix_owns(a0))
+        return mix_waveOutClose(a0);
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutClose");
     return (*funcp)(a0);
@@ -209,6 +218,8 @@ MMRESULT WINAPI fake_waveOutClose(HWAVEOUT a0)
 MMRESULT WINAPI fake_waveOutPrepareHeader(HWAVEOUT a0, LPWAVEHDR a1, UINT a2)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0, LPWAVEHDR a1, UINT a2) = NULL;
+    if (mix_owns(a0))
+        return mix_waveOutPrepareHeader(a0, a1, a2);
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutPrepareHeader");
     return (*funcp)(a0, a1, a2);
@@ -217,6 +228,8 @@ MMRESULT WINAPI fake_waveOutPrepareHeader(HWAVEOUT a0, LPWAVEHDR a1, UINT a2)
 MMRESULT WINAPI fake_waveOutUnprepareHeader(HWAVEOUT a0, LPWAVEHDR a1, UINT a2)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0, LPWAVEHDR a1, UINT a2) = NULL;
+    if (mix_owns(a0))
+        return mix_waveOutUnprepareHeader(a0, a1, a2);
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutUnprepareHeader");
     return (*funcp)(a0, a1, a2);
@@ -225,6 +238,8 @@ MMRESULT WINAPI fake_waveOutUnprepareHeader(HWAVEOUT a0, LPWAVEHDR a1, UINT a2)
 MMRESULT WINAPI fake_waveOutWrite(HWAVEOUT a0, LPWAVEHDR a1, UINT a2)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0, LPWAVEHDR a1, UINT a2) = NULL;
+    if (mix_owns(a0))
+        return mix_waveOutWrite(a0, a1, a2);
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutWrite");
     return (*funcp)(a0, a1, a2);
@@ -233,6 +248,8 @@ MMRESULT WINAPI fake_waveOutWrite(HWAVEOUT a0, LPWAVEHDR a1, UINT a2)
 MMRESULT WINAPI fake_waveOutPause(HWAVEOUT a0)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0) = NULL;
+    if (mix_owns(a0))
+        return mix_waveOutPause(a0);
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutPause");
     return (*funcp)(a0);
@@ -241,6 +258,8 @@ MMRESULT WINAPI fake_waveOutPause(HWAVEOUT a0)
 MMRESULT WINAPI fake_waveOutRestart(HWAVEOUT a0)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0) = NULL;
+    if (mix_owns(a0))
+        return mix_waveOutRestart(a0);
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutRestart");
     return (*funcp)(a0);
@@ -249,6 +268,8 @@ MMRESULT WINAPI fake_waveOutRestart(HWAVEOUT a0)
 MMRESULT WINAPI fake_waveOutReset(HWAVEOUT a0)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0) = NULL;
+    if (mix_owns(a0))
+        return mix_waveOutReset(a0);
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutReset");
     return (*funcp)(a0);
@@ -257,6 +278,8 @@ MMRESULT WINAPI fake_waveOutReset(HWAVEOUT a0)
 MMRESULT WINAPI fake_waveOutBreakLoop(HWAVEOUT a0)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0) = NULL;
+    if (mix_owns(a0))
+        return mix_waveOutBreakLoop(a0);
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutBreakLoop");
     return (*funcp)(a0);
@@ -265,6 +288,8 @@ MMRESULT WINAPI fake_waveOutBreakLoop(HWAVEOUT a0)
 MMRESULT WINAPI fake_waveOutGetPosition(HWAVEOUT a0, LPMMTIME a1, UINT a2)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0, LPMMTIME a1, UINT a2) = NULL;
+    if (mix_owns(a0))
+        return mix_waveOutGetPosition(a0, a1, a2);
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutGetPosition");
     return (*funcp)(a0, a1, a2);
@@ -273,6 +298,8 @@ MMRESULT WINAPI fake_waveOutGetPosition(HWAVEOUT a0, LPMMTIME a1, UINT a2)
 MMRESULT WINAPI fake_waveOutGetPitch(HWAVEOUT a0, PDWORD a1)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0, PDWORD a1) = NULL;
+    if (mix_owns(a0))
+        return MMSYSERR_NOTSUPPORTED;
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutGetPitch");
     return (*funcp)(a0, a1);
@@ -281,6 +308,8 @@ MMRESULT WINAPI fake_waveOutGetPitch(HWAVEOUT a0, PDWORD a1)
 MMRESULT WINAPI fake_waveOutSetPitch(HWAVEOUT a0, DWORD a1)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0, DWORD a1) = NULL;
+    if (mix_owns(a0))
+        return MMSYSERR_NOTSUPPORTED;
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutSetPitch");
     return (*funcp)(a0, a1);
@@ -289,6 +318,8 @@ MMRESULT WINAPI fake_waveOutSetPitch(HWAVEOUT a0, DWORD a1)
 MMRESULT WINAPI fake_waveOutGetPlaybackRate(HWAVEOUT a0, PDWORD a1)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0, PDWORD a1) = NULL;
+    if (mix_owns(a0))
+        return MMSYSERR_NOTSUPPORTED;
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutGetPlaybackRate");
     return (*funcp)(a0, a1);
@@ -297,6 +328,8 @@ MMRESULT WINAPI fake_waveOutGetPlaybackRate(HWAVEOUT a0, PDWORD a1)
 MMRESULT WINAPI fake_waveOutSetPlaybackRate(HWAVEOUT a0, DWORD a1)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0, DWORD a1) = NULL;
+    if (mix_owns(a0))
+        return MMSYSERR_NOTSUPPORTED;
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutSetPlaybackRate");
     return (*funcp)(a0, a1);
@@ -305,6 +338,8 @@ MMRESULT WINAPI fake_waveOutSetPlaybackRate(HWAVEOUT a0, DWORD a1)
 MMRESULT WINAPI fake_waveOutGetID(HWAVEOUT a0, LPUINT a1)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0, LPUINT a1) = NULL;
+    if (mix_owns(a0))
+        return mix_waveOutGetID(a0, a1);
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutGetID");
     return (*funcp)(a0, a1);
@@ -313,6 +348,8 @@ MMRESULT WINAPI fake_waveOutGetID(HWAVEOUT a0, LPUINT a1)
 MMRESULT WINAPI fake_waveOutMessage(HWAVEOUT a0, UINT a1, DWORD a2, DWORD a3)
 {
     static MMRESULT(WINAPI *funcp)(HWAVEOUT a0, UINT a1, DWORD a2, DWORD a3) = NULL;
+    if (mix_owns(a0))
+        return MMSYSERR_NOTSUPPORTED;
     if (funcp == NULL)
         funcp = (void*)GetProcAddress(loadRealDLL(), "waveOutMessage");
     return (*funcp)(a0, a1, a2, a3);
@@ -918,22 +955,6 @@ MMRESULT WINAPI fake_mixerSetControlDetails(HMIXEROBJ a0, LPMIXERCONTROLDETAILS
     return (*funcp)(a0, a1, a2);
 }
 
-MMRESULT WINAPI fake_timeGetSystemTime(LPMMTIME a0, UINT a1)
-{
-    static MMRESULT(WINAPI *funcp)(LPMMTIME a0, UINT a1) = NULL;
-    if (funcp == NULL)
-        funcp = (void*)GetProcAddress(loadRealDLL(), "timeGetSystemTime");
-    return (*funcp)(a0, a1);
-}
-
-DWORD WINAPI fake_timeGetTime()
-{
-    static DWORD(WINAPI *funcp)() = NULL;
-    if (funcp == NULL)
-        funcp = (void*)GetProcAddress(loadRealDLL(), "timeGetTime");
-    return (*funcp)();
-}
-
 MMRESULT WINAPI fake_timeSetEvent(UINT a0, UINT a1, LPTIMECALLBACK a2, DWORD a3, UINT a4)
 {
     static MMRESULT(WINAPI *funcp)(UINT a0, UINT a1, LPTIMECALLBACK a2, DWORD a3, UINT a4) = NULL;
@@ -958,22 +979,6 @@ MMRESULT WINAPI fake_timeGetDevCaps(LPTIMECAPS a0, UINT a1)
     return (*funcp)(a0, a1);
 }
 
-MMRESULT WINAPI fake_timeBeginPeriod(UINT a0)
-{
-    static MMRESULT(WINAPI *funcp)(UINT a0) = NULL;
-    if (funcp == NULL)
-        funcp = (void*)GetProcAddress(loadRealDLL(), "timeBeginPeriod");
-    return (*funcp)(a0);
-}
-
-MMRESULT WINAPI fake_timeEndPeriod(UINT a0)
-{
-    static MMRESULT(WINAPI *funcp)(UINT a0) = NULL;
-    if (funcp == NULL)
-        funcp = (void*)GetProcAddress(loadRealDLL(), "timeEndPeriod");
-    return (*funcp)(a0);
-}
-
 UINT WINAPI fake_joyGetNumDevs()
 {
     static UINT(WINAPI *funcp)() = NULL;
@@ -0,0 +1,139 @@
+#include "stdafx.h"
+#include "timer.h"
+#include "timer_math.h"
+
+HINSTANCE loadRealDLL();
+
+// KSYSTEM_TIME as laid out in KUSER_SHARED_DATA, which the kernel maps
+// read-only into every process. InterruptTime lives at offset 8. The kernel
+// only advances it on the clock interrupt, every 15.6 ms unless someone has
+// raised the timer resolution, and with IgnoreTimerPeriod nothing here does.
+// The QPC source is the one with 1 ms steps.
+struct tmr_ksystem_time
+{
+    ULONG LowPart;
+    LONG  High1Time;
+    LONG  High2Time;
+};
+
+#define TMR_INTERRUPT_TIME ((volatile struct tmr_ksystem_time *)0x7FFE0008)
+
+static int                  tmr_source          = TMR_SOURCE_SYSTEM;
+static int                  tmr_ignore_period   = 0;
+static uint64_t             tmr_freq            = 0;
+static uint64_t             tmr_start           = 0;
+static uint32_t             tmr_base            = 0;
+static struct tmr_periods   tmr_periods;
+static CRITICAL_SECTION     tmr_cs;
+
+// Same torn-read guard the kernel documents for KSYSTEM_TIME: the high
+// part is written twice, around the low part, so retry until they agree.
+static uint64_t tmr_read_interrupt_time()
+{
+    volatile struct tmr_ksystem_time *t = TMR_INTERRUPT_TIME;
+    LONG high;
+    ULONG low;
+
+    do
+    {
+        high = t->High1Time;
+        low = t->LowPart;
+    } while (high != t->High2Time);
+
+    return ((uint64_t)(ULONG)high << 32) | low;
+}
+
+void tmr_init(int source, int ignore_period)
+{
+    LARGE_INTEGER li;
+
+    InitializeCriticalSection(&tmr_cs);
+    memset(&tmr_periods, 0, sizeof tmr_periods);
+
+    if (source == TMR_SOURCE_QPC)
+    {
+        if (QueryPerformanceFrequency(&li) && li.QuadPart > 0)
+        {
+            tmr_freq = li.QuadPart;
+            QueryPerformanceCounter(&li);
+            tmr_start = li.QuadPart;
+
+            // start where timeGetTime is now so both clocks line up
+            tmr_base = (uint32_t)tmr_interrupt_to_ms(tmr_read_interrupt_time());
+        }
+        else
+        {
+            source = TMR_SOURCE_INTERRUPT;
+        }
+    }
+
+    if (source != TMR_SOURCE_QPC && source != TMR_SOURCE_INTERRUPT)
+        source = TMR_SOURCE_SYSTEM;
+
+    tmr_source = source;
+    tmr_ignore_period = ignore_period;
+}
+
+DWORD WINAPI fake_timeGetTime()
+{
+    static DWORD(WINAPI *funcp)() = NULL;
+
+    if (tmr_source == TMR_SOURCE_QPC)
+    {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        return tmr_counter_time(tmr_base, tmr_start, now.QuadPart, tmr_freq);
+    }
+
+    if (tmr_source == TMR_SOURCE_INTERRUPT)
+        return (DWORD)tmr_interrupt_to_ms(tmr_read_interrupt_time());
+
+    if (funcp == NULL)
+        funcp = (void*)GetProcAddress(loadRealDLL(), "timeGetTime");
+    return (*funcp)();
+}
+
+MMRESULT WINAPI fake_timeGetSystemTime(LPMMTIME a0, UINT a1)
+{
+    // winmm fills in milliseconds whatever wType asked for
+    if (a1 >= sizeof(MMTIME))
+    {
+        a0->wType = TIME_MS;
+        a0->u.ms = fake_timeGetTime();
+    }
+    return TIMERR_NOERROR;
+}
+
+MMRESULT WINAPI fake_timeBeginPeriod(UINT a0)
+{
+    static MMRESULT(WINAPI *funcp)(UINT a0) = NULL;
+
+    if (tmr_ignore_period)
+    {
+        EnterCriticalSection(&tmr_cs);
+        int ret = tmr_period_begin(&tmr_periods, a0);
+        LeaveCriticalSection(&tmr_cs);
+        return ret == 0 ? TIMERR_NOERROR : TIMERR_NOCANDO;
+    }
+
+    if (funcp == NULL)
+        funcp = (void*)GetProcAddress(loadRealDLL(), "timeBeginPeriod");
+    return (*funcp)(a0);
+}
+
+MMRESULT WINAPI fake_timeEndPeriod(UINT a0)
+{
+    static MMRESULT(WINAPI *funcp)(UINT a0) = NULL;
+
+    if (tmr_ignore_period)
+    {
+        EnterCriticalSection(&tmr_cs);
+        int ret = tmr_period_end(&tmr_periods, a0);
+        LeaveCriticalSection(&tmr_cs);
+        return ret == 0 ? TIMERR_NOERROR : TIMERR_NOCANDO;
+    }
+
+    if (funcp == NULL)
+        funcp = (void*)GetProcAddress(loadRealDLL(), "timeEndPeriod");
+    return (*funcp)(a0);
+}
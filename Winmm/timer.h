@@ -0,0 +1,10 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#define TMR_SOURCE_SYSTEM       0   // forward to the system winmm
+#define TMR_SOURCE_QPC          1   // QueryPerformanceCounter, 1ms steps
+#define TMR_SOURCE_INTERRUPT    2   // interrupt time from the shared user page, tick steps
+
+void tmr_init(int source, int ignore_period);
+
+#endif
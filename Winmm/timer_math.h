@@ -0,0 +1,70 @@
+#ifndef TIMER_MATH_H
+#define TIMER_MATH_H
+
+// Arithmetic behind the native timer family. Nothing in here touches the
+// Windows headers so it can be compiled and checked on any host.
+
+#include <stdint.h>
+
+#define TMR_PERIOD_MIN          1
+#define TMR_PERIOD_MAX          1000000
+#define TMR_MAX_TRACKED_PERIOD  64
+
+// Interrupt time is kept in 100ns units
+#define TMR_INTERRUPT_UNITS_PER_MS 10000
+
+struct tmr_periods
+{
+    unsigned int count[TMR_MAX_TRACKED_PERIOD + 1];
+};
+
+// Whole milliseconds in a counter delta, truncated like timeGetTime.
+// Splitting at the frequency keeps the multiply from overflowing even
+// after weeks of uptime on a GHz counter.
+static __inline uint64_t tmr_ticks_to_ms(uint64_t ticks, uint64_t freq)
+{
+    return (ticks / freq) * 1000 + ((ticks % freq) * 1000) / freq;
+}
+
+static __inline uint64_t tmr_interrupt_to_ms(uint64_t interrupt_time)
+{
+    return interrupt_time / TMR_INTERRUPT_UNITS_PER_MS;
+}
+
+// timeGetTime wraps every ~49.7 days, the truncation to 32 bits does that
+static __inline uint32_t tmr_counter_time(uint32_t base_ms, uint64_t start, uint64_t now, uint64_t freq)
+{
+    return (uint32_t)(base_ms + tmr_ticks_to_ms(now - start, freq));
+}
+
+// Mirrors timeBeginPeriod: returns 0 on success, -1 for an invalid period
+static __inline int tmr_period_begin(struct tmr_periods *p, unsigned int period)
+{
+    if (period < TMR_PERIOD_MIN || period > TMR_PERIOD_MAX)
+        return -1;
+
+    // coarse periods never change the resolution, nothing to balance
+    if (period <= TMR_MAX_TRACKED_PERIOD)
+        p->count[period]++;
+
+    return 0;
+}
+
+// Mirrors timeEndPeriod: an end without a matching begin is rejected
+static __inline int tmr_period_end(struct tmr_periods *p, unsigned int period)
+{
+    if (period < TMR_PERIOD_MIN || period > TMR_PERIOD_MAX)
+        return -1;
+
+    if (period <= TMR_MAX_TRACKED_PERIOD)
+    {
+        if (p->count[period] == 0)
+            return -1;
+
+        p->count[period]--;
+    }
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,133 @@
+/*
+* mixer_math_test - checks that the mixer's SSE2 and scalar sample paths
+* (Winmm/mixer_math.h) give the same bits on the build host.
+*
+*   make -C tests check
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mixer_math.h"
+
+#define SAMPLES 4096
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static short pack_one(float v, int sse2)
+{
+    float acc[8];
+    short out[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+        acc[i] = v;
+    mix_pack(out, acc, 8, sse2);
+    return out[0];
+}
+
+// The scalar tail against the eight-wide path over every quarter step
+// through and past the 16-bit range, so every tie is hit
+static void test_pack_sweep(void)
+{
+    static float acc[SAMPLES];
+    static short vec[SAMPLES], ref[SAMPLES];
+    long k = -40000 * 4;
+    int i;
+
+    while (k <= 40000 * 4)
+    {
+        for (i = 0; i < SAMPLES; i++, k++)
+            acc[i] = k * 0.25f;
+
+        mix_pack(vec, acc, SAMPLES, 1);
+        mix_pack(ref, acc, SAMPLES, 0);
+        if (memcmp(vec, ref, sizeof vec))
+        {
+            for (i = 0; i < SAMPLES && vec[i] == ref[i]; i++)
+                ;
+            printf("mix_pack(%g): sse2 %d, scalar %d\n", acc[i], vec[i], ref[i]);
+            failures++;
+            return;
+        }
+    }
+}
+
+static void test_pack_values(void)
+{
+    int sse2;
+
+    for (sse2 = 0; sse2 < 2; sse2++)
+    {
+        CHECK(pack_one(0.5f, sse2) == 0);
+        CHECK(pack_one(1.5f, sse2) == 2);
+        CHECK(pack_one(2.5f, sse2) == 2);
+        CHECK(pack_one(-0.5f, sse2) == 0);
+        CHECK(pack_one(-2.5f, sse2) == -2);
+        CHECK(pack_one(0.49999997f, sse2) == 0);
+        CHECK(pack_one(32767.4f, sse2) == 32767);
+        CHECK(pack_one(32767.5f, sse2) == 32767);
+        CHECK(pack_one(-32768.5f, sse2) == -32768);
+        CHECK(pack_one(16 * 32767.0f, sse2) == 32767);
+        CHECK(pack_one(16 * -32768.0f, sse2) == -32768);
+    }
+
+    // lengths that leave a scalar tail behind the vector loop
+    {
+        float acc[11] = { 0.5f, 1.5f, 2.5f, 3.5f, -0.5f, -1.5f, -2.5f, -3.5f, 4.5f, -4.5f, 40000.0f };
+        short out[11];
+        short want[11] = { 0, 2, 2, 4, 0, -2, -2, -4, 4, -4, 32767 };
+        int n;
+
+        for (n = 1; n <= 11; n++)
+        {
+            memset(out, 0x55, sizeof out);
+            mix_pack(out, acc, n, 1);
+            CHECK(memcmp(out, want, n * sizeof(short)) == 0);
+            CHECK(n == 11 || out[n] == 0x5555);
+        }
+    }
+}
+
+static void test_accumulate(void)
+{
+    static float src[SAMPLES], vec[SAMPLES], ref[SAMPLES];
+    float gain[2] = { 0.7071f, 0.35f };
+    int i, frames;
+
+    srand(1);
+    for (i = 0; i < SAMPLES; i++)
+    {
+        src[i] = (float)(rand() % 65536 - 32768);
+        vec[i] = ref[i] = (float)(rand() % 65536 - 32768);
+    }
+
+    // odd frame counts end on a pair the vector loop can't take
+    for (frames = 1; frames <= 9; frames++)
+    {
+        mix_accumulate(vec, src, gain, frames);
+        for (i = 0; i < frames * 2; i++)
+            ref[i] += src[i] * gain[i & 1];
+    }
+    CHECK(memcmp(vec, ref, sizeof vec) == 0);
+}
+
+int main(void)
+{
+    test_pack_sweep();
+    test_pack_values();
+    test_accumulate();
+
+    if (failures)
+    {
+        printf("mixer_math_test: %d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("mixer_math_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,193 @@
+/*
+* stats_test - checks the statistics block helpers (Winmm/stats.h) and the
+* winmmstat report (tools/stats_format.h) on the build host, publishing
+* through POSIX shm the way winmmstat reads it.
+*
+*   make -C tests check
+*/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stats.h"
+#include "stats_format.h"
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static void test_ticks_to_us(void)
+{
+    uint64_t freq = 3579545;
+
+    CHECK(st_ticks_to_us(0, freq) == 0);
+    CHECK(st_ticks_to_us(freq, freq) == 1000000);
+    CHECK(st_ticks_to_us(freq - 1, freq) == 999999);
+
+    // wraps at 2^32 us like the totals, without the multiply overflowing
+    freq = 3000000000ULL;
+    CHECK(st_ticks_to_us(freq * 4295, freq) == (uint32_t)(4295ULL * 1000000));
+    CHECK(st_ticks_to_us(freq * 86400 * 365, freq) == (uint32_t)(86400ULL * 365 * 1000000));
+}
+
+static void test_updates(struct st_block *b)
+{
+    memset(b, 0, sizeof *b);
+    st_header(b, 1234);
+
+    CHECK(b->magic == ST_MAGIC);
+    CHECK(b->version == ST_VERSION);
+    CHECK(b->size == sizeof(struct st_block));
+    CHECK(b->pid == 1234);
+
+    st_mci(b, ST_MCI_PLAY);
+    st_mci(b, ST_MCI_PLAY);
+    st_mci(b, ST_MCI_STRING);
+    st_mci(b, ST_MCI_COUNT);
+    st_mci(b, 0x0800);
+    CHECK(b->mci_calls[ST_MCI_PLAY] == 2);
+    CHECK(b->mci_calls[ST_MCI_STRING] == 1);
+    CHECK(b->mci_calls[ST_MCI_OTHER] == 2);
+
+    st_decode(b, 1500, 40);
+    st_decode(b, 500, 60);
+    CHECK(b->decode_us == 2000);
+    CHECK(b->decoded_ms == 100);
+
+    st_pump(b, 30);
+    st_pump(b, 90);
+    st_pump(b, 60);
+    CHECK(b->pump_calls == 3);
+    CHECK(b->pump_us == 180);
+    CHECK(b->pump_max_us == 90);
+}
+
+static void test_format(void)
+{
+    struct st_block prev, now;
+    char text[ST_FORMAT_MAX];
+    char small[40];
+    size_t len;
+
+    memset(&prev, 0, sizeof prev);
+    memset(&now, 0, sizeof now);
+
+    // totals that wrapped between the two samples still give the difference
+    prev.pid = now.pid = 42;
+    now.scan_us = 123456;
+    prev.pump_calls = 0xFFFFFFF0;
+    now.pump_calls = 0x00000010;
+    prev.pump_us = 0xFFFFFF00;
+    now.pump_us = 0x00000100 + 31 * 1000;
+    now.pump_max_us = 2500;
+    prev.decode_us = 100;
+    now.decode_us = 100 + 25000;
+    prev.decoded_ms = 5000;
+    now.decoded_ms = 6000;
+    now.mci_calls[ST_MCI_PLAY] = 3;
+    prev.mci_calls[ST_MCI_STATUS] = 0xFFFFFFFF;
+    now.mci_calls[ST_MCI_STATUS] = 9;
+
+    // playing, stopped with underruns, and stopped quietly which is left out
+    now.devices[0].active = 1;
+    now.devices[0].track = 2;
+    now.devices[0].position_ms = 3 * 60000 + 7 * 1000 + 45;
+    now.devices[0].buffers = 4;
+    now.devices[0].readahead_hits = 120;
+    now.devices[0].readahead_misses = 3;
+    now.devices[2].underruns = 5;
+    now.devices[2].track = 11;
+    now.devices[3].track = 7;
+
+    len = st_format(text, sizeof text, &now, &prev);
+    CHECK(len == strlen(text));
+    CHECK(strcmp(text,
+        "pid 42, startup scan 123.456 ms\n"
+        "pump: 32/s, avg 984 us, max 2500 us\n"
+        "decode: 25000 us per second of audio\n"
+        "mci/s: open 0 close 0 play 3 stop 0 set 0 status 10 other 0 string 0\n"
+        "device 0: playing track 02 at 3:07.045, 4 buffers queued, 0 underruns\n"
+        "          readahead: 120 hits, 3 misses\n"
+        "device 2: stopped track 11 at 0:00.000, 0 buffers queued, 5 underruns\n"
+        "\n") == 0);
+
+    // an idle second divides by nothing
+    len = st_format(text, sizeof text, &prev, &prev);
+    CHECK(strstr(text, "pump: 0/s, avg 0 us,") != NULL);
+    CHECK(strstr(text, "decode: 0 us per second") != NULL);
+
+    // a short buffer is cut off, still terminated
+    len = st_format(small, sizeof small, &now, &prev);
+    CHECK(len == sizeof small - 1);
+    CHECK(strlen(small) == sizeof small - 1);
+    CHECK(strncmp(small, "pid 42, startup scan 123.456 ms\npump: 3", sizeof small - 1) == 0);
+}
+
+// Publishes a block the way st_init does and reads it back through a
+// second, read-only mapping the way winmmstat does
+static void test_shm(void)
+{
+    char name[64];
+    struct st_block *w;
+    const struct st_block *r;
+    int fd;
+
+    snprintf(name, sizeof name, "%s-test-%d", ST_NAME, (int)getpid());
+
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    CHECK(fd >= 0);
+    if (fd < 0)
+        return;
+
+    CHECK(ftruncate(fd, sizeof(struct st_block)) == 0);
+    w = mmap(NULL, sizeof(struct st_block), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    fd = shm_open(name, O_RDONLY, 0);
+    r = fd < 0 ? MAP_FAILED : mmap(NULL, sizeof(struct st_block), PROT_READ, MAP_SHARED, fd, 0);
+    if (fd >= 0)
+        close(fd);
+    shm_unlink(name);
+
+    CHECK(w != MAP_FAILED);
+    CHECK(r != MAP_FAILED);
+    if (w == MAP_FAILED || r == MAP_FAILED)
+        return;
+
+    CHECK(ST_GET(&r->magic) == 0);
+    st_header(w, (uint32_t)getpid());
+    st_pump(w, 77);
+    ST_SET(&w->devices[1].position_ms, 65000);
+
+    CHECK(ST_GET(&r->magic) == ST_MAGIC);
+    CHECK(r->size == sizeof(struct st_block));
+    CHECK(r->pid == (uint32_t)getpid());
+    CHECK(ST_GET(&r->pump_max_us) == 77);
+    CHECK(ST_GET(&r->devices[1].position_ms) == 65000);
+
+    munmap(w, sizeof(struct st_block));
+    munmap((void *)r, sizeof(struct st_block));
+}
+
+int main(void)
+{
+    struct st_block b;
+
+    test_ticks_to_us();
+    test_updates(&b);
+    test_format();
+    test_shm();
+
+    if (failures)
+    {
+        printf("stats_test: %d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("stats_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,112 @@
+/*
+* timer_math_test - checks the arithmetic behind the native timer family
+* (Winmm/timer_math.h) on the build host.
+*
+*   make -C tests check
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "timer_math.h"
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static void test_ticks_to_ms(void)
+{
+    uint64_t freq;
+
+    CHECK(tmr_ticks_to_ms(0, 1000) == 0);
+    CHECK(tmr_ticks_to_ms(999, 1000) == 999);
+
+    // truncated like timeGetTime, never rounded up
+    CHECK(tmr_ticks_to_ms(10000000 - 1, 10000000) == 999);
+    CHECK(tmr_ticks_to_ms(10000000, 10000000) == 1000);
+    CHECK(tmr_ticks_to_ms(3579545 / 2, 3579545) == 499);
+
+    // 100 days of uptime on a 3 GHz counter overflows ticks * 1000 but
+    // not the split form
+    freq = 3000000000ULL;
+    CHECK(tmr_ticks_to_ms(freq * 86400 * 100, freq) == 86400ULL * 100 * 1000);
+    CHECK(tmr_ticks_to_ms(freq * 86400 * 100 + freq / 1000 * 7 + 1, freq) == 86400ULL * 100 * 1000 + 7);
+
+    // largest delta a 64-bit counter can hold
+    freq = 10000000;
+    CHECK(tmr_ticks_to_ms(UINT64_MAX, freq) == (UINT64_MAX / freq) * 1000 + (UINT64_MAX % freq) / 10000);
+}
+
+static void test_interrupt_to_ms(void)
+{
+    CHECK(tmr_interrupt_to_ms(0) == 0);
+    CHECK(tmr_interrupt_to_ms(TMR_INTERRUPT_UNITS_PER_MS - 1) == 0);
+    CHECK(tmr_interrupt_to_ms(TMR_INTERRUPT_UNITS_PER_MS) == 1);
+    CHECK(tmr_interrupt_to_ms(123456789) == 12345);
+}
+
+static void test_counter_time(void)
+{
+    uint64_t freq = 10000000;
+
+    CHECK(tmr_counter_time(5000, 100, 100, freq) == 5000);
+    CHECK(tmr_counter_time(5000, 100, 100 + freq, freq) == 6000);
+
+    // the counter may start anywhere, only the delta counts
+    CHECK(tmr_counter_time(0, UINT64_MAX - freq, UINT64_MAX, freq) == 1000);
+
+    // wraps to 0 after 2^32 ms like timeGetTime
+    CHECK(tmr_counter_time(0xFFFFFFFF, 0, freq / 1000, freq) == 0);
+    CHECK(tmr_counter_time(0xFFFFFF00, 0, freq, freq) == 0xFFFFFF00u + 1000);
+    CHECK(tmr_counter_time(0, 0, freq * 4294967ULL + freq / 1000 * 297, freq) == 1);
+}
+
+static void test_periods(void)
+{
+    struct tmr_periods p;
+
+    memset(&p, 0, sizeof p);
+
+    CHECK(tmr_period_begin(&p, 0) == -1);
+    CHECK(tmr_period_end(&p, 0) == -1);
+    CHECK(tmr_period_begin(&p, TMR_PERIOD_MAX + 1) == -1);
+    CHECK(tmr_period_end(&p, TMR_PERIOD_MAX + 1) == -1);
+
+    // unmatched ends are rejected
+    CHECK(tmr_period_end(&p, 1) == -1);
+
+    CHECK(tmr_period_begin(&p, 1) == 0);
+    CHECK(tmr_period_begin(&p, 1) == 0);
+    CHECK(tmr_period_begin(&p, TMR_MAX_TRACKED_PERIOD) == 0);
+    CHECK(p.count[1] == 2);
+    CHECK(p.count[TMR_MAX_TRACKED_PERIOD] == 1);
+
+    CHECK(tmr_period_end(&p, 1) == 0);
+    CHECK(tmr_period_end(&p, 1) == 0);
+    CHECK(tmr_period_end(&p, 1) == -1);
+    CHECK(tmr_period_end(&p, TMR_MAX_TRACKED_PERIOD) == 0);
+    CHECK(tmr_period_end(&p, TMR_MAX_TRACKED_PERIOD) == -1);
+
+    // coarse periods are accepted but not counted, so any end goes
+    CHECK(tmr_period_end(&p, TMR_MAX_TRACKED_PERIOD + 1) == 0);
+    CHECK(tmr_period_begin(&p, TMR_PERIOD_MAX) == 0);
+    CHECK(tmr_period_end(&p, TMR_PERIOD_MAX) == 0);
+}
+
+int main(void)
+{
+    test_ticks_to_ms();
+    test_interrupt_to_ms();
+    test_counter_time();
+    test_periods();
+
+    if (failures)
+    {
+        printf("timer_math_test: %d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("timer_math_test: ok\n");
+    return 0;
+}
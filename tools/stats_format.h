@@ -0,0 +1,81 @@
+#ifndef STATS_FORMAT_H
+#define STATS_FORMAT_H
+
+// The text winmmstat prints for two samples of the statistics block taken
+// a second apart. Kept apart from the reader so the host tests can check
+// it; like stats.h it needs nothing from Windows.
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "stats.h"
+
+// Enough for every device to show both of its lines
+#define ST_FORMAT_MAX   4096
+
+static const char *st_mci_names[ST_MCI_COUNT] = { "open", "close", "play", "stop", "set", "status", "other", "string" };
+
+// snprintf onto the end of buf, which stays terminated when it fills up
+static __inline void st_append(char *buf, size_t size, size_t *len, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    if (*len >= size)
+        return;
+
+    va_start(ap, fmt);
+    n = vsnprintf(buf + *len, size - *len, fmt, ap);
+    va_end(ap);
+
+    if (n < 0)
+        buf[*len] = '\0';
+    else
+        *len = (size_t)n < size - *len ? *len + n : size - 1;
+}
+
+// Returns the length written, size - 1 at most
+static __inline size_t st_format(char *buf, size_t size, const struct st_block *now, const struct st_block *prev)
+{
+    // every total wraps, only differences between samples mean anything
+    uint32_t calls = now->pump_calls - prev->pump_calls;
+    uint32_t pump_us = now->pump_us - prev->pump_us;
+    uint32_t decode_us = now->decode_us - prev->decode_us;
+    uint32_t decoded_ms = now->decoded_ms - prev->decoded_ms;
+    size_t len = 0;
+    int i;
+
+    if (!size)
+        return 0;
+    buf[0] = '\0';
+
+    st_append(buf, size, &len, "pid %u, startup scan %u.%03u ms\n", now->pid, now->scan_us / 1000, now->scan_us % 1000);
+    st_append(buf, size, &len, "pump: %u/s, avg %u us, max %u us\n", calls, calls ? pump_us / calls : 0, now->pump_max_us);
+    st_append(buf, size, &len, "decode: %u us per second of audio\n", decoded_ms ? (uint32_t)((uint64_t)decode_us * 1000 / decoded_ms) : 0);
+
+    st_append(buf, size, &len, "mci/s:");
+    for (i = 0; i < ST_MCI_COUNT; i++)
+        st_append(buf, size, &len, " %s %u", st_mci_names[i], now->mci_calls[i] - prev->mci_calls[i]);
+    st_append(buf, size, &len, "\n");
+
+    for (i = 0; i < ST_DEVICES; i++)
+    {
+        const struct st_device *d = &now->devices[i];
+
+        if (!d->active && !d->underruns)
+            continue;
+
+        st_append(buf, size, &len, "device %d: %s track %02u at %u:%02u.%03u, %u buffers queued, %u underruns\n",
+            i, d->active ? "playing" : "stopped", d->track,
+            d->position_ms / 60000, d->position_ms / 1000 % 60, d->position_ms % 1000,
+            d->buffers, d->underruns);
+
+        if (d->readahead_hits || d->readahead_misses)
+            st_append(buf, size, &len, "          readahead: %u hits, %u misses\n", d->readahead_hits, d->readahead_misses);
+    }
+
+    st_append(buf, size, &len, "\n");
+    return len;
+}
+
+#endif
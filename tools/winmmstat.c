@@ -0,0 +1,104 @@
+/*
+* winmmstat - print the live statistics ogg-winmm publishes when
+* Statistics=1 is set in winmm.ini.
+*
+*   cl /nologo /I..\Winmm winmmstat.c                   (Windows)
+*   cc -O2 -I../Winmm winmmstat.c -o winmmstat -lrt      (POSIX shm)
+*
+* winmmstat [-1]    -1 prints a single sample and exits
+*/
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+
+#include "stats.h"
+#include "stats_format.h"
+
+static const struct st_block *map_block(void)
+{
+#ifdef _WIN32
+    HANDLE map = OpenFileMappingA(FILE_MAP_READ, FALSE, ST_NAME);
+
+    if (!map)
+        return NULL;
+
+    return MapViewOfFile(map, FILE_MAP_READ, 0, 0, sizeof(struct st_block));
+#else
+    int fd = shm_open(ST_NAME, O_RDONLY, 0);
+
+    if (fd < 0)
+        return NULL;
+
+    void *p = mmap(NULL, sizeof(struct st_block), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    return p == MAP_FAILED ? NULL : p;
+#endif
+}
+
+static void pause_second(void)
+{
+#ifdef _WIN32
+    Sleep(1000);
+#else
+    sleep(1);
+#endif
+}
+
+// Copy the counters out one by one, each read is atomic on its own
+static void sample(const struct st_block *b, struct st_block *out)
+{
+    const uint32_t *src = (const uint32_t *)b;
+    uint32_t *dst = (uint32_t *)out;
+    size_t i;
+
+    for (i = 0; i < sizeof(struct st_block) / sizeof(uint32_t); i++)
+        dst[i] = ST_GET((uint32_t *)&src[i]);
+}
+
+static void print(const struct st_block *now, const struct st_block *prev)
+{
+    char text[ST_FORMAT_MAX];
+
+    st_format(text, sizeof text, now, prev);
+    fputs(text, stdout);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    int once = argc > 1 && strcmp(argv[1], "-1") == 0;
+    const struct st_block *b = map_block();
+    struct st_block prev, now;
+
+    if (!b)
+    {
+        fprintf(stderr, "winmmstat: %s not found, is Statistics=1 set in winmm.ini?\n", ST_NAME);
+        return 1;
+    }
+
+    if (ST_GET((uint32_t *)&b->magic) != ST_MAGIC || b->version != ST_VERSION || b->size != sizeof(struct st_block))
+    {
+        fprintf(stderr, "winmmstat: %s has an unknown layout\n", ST_NAME);
+        return 1;
+    }
+
+    sample(b, &prev);
+
+    do
+    {
+        pause_second();
+        sample(b, &now);
+        print(&now, &prev);
+        prev = now;
+    } while (!once);
+
+    return 0;
+}